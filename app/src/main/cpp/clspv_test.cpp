@@ -17,9 +17,13 @@
  * limitations under the License.
  */
 
+#include "descriptor_binding_test.hpp"
 #include "memmove_test.hpp"
+#include "test_baseline.hpp"
 #include "test_manifest.hpp"
+#include "test_result_export.hpp"
 #include "test_result_logging.hpp"
+#include "test_result_trace.hpp"
 #include "test_utils.hpp"
 #include "util_init.hpp"
 #include "vulkan_utils/vulkan_utils.hpp"
@@ -28,9 +32,12 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
 
 /* ============================================================================================== */
 
@@ -111,24 +118,6 @@ void init_compute_queue_family_index(struct sample_info &info) {
     info.graphics_queue_family_properties = queue_props[info.graphics_queue_family_index];
 }
 
-void my_init_descriptor_pool(struct sample_info &info) {
-    const vk::DescriptorPoolSize type_count[] = {
-        { vk::DescriptorType::eStorageBuffer,   16 },
-        { vk::DescriptorType::eUniformBuffer,   16 },
-        { vk::DescriptorType::eSampler,         16 },
-        { vk::DescriptorType::eSampledImage,    16 },
-        { vk::DescriptorType::eStorageImage,    16 }
-    };
-
-    vk::DescriptorPoolCreateInfo createInfo;
-    createInfo.setMaxSets(64)
-            .setPoolSizeCount(sizeof(type_count) / sizeof(type_count[0]))
-            .setPPoolSizes(type_count)
-            .setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet);
-
-    info.desc_pool = info.device->createDescriptorPoolUnique(createInfo);
-}
-
 void dumpInstanceExtensions()
 {
     auto properties = vk::enumerateInstanceExtensionProperties();
@@ -180,10 +169,151 @@ void dumpDeviceMemoryProperties(vk::PhysicalDevice device)
     LOGI("}");
 }
 
+void logDescriptorArenaStats(const char* label, const clspv_utils::descriptor_arena& arena)
+{
+    const auto& stats = arena.getStats();
+
+    LOGI("descriptorArena(%s) { allocations:%llu recycled:%llu poolsCreated:%llu resets:%llu peakOutstanding:%llu }",
+         label,
+         static_cast<unsigned long long>(stats.mNumAllocations),
+         static_cast<unsigned long long>(stats.mNumRecycled),
+         static_cast<unsigned long long>(stats.mNumPoolsCreated),
+         static_cast<unsigned long long>(stats.mNumResets),
+         static_cast<unsigned long long>(stats.mPeakOutstanding));
+}
+
+void logUniformRingStats(const clspv_utils::uniform_ring& ring)
+{
+    const auto& stats = ring.getStats();
+
+    LOGI("uniformRing { allocations:%llu blocksCreated:%llu blocks:%llu peakBytesOutstanding:%llu }",
+         static_cast<unsigned long long>(stats.mNumAllocations),
+         static_cast<unsigned long long>(stats.mNumBlocksCreated),
+         static_cast<unsigned long long>(ring.getBlockCount()),
+         static_cast<unsigned long long>(stats.mPeakBytesOutstanding));
+}
+
+void logQueryRingStats(const char* label, const clspv_utils::query_ring& ring)
+{
+    const auto& stats = ring.getStats();
+
+    LOGI("queryRing(%s) { supported:%s allocations:%llu poolsCreated:%llu pools:%llu harvests:%llu notReady:%llu peakQueriesOutstanding:%llu }",
+         label,
+         ring.isSupported() ? "true" : "false",
+         static_cast<unsigned long long>(stats.mNumAllocations),
+         static_cast<unsigned long long>(stats.mNumPoolsCreated),
+         static_cast<unsigned long long>(ring.getPoolCount()),
+         static_cast<unsigned long long>(stats.mNumHarvests),
+         static_cast<unsigned long long>(stats.mNumNotReady),
+         static_cast<unsigned long long>(stats.mPeakQueriesOutstanding));
+}
+
+void logClockCalibration(const clspv_utils::clock_calibration& calibration)
+{
+    const char* method = "none";
+    switch (calibration.getMethod()) {
+        case clspv_utils::clock_calibration::method::kCalibratedTimestamps: method = "calibratedTimestamps"; break;
+        case clspv_utils::clock_calibration::method::kHostCorrelation: method = "hostCorrelation"; break;
+        default: break;
+    }
+
+    LOGI("clockCalibration { method:%s maxDeviationNs:%lld }",
+         method,
+         static_cast<long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(calibration.getMaxDeviation()).count()));
+}
+
+void logMemoryAllocatorStats(const vulkan_utils::memory_allocator& allocator)
+{
+    const auto& stats = allocator.getStats();
+
+    LOGI("memoryAllocator { allocations:%llu blocksCreated:%llu blocks:%llu bytesInBlocks:%llu bytesInUse:%llu peakBytesInUse:%llu fallbacks:%llu failedBlocks:%llu flushes:%llu invalidates:%llu imports:%llu fragmentation:%.3f }",
+         static_cast<unsigned long long>(stats.mNumAllocations),
+         static_cast<unsigned long long>(stats.mNumBlocksCreated),
+         static_cast<unsigned long long>(stats.mNumBlocks),
+         static_cast<unsigned long long>(stats.mBytesInBlocks),
+         static_cast<unsigned long long>(stats.mBytesInUse),
+         static_cast<unsigned long long>(stats.mPeakBytesInUse),
+         static_cast<unsigned long long>(stats.mNumFallbacks),
+         static_cast<unsigned long long>(stats.mNumFailedBlocks),
+         static_cast<unsigned long long>(stats.mNumFlushes),
+         static_cast<unsigned long long>(stats.mNumInvalidates),
+         static_cast<unsigned long long>(stats.mNumImports),
+         allocator.getFragmentation());
+
+    const auto& memProps = allocator.getMemoryProperties();
+    for (std::uint32_t i = 0; i < memProps.memoryHeapCount; ++i) {
+        const auto budget = allocator.getHeapBudget(i);
+        LOGI("   heap %u { size:%llu budget:%llu usage:%llu }",
+             i,
+             static_cast<unsigned long long>(memProps.memoryHeaps[i].size),
+             static_cast<unsigned long long>(budget.mBudget),
+             static_cast<unsigned long long>(budget.mUsage));
+    }
+}
+
+// Result files named by the manifest are relative to the output directory
+std::string outputPath(const std::string& fileName)
+{
+    const std::string directory = android_utils::get_output_directory();
+    return (directory.empty() || fileName[0] == '/' ? fileName : directory + '/' + fileName);
+}
+
+void writeTraceFile(const sample_info& info, const test_manifest::results& results, const std::string& fileName)
+{
+    const std::string path = outputPath(fileName);
+    std::ofstream os(path.c_str());
+    if (!os) {
+        LOGE("cannot write trace to %s", path.c_str());
+        return;
+    }
+
+    test_result_trace::writeTrace(info, results, os);
+    LOGI("Trace written to %s", path.c_str());
+}
+
+void writeResultsFile(const sample_info& info, const test_manifest::results& results, const std::string& fileName)
+{
+    const std::string path = outputPath(fileName);
+    std::ofstream os(path.c_str());
+    if (!os) {
+        LOGE("cannot write results to %s", path.c_str());
+        return;
+    }
+
+    test_result_export::writeResults(info, results, fileName, os);
+    LOGI("Results written to %s", path.c_str());
+}
+
+// True if any timing run regressed against the baseline
+bool compareWithBaseline(const sample_info& info, const test_manifest::results& results, const test_manifest::manifest_t& manifest)
+{
+    const std::string path = outputPath(manifest.baseline_file);
+    std::ifstream is(path.c_str());
+    if (!is) {
+        LOGE("cannot read baseline from %s", path.c_str());
+        return false;
+    }
+
+    test_baseline::options opts;
+    opts.mAlpha = manifest.baseline_alpha;
+    opts.mMinRelativeChange = manifest.baseline_min_change;
+
+    const auto comparisons = test_baseline::compare(test_baseline::read(is), test_baseline::collect(info, results), opts);
+    test_result_logging::logBaselineComparison(comparisons);
+
+    return std::any_of(comparisons.begin(), comparisons.end(),
+                       [](const test_baseline::comparison& c) {
+                           return test_baseline::verdict::kRegression == c.mVerdict;
+                       });
+}
+
 /* ============================================================================================== */
 
 int sample_main(int argc, char *argv[]) {
-    android_utils::iassetstream is("test_manifest.txt");
+    // An explicit manifest name may be passed by the host runner; Android always uses the default.
+    const char* manifestName = (argc > 1 && argv[1] ? argv[1] : "test_manifest.txt");
+
+    android_utils::iassetstream is(manifestName);
     const auto manifest = test_manifest::read(is);
     is.close();
 
@@ -194,6 +324,22 @@ int sample_main(int argc, char *argv[]) {
     }
 
     info.instance_extension_names.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
+
+    // Needed to query host import alignment, if the device offers VK_EXT_external_memory_host.
+    // init_instance always enables VK_KHR_get_physical_device_properties2, which the device
+    // search needs, so the extensions that depend on it need no check of their own.
+    const auto availableInstanceExtensions = vk::enumerateInstanceExtensionProperties();
+    const auto hasInstanceExtension = [&availableInstanceExtensions](const char* name) {
+        return std::any_of(availableInstanceExtensions.begin(), availableInstanceExtensions.end(),
+                           [name](const vk::ExtensionProperties& p) {
+                               return 0 == std::strcmp(p.extensionName, name);
+                           });
+    };
+    const bool hasExternalMemory = hasInstanceExtension(VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME);
+    if (hasExternalMemory) {
+        info.instance_extension_names.push_back(VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME);
+    }
+
     init_instance(info, "vulkansamples_device");
     init_debug_report_callback(info, dbgFunc);
 
@@ -203,11 +349,37 @@ int sample_main(int argc, char *argv[]) {
     // The clspv solution we're using requires two Vulkan extensions to be enabled.
     info.device_extension_names.push_back("VK_KHR_storage_buffer_storage_class");
     info.device_extension_names.push_back("VK_KHR_variable_pointers");
+
+    // Faster ways of binding kernel arguments, used if the device offers them.
+    const auto availableExtensions = info.gpu.enumerateDeviceExtensionProperties();
+    // Likewise heap budgets, which keep the memory allocator off nearly full heaps, host
+    // memory import, which lets large inputs be used without a copy, calibrated timestamps,
+    // which put GPU and host events on one timeline, and host query reset, which clears recycled
+    // queries as they are handed out (where the headers are new enough to know it).
+    auto optionalExtensions = std::vector<const char*>({ VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME,
+                                                         VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME,
+                                                         VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
+                                                         VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME });
+#ifdef VK_EXT_host_query_reset
+    optionalExtensions.push_back(VK_EXT_HOST_QUERY_RESET_EXTENSION_NAME);
+#endif
+    if (hasExternalMemory) {
+        optionalExtensions.push_back(VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME);
+        optionalExtensions.push_back(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+    }
+    for (auto name : optionalExtensions) {
+        const bool isAvailable = std::any_of(availableExtensions.begin(), availableExtensions.end(),
+                                             [name](const vk::ExtensionProperties& p) {
+                                                 return 0 == std::strcmp(p.extensionName, name);
+                                             });
+        if (isAvailable) {
+            info.device_extension_names.push_back(name);
+        }
+    }
     init_device(info);
     init_device_queue(info);
 
     init_command_pool(info);
-    my_init_descriptor_pool(info);
 
     dumpInstanceExtensions();
     dumpDeviceExtensions(info.gpu);
@@ -215,25 +387,44 @@ int sample_main(int argc, char *argv[]) {
 
     clspv_utils::device device(info.gpu,
                                *info.device,
-                               *info.desc_pool,
                                *info.cmd_pool,
-                               info.graphics_queue);
+                               info.graphics_queue,
+                               info.graphics_queue_family_index,
+                               info.device_extension_names,
+                               *info.inst,
+                               info.enabled_device_features);
+    device.setPipelineCacheDirectory(android_utils::get_pipeline_cache_directory());
 
     const auto results = test_manifest::run(manifest, device);
     test_result_logging::logResults(info, results);
+    // Compare before writing results, which may replace the baseline file
+    const bool hasRegression = (!manifest.baseline_file.empty() && compareWithBaseline(info, results, manifest));
+    if (!manifest.trace_file.empty()) {
+        writeTraceFile(info, results, manifest.trace_file);
+    }
+    for (auto& fileName : manifest.results_files) {
+        writeResultsFile(info, results, fileName);
+    }
+    logDescriptorArenaStats("transient", device.getDescriptorArena());
+    logDescriptorArenaStats("persistent", device.getPersistentDescriptorArena());
+    logUniformRingStats(device.getUniformRing());
+    logQueryRingStats("timestamps", device.getTimestampRing());
+    logQueryRingStats("statistics", device.getStatisticsRing());
+    logClockCalibration(device.getClockCalibration());
+    logMemoryAllocatorStats(device.getMemoryAllocator());
 
     memmove_test::runAllTests(info);
+    descriptor_binding_test::runAllTests(device);
 
     //
     // Clean up
     //
     device = clspv_utils::device();
-    info.desc_pool.reset();
     info.cmd_pool.reset();
     info.device->waitIdle();
     info.device.reset();
 
     LOGI("ClspvTest complete!!");
 
-    return 0;
+    return (hasRegression ? EXIT_FAILURE : 0);
 }
@@ -0,0 +1,167 @@
+#include "clock_calibration.hpp"
+
+#include "vulkan_utils/vulkan_utils.hpp"
+
+#include <limits>
+
+#include <time.h>
+
+namespace {
+
+    // How long a calibrated-timestamps correlation is trusted before it is refreshed
+    const std::chrono::seconds  kRecalibrationInterval(1);
+
+    // The submission correlation keeps the tightest of several round trips
+    const int                   kCorrelationRounds = 5;
+
+    typedef std::chrono::duration<double, std::nano> fractional_ns;
+
+    // The steady clock's reading of an instant given on CLOCK_MONOTONIC. The two clocks usually
+    // coincide, but the standard doesn't promise it.
+    clspv_utils::clock_calibration::host_clock::time_point from_clock_monotonic(std::uint64_t monotonicNs)
+    {
+        typedef clspv_utils::clock_calibration::host_clock host_clock;
+
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        const auto steadyNow = host_clock::now();
+
+        const std::chrono::nanoseconds monotonicNow(static_cast<std::int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec);
+        const auto offset = steadyNow.time_since_epoch() - monotonicNow;
+
+        return host_clock::time_point(std::chrono::duration_cast<host_clock::duration>(std::chrono::nanoseconds(monotonicNs) + offset));
+    }
+
+} // anonymous namespace
+
+namespace clspv_utils {
+
+    clock_calibration::clock_calibration(vk::Device                         device,
+                                         vk::Queue                          queue,
+                                         vk::CommandPool                    commandPool,
+                                         double                             timestampPeriod,
+                                         std::uint32_t                      timestampValidBits,
+                                         PFN_vkGetCalibratedTimestampsEXT   getCalibratedTimestamps,
+                                         bool                               supportsHostDomain)
+            : mDevice(device),
+              mQueue(queue),
+              mCommandPool(commandPool),
+              mTimestampPeriod(timestampPeriod),
+              mValidBitsMask(vulkan_utils::timestamp_valid_bits_mask(timestampValidBits)),
+              mGetCalibratedTimestamps(supportsHostDomain ? getCalibratedTimestamps : nullptr)
+    {
+        // Calibration is deferred to first use, so that devices that never time anything don't
+        // pay for a submission.
+    }
+
+    clock_calibration::host_clock::time_point clock_calibration::toHostTime(std::uint64_t timestamp)
+    {
+        if (!isSupported()) {
+            return host_clock::time_point();
+        }
+
+        if (method::kNone == mMethod
+            || (method::kCalibratedTimestamps == mMethod && host_clock::now() - mHostReference > kRecalibrationInterval)) {
+            calibrate();
+        }
+
+        // Timestamps wrap at the valid bits; take the shorter way round from the reference
+        const std::uint64_t ahead = (timestamp - mDeviceReference) & mValidBitsMask;
+        const std::uint64_t behind = (mDeviceReference - timestamp) & mValidBitsMask;
+        const double deltaNs = (ahead <= behind
+                                ? static_cast<double>(ahead) * mTimestampPeriod
+                                : -static_cast<double>(behind) * mTimestampPeriod);
+
+        return mHostReference + std::chrono::duration_cast<host_clock::duration>(fractional_ns(deltaNs));
+    }
+
+    void clock_calibration::calibrate()
+    {
+        if (mGetCalibratedTimestamps) {
+            calibrateWithExtension();
+        }
+
+        if (method::kCalibratedTimestamps != mMethod) {
+            calibrateWithSubmission();
+        }
+    }
+
+    void clock_calibration::calibrateWithExtension()
+    {
+        VkCalibratedTimestampInfoEXT infos[2] = {};
+        infos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+        infos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+        infos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+        infos[1].timeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+
+        std::uint64_t timestamps[2] = { 0, 0 };
+        std::uint64_t maxDeviation = 0;
+        const VkResult result = mGetCalibratedTimestamps(static_cast<VkDevice>(mDevice),
+                                                         2,
+                                                         infos,
+                                                         timestamps,
+                                                         &maxDeviation);
+        if (VK_SUCCESS != result) {
+            // Stop trying the extension; the submission correlation takes over
+            mGetCalibratedTimestamps = nullptr;
+            mMethod = method::kNone;
+            return;
+        }
+
+        mDeviceReference = timestamps[0] & mValidBitsMask;
+        mHostReference = from_clock_monotonic(timestamps[1]);
+        mMaxDeviation = std::chrono::duration_cast<host_clock::duration>(std::chrono::nanoseconds(maxDeviation));
+        mMethod = method::kCalibratedTimestamps;
+    }
+
+    void clock_calibration::calibrateWithSubmission()
+    {
+        vk::QueryPoolCreateInfo poolCreateInfo;
+        poolCreateInfo.setQueryType(vk::QueryType::eTimestamp)
+                .setQueryCount(1);
+        auto queryPool = mDevice.createQueryPoolUnique(poolCreateInfo);
+
+        auto command = vulkan_utils::allocate_command_buffer(mDevice, mCommandPool);
+        command->begin(vk::CommandBufferBeginInfo());
+        command->resetQueryPool(*queryPool, 0, 1);
+        command->writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, *queryPool, 0);
+        command->end();
+
+        auto fence = mDevice.createFenceUnique(vk::FenceCreateInfo());
+
+        vk::CommandBuffer rawCommand = *command;
+        vk::SubmitInfo submitInfo;
+        submitInfo.setCommandBufferCount(1)
+                .setPCommandBuffers(&rawCommand);
+
+        host_clock::duration bestRoundTrip = host_clock::duration::max();
+        for (int round = 0; round < kCorrelationRounds; ++round) {
+            mDevice.resetFences(*fence);
+
+            const auto before = host_clock::now();
+            mQueue.submit(submitInfo, *fence);
+            mDevice.waitForFences(*fence, VK_TRUE, std::numeric_limits<std::uint64_t>::max());
+            const auto after = host_clock::now();
+
+            std::uint64_t timestamp = 0;
+            mDevice.getQueryPoolResults(*queryPool,
+                                        0,
+                                        1,
+                                        sizeof(timestamp),
+                                        &timestamp,
+                                        sizeof(timestamp),
+                                        vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+
+            const auto roundTrip = after - before;
+            if (roundTrip < bestRoundTrip) {
+                bestRoundTrip = roundTrip;
+                mDeviceReference = timestamp & mValidBitsMask;
+                mHostReference = before + roundTrip / 2;
+            }
+        }
+
+        mMaxDeviation = bestRoundTrip / 2;
+        mMethod = method::kHostCorrelation;
+    }
+
+} // namespace clspv_utils
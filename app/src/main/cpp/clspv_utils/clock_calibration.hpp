@@ -0,0 +1,80 @@
+#ifndef CLSPVUTILS_CLOCK_CALIBRATION_HPP
+#define CLSPVUTILS_CLOCK_CALIBRATION_HPP
+
+#include "clspv_utils_fwd.hpp"
+
+#include "clspv_utils_interop.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <chrono>
+#include <cstdint>
+
+namespace clspv_utils {
+
+    // Places device timestamps on the host's steady clock, so that host and GPU events of one
+    // dispatch share a timeline.
+    //
+    // With VK_EXT_calibrated_timestamps and a host time domain matching the steady clock, the
+    // driver samples both clocks together; the correlation is refreshed every so often to follow
+    // drift. Otherwise the clocks are correlated once, by submitting a timestamp write and taking
+    // the host time halfway between submission and observed completion. That correlation is only
+    // as good as half the round trip, which getMaxDeviation reports.
+    class clock_calibration {
+    public:
+        typedef std::chrono::steady_clock host_clock;
+
+        enum class method {
+            kNone,                  // not yet calibrated, or the queue has no timestamps
+            kCalibratedTimestamps,  // VK_EXT_calibrated_timestamps
+            kHostCorrelation        // one-time correlation through a timestamp submission
+        };
+
+        clock_calibration() {}
+
+        // The queue's family must have timestamps (timestampValidBits > 0) for calibration to
+        // succeed. getCalibratedTimestamps may be null; supportsHostDomain tells whether the
+        // device offers the steady clock's domain.
+        clock_calibration(vk::Device                        device,
+                          vk::Queue                         queue,
+                          vk::CommandPool                   commandPool,
+                          double                            timestampPeriod,
+                          std::uint32_t                     timestampValidBits,
+                          PFN_vkGetCalibratedTimestampsEXT  getCalibratedTimestamps,
+                          bool                              supportsHostDomain);
+
+        clock_calibration(const clock_calibration& other) = delete;
+
+        clock_calibration&  operator=(const clock_calibration& other) = delete;
+
+        bool                isSupported() const { return 0 != mValidBitsMask; }
+
+        // Host time at which the device wrote the timestamp. Calibrates on first use. Returns the
+        // host clock's epoch if timestamps are not supported.
+        host_clock::time_point  toHostTime(std::uint64_t timestamp);
+
+        method                  getMethod() const { return mMethod; }
+        host_clock::duration    getMaxDeviation() const { return mMaxDeviation; }
+
+    private:
+        void    calibrate();
+        void    calibrateWithExtension();
+        void    calibrateWithSubmission();
+
+    private:
+        vk::Device                          mDevice;
+        vk::Queue                           mQueue;
+        vk::CommandPool                     mCommandPool;
+        double                              mTimestampPeriod            = 1.0;
+        std::uint64_t                       mValidBitsMask              = 0;
+        PFN_vkGetCalibratedTimestampsEXT    mGetCalibratedTimestamps    = nullptr;
+
+        method                              mMethod                     = method::kNone;
+        std::uint64_t                       mDeviceReference            = 0;
+        host_clock::time_point              mHostReference;
+        host_clock::duration                mMaxDeviation               = host_clock::duration::zero();
+    };
+
+}
+
+#endif //CLSPVUTILS_CLOCK_CALIBRATION_HPP
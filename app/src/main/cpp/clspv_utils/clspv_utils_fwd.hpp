@@ -8,14 +8,18 @@
 namespace clspv_utils {
 
     // execution types
+    class descriptor_arena;
     class device;
     class invocation;
     class kernel;
     class module;
+    class uniform_ring;
 
     struct execution_time_t;
     struct kernel_req_t;
     struct invocation_req_t;
+    struct pipeline_build_result_t;
+    struct pipeline_variant_t;
 
     // interface types
     struct arg_spec_t;
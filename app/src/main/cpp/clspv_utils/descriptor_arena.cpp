@@ -0,0 +1,166 @@
+#include "descriptor_arena.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+    const std::uint32_t kInitialSetsPerPool = 64;
+    const std::uint32_t kMaxSetsPerPool     = 1024;
+
+} // anonymous namespace
+
+namespace clspv_utils {
+
+    descriptor_arena::descriptor_arena(vk::Device device)
+            : mDevice(device)
+    {
+    }
+
+    vk::DescriptorSet descriptor_arena::allocate(vk::DescriptorSetLayout layout, descriptor_counts counts)
+    {
+        vk::DescriptorSet result;
+
+        auto found = mFreeSets.find(layout);
+        if (found != mFreeSets.end() && !found->second.empty()) {
+            result = found->second.back();
+            found->second.pop_back();
+            ++mStats.mNumRecycled;
+        }
+        else {
+            observe(counts);
+
+            const std::uint32_t nextPoolMaxSets = (mPools.empty() ? kInitialSetsPerPool
+                                                                  : std::min(2 * mCurrentPoolMaxSets, kMaxSetsPerPool));
+
+            if (mPools.empty() || mSetsInCurrentPool >= mCurrentPoolMaxSets) {
+                growPool(counts, nextPoolMaxSets);
+            }
+
+            try {
+                result = allocateFromPool(layout);
+            }
+            catch (const vk::OutOfPoolMemoryError&) {
+                // the current pool ran out of some descriptor type before it ran out of sets
+                growPool(counts, nextPoolMaxSets);
+                result = allocateFromPool(layout);
+            }
+            catch (const vk::FragmentedPoolError&) {
+                growPool(counts, nextPoolMaxSets);
+                result = allocateFromPool(layout);
+            }
+        }
+
+        ++mStats.mNumAllocations;
+        ++mStats.mNumOutstanding;
+        mStats.mPeakOutstanding = std::max(mStats.mPeakOutstanding, mStats.mNumOutstanding);
+
+        return result;
+    }
+
+    void descriptor_arena::release(vk::DescriptorSetLayout layout, vk::DescriptorSet set)
+    {
+        if (set) {
+            mFreeSets[layout].push_back(set);
+            --mStats.mNumOutstanding;
+        }
+    }
+
+    void descriptor_arena::forget(vk::DescriptorSetLayout layout)
+    {
+        mFreeSets.erase(layout);
+    }
+
+    bool descriptor_arena::reset()
+    {
+        if (mStats.mNumOutstanding > 0) {
+            return false;
+        }
+
+        mFreeSets.clear();
+
+        if (mPools.size() > 1) {
+            const auto peak = std::min<std::uint64_t>(std::max<std::uint64_t>(mStats.mPeakOutstanding, kInitialSetsPerPool),
+                                                      kMaxSetsPerPool);
+
+            mPools.clear();
+            growPool(nullptr, static_cast<std::uint32_t>(peak));
+        }
+        else if (!mPools.empty()) {
+            mDevice.resetDescriptorPool(*mPools.back());
+            mSetsInCurrentPool = 0;
+        }
+
+        ++mStats.mNumResets;
+        return true;
+    }
+
+    void descriptor_arena::observe(descriptor_counts counts)
+    {
+        for (auto& c : counts) {
+            mObservedDescriptors[c.type] += c.descriptorCount;
+        }
+        ++mObservedSets;
+    }
+
+    vector<vk::DescriptorPoolSize> descriptor_arena::computePoolSizes(std::uint32_t maxSets, descriptor_counts counts) const
+    {
+        type_count_map perType;
+
+        // Provision each type in proportion to its average use per set so far...
+        for (auto& observed : mObservedDescriptors) {
+            const std::uint64_t perSet = (observed.second + mObservedSets - 1) / mObservedSets;
+            perType[observed.first] = perSet * maxSets;
+        }
+
+        // ... but always leave room for the allocation that prompted the new pool.
+        for (auto& c : counts) {
+            perType[c.type] = std::max<std::uint64_t>(perType[c.type], c.descriptorCount);
+        }
+
+        vector<vk::DescriptorPoolSize> result;
+        for (auto& t : perType) {
+            if (t.second > 0) {
+                const auto count = std::min<std::uint64_t>(t.second, std::numeric_limits<std::uint32_t>::max());
+                result.push_back(vk::DescriptorPoolSize(t.first, static_cast<std::uint32_t>(count)));
+            }
+        }
+
+        // A pool must provide at least one descriptor, even if every layout seen so far is empty.
+        if (result.empty()) {
+            result.push_back(vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, maxSets));
+        }
+
+        return result;
+    }
+
+    void descriptor_arena::growPool(descriptor_counts counts, std::uint32_t maxSets)
+    {
+        const auto poolSizes = computePoolSizes(maxSets, counts);
+
+        vk::DescriptorPoolCreateInfo createInfo;
+        createInfo.setMaxSets(maxSets)
+                .setPoolSizeCount(poolSizes.size())
+                .setPPoolSizes(poolSizes.data());
+
+        mPools.push_back(mDevice.createDescriptorPoolUnique(createInfo));
+        mCurrentPoolMaxSets = maxSets;
+        mSetsInCurrentPool = 0;
+
+        ++mStats.mNumPoolsCreated;
+    }
+
+    vk::DescriptorSet descriptor_arena::allocateFromPool(vk::DescriptorSetLayout layout)
+    {
+        vk::DescriptorSetAllocateInfo allocInfo;
+        allocInfo.setDescriptorPool(*mPools.back())
+                .setDescriptorSetCount(1)
+                .setPSetLayouts(&layout);
+
+        const vk::DescriptorSet result = mDevice.allocateDescriptorSets(allocInfo)[0];
+        ++mSetsInCurrentPool;
+
+        return result;
+    }
+
+} // namespace clspv_utils
@@ -0,0 +1,82 @@
+#ifndef CLSPVUTILS_DESCRIPTOR_ARENA_HPP
+#define CLSPVUTILS_DESCRIPTOR_ARENA_HPP
+
+#include "clspv_utils_fwd.hpp"
+
+#include "clspv_utils_interop.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+
+namespace clspv_utils {
+
+    // Hands out descriptor sets from a chain of descriptor pools, adding a pool whenever the
+    // existing ones are exhausted. New pools are sized from the mix of descriptor types the arena
+    // has been asked for so far, and each is larger than the last.
+    //
+    // Sets are never freed back to their pool individually. Released sets are kept, by layout,
+    // and handed out again to the next allocation for the same layout; reset() recycles
+    // everything at once.
+    class descriptor_arena {
+    public:
+        typedef vk::ArrayProxy<const vk::DescriptorPoolSize> descriptor_counts;
+
+        struct stats_t {
+            std::uint64_t   mNumAllocations     = 0;    // sets handed out, including recycled ones
+            std::uint64_t   mNumRecycled        = 0;    // sets handed out from the free lists
+            std::uint64_t   mNumPoolsCreated    = 0;
+            std::uint64_t   mNumResets          = 0;
+            std::uint64_t   mNumOutstanding     = 0;    // sets handed out and not yet released
+            std::uint64_t   mPeakOutstanding    = 0;
+        };
+
+        explicit            descriptor_arena(vk::Device device);
+
+                            descriptor_arena(const descriptor_arena& other) = delete;
+
+        descriptor_arena&   operator=(const descriptor_arena& other) = delete;
+
+        // counts describes the descriptors in layout. It guides the sizing of new pools.
+        vk::DescriptorSet   allocate(vk::DescriptorSetLayout layout, descriptor_counts counts);
+
+        // The caller must guarantee that the GPU is no longer using the set.
+        void                release(vk::DescriptorSetLayout layout, vk::DescriptorSet set);
+
+        // Drop any released sets for the layout. Must be called before the layout is destroyed,
+        // since a later layout may be created with the same handle.
+        void                forget(vk::DescriptorSetLayout layout);
+
+        // Return every set to its pool in bulk, and consolidate the pool chain into a single pool
+        // large enough for the peak demand seen so far. Does nothing, and returns false, if any
+        // set is still outstanding.
+        bool                reset();
+
+        const stats_t&      getStats() const { return mStats; }
+        std::size_t         getPoolCount() const { return mPools.size(); }
+
+    private:
+        void                        observe(descriptor_counts counts);
+        vector<vk::DescriptorPoolSize>  computePoolSizes(std::uint32_t maxSets, descriptor_counts counts) const;
+        void                        growPool(descriptor_counts counts, std::uint32_t maxSets);
+        vk::DescriptorSet           allocateFromPool(vk::DescriptorSetLayout layout);
+
+    private:
+        typedef map<vk::DescriptorSetLayout, vector<vk::DescriptorSet> >    free_list_map;
+        typedef map<vk::DescriptorType, std::uint64_t>                      type_count_map;
+
+        vk::Device                          mDevice;
+        vector<vk::UniqueDescriptorPool>    mPools;
+        std::uint32_t                       mCurrentPoolMaxSets = 0;
+        std::uint32_t                       mSetsInCurrentPool  = 0;
+        free_list_map                       mFreeSets;
+
+        type_count_map                      mObservedDescriptors;
+        std::uint64_t                       mObservedSets       = 0;
+
+        stats_t                             mStats;
+    };
+
+}
+
+#endif //CLSPVUTILS_DESCRIPTOR_ARENA_HPP
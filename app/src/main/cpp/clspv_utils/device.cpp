@@ -6,7 +6,11 @@
 
 #include "interface.hpp"
 
+#include "vulkan_utils/vulkan_utils.hpp"
+
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 
 namespace {
@@ -71,35 +75,315 @@ namespace {
         return result;
     }
 
+    bool has_extension(const device::extension_list_proxy& extensions, const char* name)
+    {
+        return std::any_of(extensions.begin(), extensions.end(), [name](const char* e) {
+            return 0 == std::strcmp(e, name);
+        });
+    }
+
+    template <typename PFN>
+    PFN get_device_proc(vk::Device device, const char* name)
+    {
+        return reinterpret_cast<PFN>(device.getProcAddr(name));
+    }
+
+    template <typename PFN>
+    PFN get_instance_proc(vk::Instance instance, const char* name)
+    {
+        return reinterpret_cast<PFN>(instance.getProcAddr(name));
+    }
+
+    vulkan_utils::memory_allocator::budget_query create_budget_query(vk::PhysicalDevice physicalDevice,
+                                                                     vk::Instance       instance)
+    {
+        auto getMemoryProperties2 = get_instance_proc<PFN_vkGetPhysicalDeviceMemoryProperties2KHR>(instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+        if (!getMemoryProperties2) {
+            getMemoryProperties2 = get_instance_proc<PFN_vkGetPhysicalDeviceMemoryProperties2>(instance, "vkGetPhysicalDeviceMemoryProperties2");
+        }
+        if (!getMemoryProperties2) {
+            return vulkan_utils::memory_allocator::budget_query();
+        }
+
+        return [physicalDevice, getMemoryProperties2](vulkan_utils::memory_allocator::heap_budgets& budgets) {
+            VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+            budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+            VkPhysicalDeviceMemoryProperties2 properties = {};
+            properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+            properties.pNext = &budgetProperties;
+
+            getMemoryProperties2(static_cast<VkPhysicalDevice>(physicalDevice), &properties);
+
+            for (std::uint32_t i = 0; i < properties.memoryProperties.memoryHeapCount; ++i) {
+                budgets[i].mBudget = budgetProperties.heapBudget[i];
+                budgets[i].mUsage = budgetProperties.heapUsage[i];
+            }
+        };
+    }
+
+    // Whether vkGetCalibratedTimestampsEXT can sample CLOCK_MONOTONIC, which the host clock follows
+    bool supports_monotonic_time_domain(vk::PhysicalDevice physicalDevice,
+                                        vk::Instance       instance)
+    {
+        auto getTimeDomains = get_instance_proc<PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT>(instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT");
+        if (!getTimeDomains) {
+            return false;
+        }
+
+        std::uint32_t numDomains = 0;
+        getTimeDomains(static_cast<VkPhysicalDevice>(physicalDevice), &numDomains, nullptr);
+
+        std::vector<VkTimeDomainEXT> domains(numDomains);
+        getTimeDomains(static_cast<VkPhysicalDevice>(physicalDevice), &numDomains, domains.data());
+        domains.resize(numDomains);
+
+        const bool hasDevice = std::find(domains.begin(), domains.end(), VK_TIME_DOMAIN_DEVICE_EXT) != domains.end();
+        const bool hasMonotonic = std::find(domains.begin(), domains.end(), VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT) != domains.end();
+        return hasDevice && hasMonotonic;
+    }
+
+    // 0 if the alignment cannot be queried, in which case host memory cannot be imported safely
+    vk::DeviceSize get_min_imported_host_pointer_alignment(vk::PhysicalDevice physicalDevice,
+                                                           vk::Instance       instance)
+    {
+        auto getProperties2 = get_instance_proc<PFN_vkGetPhysicalDeviceProperties2KHR>(instance, "vkGetPhysicalDeviceProperties2KHR");
+        if (!getProperties2) {
+            getProperties2 = get_instance_proc<PFN_vkGetPhysicalDeviceProperties2>(instance, "vkGetPhysicalDeviceProperties2");
+        }
+        if (!getProperties2) {
+            return 0;
+        }
+
+        VkPhysicalDeviceExternalMemoryHostPropertiesEXT hostProperties = {};
+        hostProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+
+        VkPhysicalDeviceProperties2 properties = {};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &hostProperties;
+
+        getProperties2(static_cast<VkPhysicalDevice>(physicalDevice), &properties);
+
+        return hostProperties.minImportedHostPointerAlignment;
+    }
+
+    // The guaranteed minimum if the limit cannot be queried
+    std::uint32_t get_max_push_descriptors(vk::PhysicalDevice physicalDevice,
+                                           vk::Instance       instance)
+    {
+        auto getProperties2 = get_instance_proc<PFN_vkGetPhysicalDeviceProperties2KHR>(instance, "vkGetPhysicalDeviceProperties2KHR");
+        if (!getProperties2) {
+            getProperties2 = get_instance_proc<PFN_vkGetPhysicalDeviceProperties2>(instance, "vkGetPhysicalDeviceProperties2");
+        }
+        if (!getProperties2) {
+            return clspv_utils::device::kMinPushDescriptors;
+        }
+
+        VkPhysicalDevicePushDescriptorPropertiesKHR pushProperties = {};
+        pushProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR;
+
+        VkPhysicalDeviceProperties2 properties = {};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &pushProperties;
+
+        getProperties2(static_cast<VkPhysicalDevice>(physicalDevice), &properties);
+
+        return std::max<std::uint32_t>(pushProperties.maxPushDescriptors, clspv_utils::device::kMinPushDescriptors);
+    }
+
 } // anonymous namespace
 
 namespace clspv_utils {
 
-    vk::UniqueDescriptorSet allocateDescriptorSet(const device&           inDevice,
-                                                  vk::DescriptorSetLayout layout)
+    vk::DescriptorSetLayoutCreateFlags getDescriptorSetLayoutFlags(descriptor_strategy strategy)
     {
-        vk::DescriptorSetAllocateInfo createInfo;
-        createInfo.setDescriptorPool(inDevice.getDescriptorPool())
-                .setDescriptorSetCount(1)
-                .setPSetLayouts(&layout);
-
-        return std::move(inDevice.getDevice().allocateDescriptorSetsUnique(createInfo)[0]);
+        return (descriptor_strategy::kPushDescriptor == strategy
+                ? vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR
+                : vk::DescriptorSetLayoutCreateFlags());
     }
 
     device::device(vk::PhysicalDevice                   physicalDevice,
                    vk::Device                           device,
-                   vk::DescriptorPool                   descriptorPool,
                    vk::CommandPool                      commandPool,
-                   vk::Queue                            computeQueue)
+                   vk::Queue                            computeQueue,
+                   std::uint32_t                        computeQueueFamily,
+                   extension_list_proxy                 enabledExtensions,
+                   vk::Instance                         instance,
+                   const vk::PhysicalDeviceFeatures&    enabledFeatures)
             : mPhysicalDevice(physicalDevice),
               mDevice(device),
               mMemoryProperties(physicalDevice.getMemoryProperties()),
-              mDescriptorPool(descriptorPool),
               mCommandPool(commandPool),
               mComputeQueue(computeQueue),
+              mComputeQueueFamily(computeQueueFamily),
               mSamplerCache(new sampler_cache),
-              mSamplerDescriptorCache(new descriptor_cache)
+              mSamplerDescriptorCache(new descriptor_cache),
+              mDescriptorArena(new descriptor_arena(device)),
+              mPersistentDescriptorArena(new descriptor_arena(device)),
+              mMemoryAllocator(new vulkan_utils::memory_allocator(device, mMemoryProperties, physicalDevice.getProperties().limits)),
+              mUniformRing(new uniform_ring(*mMemoryAllocator, physicalDevice.getProperties().limits)),
+              mTimestampRing(new query_ring(device,
+                                            vk::QueryType::eTimestamp,
+                                            vk::QueryPipelineStatisticFlags(),
+                                            0 != physicalDevice.getQueueFamilyProperties().at(computeQueueFamily).timestampValidBits,
+                                            vulkan_utils::timestamp_valid_bits_mask(physicalDevice.getQueueFamilyProperties().at(computeQueueFamily).timestampValidBits))),
+              mStatisticsRing(new query_ring(device,
+                                             vk::QueryType::ePipelineStatistics,
+                                             vk::QueryPipelineStatisticFlagBits::eComputeShaderInvocations,
+                                             VK_TRUE == enabledFeatures.pipelineStatisticsQuery))
+    {
+        if (has_extension(enabledExtensions, VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME)) {
+            mCreateDescriptorUpdateTemplate = get_device_proc<PFN_vkCreateDescriptorUpdateTemplateKHR>(device, "vkCreateDescriptorUpdateTemplateKHR");
+            mDestroyDescriptorUpdateTemplate = get_device_proc<PFN_vkDestroyDescriptorUpdateTemplateKHR>(device, "vkDestroyDescriptorUpdateTemplateKHR");
+            mUpdateDescriptorSetWithTemplate = get_device_proc<PFN_vkUpdateDescriptorSetWithTemplateKHR>(device, "vkUpdateDescriptorSetWithTemplateKHR");
+        }
+
+        if (has_extension(enabledExtensions, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME)) {
+            mCmdPushDescriptorSet = get_device_proc<PFN_vkCmdPushDescriptorSetKHR>(device, "vkCmdPushDescriptorSetKHR");
+            mMaxPushDescriptors = (instance
+                                   ? get_max_push_descriptors(physicalDevice, instance)
+                                   : static_cast<std::uint32_t>(kMinPushDescriptors));
+        }
+
+        if (instance && has_extension(enabledExtensions, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+            auto budgetQuery = create_budget_query(physicalDevice, instance);
+            if (budgetQuery) {
+                mMemoryAllocator->setBudgetQuery(budgetQuery);
+            }
+        }
+
+        if (instance && has_extension(enabledExtensions, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME)) {
+            const auto alignment = get_min_imported_host_pointer_alignment(physicalDevice, instance);
+            auto getMemoryHostPointerProperties = get_device_proc<PFN_vkGetMemoryHostPointerPropertiesEXT>(device, "vkGetMemoryHostPointerPropertiesEXT");
+            if (alignment > 0 && getMemoryHostPointerProperties) {
+                mMemoryAllocator->setHostImport(getMemoryHostPointerProperties, alignment);
+            }
+        }
+
+#ifdef VK_EXT_host_query_reset
+        // Only enabled together with its hostQueryReset feature (see init_device)
+        if (has_extension(enabledExtensions, VK_EXT_HOST_QUERY_RESET_EXTENSION_NAME)) {
+            auto resetQueryPool = get_device_proc<PFN_vkResetQueryPoolEXT>(device, "vkResetQueryPoolEXT");
+            if (resetQueryPool) {
+                const auto hostReset = [device, resetQueryPool](vk::QueryPool pool, std::uint32_t firstQuery, std::uint32_t queryCount) {
+                    resetQueryPool(static_cast<VkDevice>(device), static_cast<VkQueryPool>(pool), firstQuery, queryCount);
+                };
+                mTimestampRing->setHostReset(hostReset);
+                mStatisticsRing->setHostReset(hostReset);
+            }
+        }
+#endif
+
+        PFN_vkGetCalibratedTimestampsEXT getCalibratedTimestamps = nullptr;
+        bool supportsHostDomain = false;
+        if (instance && has_extension(enabledExtensions, VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME)) {
+            getCalibratedTimestamps = get_device_proc<PFN_vkGetCalibratedTimestampsEXT>(device, "vkGetCalibratedTimestampsEXT");
+            supportsHostDomain = supports_monotonic_time_domain(physicalDevice, instance);
+        }
+        mClockCalibration.reset(new clock_calibration(device,
+                                                      computeQueue,
+                                                      commandPool,
+                                                      physicalDevice.getProperties().limits.timestampPeriod,
+                                                      physicalDevice.getQueueFamilyProperties().at(computeQueueFamily).timestampValidBits,
+                                                      getCalibratedTimestamps,
+                                                      supportsHostDomain));
+
+        if (supportsDescriptorStrategy(descriptor_strategy::kPushDescriptor)) {
+            mDescriptorStrategy = descriptor_strategy::kPushDescriptor;
+        }
+        else if (supportsDescriptorStrategy(descriptor_strategy::kUpdateTemplate)) {
+            mDescriptorStrategy = descriptor_strategy::kUpdateTemplate;
+        }
+    }
+
+    bool device::supportsDescriptorStrategy(descriptor_strategy strategy) const
+    {
+        switch (strategy) {
+            case descriptor_strategy::kUpdateTemplate:
+                return mCreateDescriptorUpdateTemplate && mDestroyDescriptorUpdateTemplate && mUpdateDescriptorSetWithTemplate;
+
+            case descriptor_strategy::kPushDescriptor:
+                return nullptr != mCmdPushDescriptorSet;
+
+            default:
+                return true;
+        }
+    }
+
+    void device::setDescriptorStrategy(descriptor_strategy strategy)
+    {
+        if (!supportsDescriptorStrategy(strategy)) {
+            fail_runtime_error("descriptor strategy is not supported by the device");
+        }
+
+        mDescriptorStrategy = strategy;
+    }
+
+    descriptor_strategy device::selectDescriptorStrategy(const kernel_spec_t::arg_list& arguments) const
+    {
+        if (descriptor_strategy::kPushDescriptor == mDescriptorStrategy) {
+            std::size_t numDescriptors = 0;
+            for (auto& c : getKernelArgumentDescriptorCounts(arguments)) {
+                numDescriptors += c.descriptorCount;
+            }
+
+            if (numDescriptors > mMaxPushDescriptors) {
+                return (supportsDescriptorStrategy(descriptor_strategy::kUpdateTemplate)
+                        ? descriptor_strategy::kUpdateTemplate
+                        : descriptor_strategy::kWriteDescriptorSets);
+            }
+        }
+
+        return mDescriptorStrategy;
+    }
+
+    vk::DescriptorUpdateTemplate device::createDescriptorUpdateTemplate(const vk::DescriptorUpdateTemplateCreateInfo& createInfo) const
+    {
+        assert(mCreateDescriptorUpdateTemplate);
+
+        VkDescriptorUpdateTemplateKHR updateTemplate = VK_NULL_HANDLE;
+        const vk::Result result = static_cast<vk::Result>(mCreateDescriptorUpdateTemplate(static_cast<VkDevice>(mDevice),
+                                                                                          reinterpret_cast<const VkDescriptorUpdateTemplateCreateInfo*>(&createInfo),
+                                                                                          nullptr,
+                                                                                          &updateTemplate));
+        vk::createResultValue(result, "clspv_utils::device::createDescriptorUpdateTemplate");
+
+        return vk::DescriptorUpdateTemplate(updateTemplate);
+    }
+
+    void device::destroyDescriptorUpdateTemplate(vk::DescriptorUpdateTemplate updateTemplate) const
+    {
+        if (updateTemplate) {
+            assert(mDestroyDescriptorUpdateTemplate);
+            mDestroyDescriptorUpdateTemplate(static_cast<VkDevice>(mDevice),
+                                             static_cast<VkDescriptorUpdateTemplateKHR>(updateTemplate),
+                                             nullptr);
+        }
+    }
+
+    void device::updateDescriptorSetWithTemplate(vk::DescriptorSet              set,
+                                                 vk::DescriptorUpdateTemplate   updateTemplate,
+                                                 const void*                    data) const
+    {
+        assert(mUpdateDescriptorSetWithTemplate);
+        mUpdateDescriptorSetWithTemplate(static_cast<VkDevice>(mDevice),
+                                         static_cast<VkDescriptorSet>(set),
+                                         static_cast<VkDescriptorUpdateTemplateKHR>(updateTemplate),
+                                         data);
+    }
+
+    void device::pushDescriptorSet(vk::CommandBuffer                            commandBuffer,
+                                   vk::PipelineLayout                           layout,
+                                   std::uint32_t                                set,
+                                   vk::ArrayProxy<const vk::WriteDescriptorSet> writes) const
     {
+        assert(mCmdPushDescriptorSet);
+        mCmdPushDescriptorSet(static_cast<VkCommandBuffer>(commandBuffer),
+                              VK_PIPELINE_BIND_POINT_COMPUTE,
+                              static_cast<VkPipelineLayout>(layout),
+                              set,
+                              writes.size(),
+                              reinterpret_cast<const VkWriteDescriptorSet*>(writes.data()));
     }
 
     vk::Sampler device::getCachedSampler(int opencl_flags)
@@ -140,13 +424,14 @@ namespace clspv_utils {
         return samplerDescriptorLayout;
     }
 
-    vk::UniqueDescriptorSet device::createSamplerDescriptor(const sampler_list_proxy& samplers,
-                                                            vk::DescriptorSetLayout     layout)
+    vk::DescriptorSet device::createSamplerDescriptor(const sampler_list_proxy& samplers,
+                                                      vk::DescriptorSetLayout   layout)
     {
-        vk::UniqueDescriptorSet samplerDescriptor;
+        vk::DescriptorSet samplerDescriptor;
 
         if (layout) {
-            samplerDescriptor = allocateDescriptorSet(*this, layout);
+            const vk::DescriptorPoolSize counts(vk::DescriptorType::eSampler, samplers.size());
+            samplerDescriptor = mPersistentDescriptorArena->allocate(layout, counts);
 
             vector<vk::DescriptorImageInfo> literalSamplerInfo;
             vector<vk::WriteDescriptorSet> literalSamplerDescriptorWrites;
@@ -160,7 +445,7 @@ namespace clspv_utils {
                 literalSamplerInfo.push_back(samplerInfo);
 
                 vk::WriteDescriptorSet literalSamplerSet;
-                literalSamplerSet.setDstSet(*samplerDescriptor)
+                literalSamplerSet.setDstSet(samplerDescriptor)
                         .setDstBinding(s.mBinding)
                         .setDescriptorCount(1)
                         .setDescriptorType(vk::DescriptorType::eSampler)
@@ -194,7 +479,7 @@ namespace clspv_utils {
 
         descriptor_group result;
         result.mLayout = *found->second.mLayout;
-        result.mDescriptor = *found->second.mDescriptor;
+        result.mDescriptor = found->second.mDescriptor;
         return result;
     }
 
@@ -7,15 +7,32 @@
 
 #include "clspv_utils_fwd.hpp"
 
+#include "clock_calibration.hpp"
 #include "clspv_utils_interop.hpp"
+#include "descriptor_arena.hpp"
 #include "interface.hpp"
+#include "query_ring.hpp"
+#include "uniform_ring.hpp"
+
+#include "vulkan_utils/memory_allocator.hpp"
 
 #include <vulkan/vulkan.hpp>
 
+#include <cstdint>
 #include <memory>
 
 namespace clspv_utils {
 
+    // How invocations write their kernel argument descriptors
+    enum class descriptor_strategy {
+        kWriteDescriptorSets,   // vkUpdateDescriptorSets into a set from the descriptor arena
+        kUpdateTemplate,        // VK_KHR_descriptor_update_template into a set from the descriptor arena
+        kPushDescriptor         // VK_KHR_push_descriptor directly into the command buffer; no set is allocated
+    };
+
+    // Flags with which argument descriptor set layouts must be created for the strategy
+    vk::DescriptorSetLayoutCreateFlags  getDescriptorSetLayoutFlags(descriptor_strategy strategy);
+
     class device {
     public:
         struct descriptor_group
@@ -25,28 +42,102 @@ namespace clspv_utils {
         };
 
         typedef vk::ArrayProxy<const sampler_spec_t> sampler_list_proxy;
+        typedef vk::ArrayProxy<const char* const> extension_list_proxy;
+
+        // Every implementation supporting VK_KHR_push_descriptor allows at least this many
+        // descriptors to be pushed into one set.
+        static const std::size_t kMinPushDescriptors = 32;
 
         device() {}
 
+        // computeQueue must come from the queue family computeQueueFamily, whose timestamp
+        // properties the device's timestamp ring follows.
+        //
+        // enabledExtensions lists the device extensions device was created with. The descriptor
+        // strategy defaults to the fastest one those extensions allow. If VK_EXT_memory_budget is
+        // among them, and instance is given (with VK_KHR_get_physical_device_properties2 enabled),
+        // the memory allocator keeps within the heap budgets the driver reports. Likewise, with
+        // VK_EXT_external_memory_host, buffers can wrap host memory in place, and with
+        // VK_EXT_calibrated_timestamps, device timestamps are placed on the host clock directly.
+        //
+        // enabledFeatures lists the features device was created with. Invocations collect
+        // pipeline statistics only if pipelineStatisticsQuery is among them.
         device(vk::PhysicalDevice   physicalDevice,
                vk::Device           device,
-               vk::DescriptorPool   descriptorPool,
                vk::CommandPool      commandPool,
-               vk::Queue            computeQueue);
+               vk::Queue            computeQueue,
+               std::uint32_t        computeQueueFamily,
+               extension_list_proxy enabledExtensions = nullptr,
+               vk::Instance         instance = vk::Instance(),
+               const vk::PhysicalDeviceFeatures& enabledFeatures = vk::PhysicalDeviceFeatures());
 
         vk::PhysicalDevice  getPhysicalDevice() const { return mPhysicalDevice; }
         vk::Device          getDevice() const { return mDevice; }
-        vk::DescriptorPool  getDescriptorPool() const { return mDescriptorPool; }
         vk::CommandPool     getCommandPool() const { return mCommandPool; }
         vk::Queue           getComputeQueue() const { return mComputeQueue; }
+        std::uint32_t       getComputeQueueFamily() const { return mComputeQueueFamily; }
 
         const vk::PhysicalDeviceMemoryProperties&   getMemoryProperties() const { return mMemoryProperties; }
 
+        // Source of the device memory behind buffers and images created for this device
+        vulkan_utils::memory_allocator&             getMemoryAllocator() const { return *mMemoryAllocator; }
+
+        // Modules created on this device persist their pipeline caches in this directory. An empty
+        // directory (the default) disables persistence.
+        const string&       getPipelineCacheDirectory() const { return mPipelineCacheDirectory; }
+        void                setPipelineCacheDirectory(const string& directory) { mPipelineCacheDirectory = directory; }
+
+        // Source of the per-invocation kernel argument descriptor sets. Clients may reset it
+        // whenever no invocation is outstanding, e.g. at the end of each test scope.
+        descriptor_arena&               getDescriptorArena() const { return *mDescriptorArena; }
+
+        // Source of descriptor sets that live as long as the device, such as literal samplers.
+        // It is never reset.
+        descriptor_arena&               getPersistentDescriptorArena() const { return *mPersistentDescriptorArena; }
+
+        // Source of the uniform buffer ranges that hold kernel arguments passed by value
+        uniform_ring&                   getUniformRing() const { return *mUniformRing; }
+
+        // Source of the timestamp queries with which invocations time their dispatches
+        query_ring&                     getTimestampRing() const { return *mTimestampRing; }
+
+        // Source of the pipeline statistics queries with which invocations count the shader
+        // invocations of their dispatches. Unsupported unless pipelineStatisticsQuery is enabled.
+        query_ring&                     getStatisticsRing() const { return *mStatisticsRing; }
+
+        // Places the device timestamps written on the compute queue on the host clock
+        clock_calibration&              getClockCalibration() const { return *mClockCalibration; }
+
+        // The strategy applies to kernels created after it is set.
+        bool                supportsDescriptorStrategy(descriptor_strategy strategy) const;
+        descriptor_strategy getDescriptorStrategy() const { return mDescriptorStrategy; }
+        void                setDescriptorStrategy(descriptor_strategy strategy);
+
+        // The most descriptors that can be pushed into one set; 0 if push descriptors are not
+        // supported. Without the instance, this is the guaranteed minimum.
+        std::uint32_t       getMaxPushDescriptors() const { return mMaxPushDescriptors; }
+
+        // The strategy to use for a kernel with the given arguments. This is the device's strategy,
+        // unless the kernel has more descriptors than can be pushed.
+        descriptor_strategy selectDescriptorStrategy(const kernel_spec_t::arg_list& arguments) const;
+
+        // Thin wrappers over the extension entry points. They may only be called if the
+        // corresponding strategy is supported.
+        vk::DescriptorUpdateTemplate    createDescriptorUpdateTemplate(const vk::DescriptorUpdateTemplateCreateInfo& createInfo) const;
+        void                            destroyDescriptorUpdateTemplate(vk::DescriptorUpdateTemplate updateTemplate) const;
+        void                            updateDescriptorSetWithTemplate(vk::DescriptorSet              set,
+                                                                        vk::DescriptorUpdateTemplate   updateTemplate,
+                                                                        const void*                    data) const;
+        void                            pushDescriptorSet(vk::CommandBuffer                            commandBuffer,
+                                                          vk::PipelineLayout                           layout,
+                                                          std::uint32_t                                set,
+                                                          vk::ArrayProxy<const vk::WriteDescriptorSet> writes) const;
+
         vk::Sampler                     getCachedSampler(int opencl_flags);
 
         vk::UniqueDescriptorSetLayout   createSamplerDescriptorLayout(const sampler_list_proxy& samplers) const;
 
-        vk::UniqueDescriptorSet         createSamplerDescriptor(const sampler_list_proxy& samplers,
+        vk::DescriptorSet               createSamplerDescriptor(const sampler_list_proxy& samplers,
                                                                 vk::DescriptorSetLayout layout);
 
         descriptor_group                getCachedSamplerDescriptorGroup(const sampler_list_proxy& samplers);
@@ -54,7 +145,7 @@ namespace clspv_utils {
     private:
         struct unique_descriptor_group
         {
-            vk::UniqueDescriptorSet       mDescriptor;
+            vk::DescriptorSet             mDescriptor;
             vk::UniqueDescriptorSetLayout mLayout;
         };
 
@@ -65,17 +156,30 @@ namespace clspv_utils {
         vk::PhysicalDevice                  mPhysicalDevice;
         vk::Device                          mDevice;
         vk::PhysicalDeviceMemoryProperties  mMemoryProperties;
-        vk::DescriptorPool                  mDescriptorPool;
         vk::CommandPool                     mCommandPool;
         vk::Queue                           mComputeQueue;
+        std::uint32_t                       mComputeQueueFamily = 0;
+        string                              mPipelineCacheDirectory;
+
+        PFN_vkCreateDescriptorUpdateTemplateKHR     mCreateDescriptorUpdateTemplate     = nullptr;
+        PFN_vkDestroyDescriptorUpdateTemplateKHR    mDestroyDescriptorUpdateTemplate    = nullptr;
+        PFN_vkUpdateDescriptorSetWithTemplateKHR    mUpdateDescriptorSetWithTemplate    = nullptr;
+        PFN_vkCmdPushDescriptorSetKHR               mCmdPushDescriptorSet               = nullptr;
+        std::uint32_t                               mMaxPushDescriptors                 = 0;
+        descriptor_strategy                         mDescriptorStrategy                 = descriptor_strategy::kWriteDescriptorSets;
 
         shared_ptr<descriptor_cache>        mSamplerDescriptorCache;
         shared_ptr<sampler_cache>           mSamplerCache;
+        shared_ptr<descriptor_arena>        mDescriptorArena;
+        shared_ptr<descriptor_arena>        mPersistentDescriptorArena;
+        // Declared ahead of the uniform ring, whose blocks it allocates
+        shared_ptr<vulkan_utils::memory_allocator>  mMemoryAllocator;
+        shared_ptr<uniform_ring>            mUniformRing;
+        shared_ptr<query_ring>              mTimestampRing;
+        shared_ptr<query_ring>              mStatisticsRing;
+        shared_ptr<clock_calibration>       mClockCalibration;
     };
 
-    vk::UniqueDescriptorSet allocateDescriptorSet(const device&           inDevice,
-                                                  vk::DescriptorSetLayout layout);
-
 }
 
 #endif //CLSPVUTILS_DEVICE_HPP
@@ -301,7 +301,8 @@ namespace clspv_utils {
     }
 
     vk::UniqueDescriptorSetLayout createKernelArgumentDescriptorLayout(const kernel_spec_t::arg_list& arguments,
-                                                                       vk::Device inDevice)
+                                                                       vk::Device inDevice,
+                                                                       vk::DescriptorSetLayoutCreateFlags flags)
     {
         vector<vk::DescriptorSetLayoutBinding> bindingSet;
 
@@ -320,12 +321,59 @@ namespace clspv_utils {
         }
 
         vk::DescriptorSetLayoutCreateInfo createInfo;
-        createInfo.setBindingCount(bindingSet.size())
+        createInfo.setFlags(flags)
+                .setBindingCount(bindingSet.size())
                 .setPBindings(bindingSet.size() ? bindingSet.data() : nullptr);
 
         return inDevice.createDescriptorSetLayoutUnique(createInfo);
     }
 
+    vector<vk::DescriptorUpdateTemplateEntry> getKernelArgumentUpdateTemplateEntries(const kernel_spec_t::arg_list& arguments,
+                                                                                     std::size_t                    stride)
+    {
+        vector<vk::DescriptorUpdateTemplateEntry> result;
+
+        vk::DescriptorUpdateTemplateEntry entry;
+        entry.setDescriptorCount(1)
+                .setStride(stride);
+
+        for (auto &ka : arguments) {
+            // ignore any argument not in offset 0
+            if (0 != ka.mOffset) continue;
+
+            entry.setDstBinding(ka.mBinding)
+                    .setDescriptorType(getDescriptorType(ka.mKind))
+                    .setOffset(result.size() * stride);
+
+            result.push_back(entry);
+        }
+
+        return result;
+    }
+
+    vector<vk::DescriptorPoolSize> getKernelArgumentDescriptorCounts(const kernel_spec_t::arg_list& arguments)
+    {
+        vector<vk::DescriptorPoolSize> result;
+
+        for (auto &ka : arguments) {
+            // ignore any argument not in offset 0
+            if (0 != ka.mOffset) continue;
+
+            const vk::DescriptorType type = getDescriptorType(ka.mKind);
+            auto found = std::find_if(result.begin(), result.end(), [type](const vk::DescriptorPoolSize& ps) {
+                return ps.type == type;
+            });
+            if (found == result.end()) {
+                result.push_back(vk::DescriptorPoolSize(type, 1));
+            }
+            else {
+                ++found->descriptorCount;
+            }
+        }
+
+        return result;
+    }
+
     /***********************************************************************************************
      * arg_spec_t::kind functions
      **********************************************************************************************/
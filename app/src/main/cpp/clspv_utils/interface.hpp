@@ -91,7 +91,16 @@ namespace clspv_utils {
      */
 
     vk::UniqueDescriptorSetLayout createKernelArgumentDescriptorLayout(const kernel_spec_t::arg_list&   arguments,
-                                                                       vk::Device                       inDevice);
+                                                                       vk::Device                       inDevice,
+                                                                       vk::DescriptorSetLayoutCreateFlags flags = vk::DescriptorSetLayoutCreateFlags());
+
+    // One entry per binding in the layout createKernelArgumentDescriptorLayout creates, in argument
+    // order. Entry n reads its descriptor info from offset n * stride of the update data.
+    vector<vk::DescriptorUpdateTemplateEntry> getKernelArgumentUpdateTemplateEntries(const kernel_spec_t::arg_list& arguments,
+                                                                                     std::size_t                    stride);
+
+    // The number of descriptors of each type in the layout createKernelArgumentDescriptorLayout creates
+    vector<vk::DescriptorPoolSize>  getKernelArgumentDescriptorCounts(const kernel_spec_t::arg_list& arguments);
 
     /*
      * Sort the args such that pods are grouped together at the end of the sequence, and that
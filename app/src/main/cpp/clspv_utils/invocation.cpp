@@ -6,18 +6,63 @@
 
 #include "interface.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <memory>
+#include <utility>
 
 
 namespace clspv_utils {
 
     execution_time_t::execution_time_t() :
             cpu_duration(0),
-            timestamps()
+            timestamps(),
+            timeline(),
+            statistics()
     {
     }
 
+    completion::completion()
+    {
+        // this space intentionally left blank
+    }
+
+    completion::completion(vk::Device                       device,
+                           vk::Fence                        fence,
+                           execution_time_t::host_timeline* timeline)
+            : mDevice(device),
+              mFence(fence),
+              mTimeline(timeline)
+    {
+    }
+
+    bool completion::isComplete() const
+    {
+        if (mFence && vk::Result::eSuccess != mDevice.getFenceStatus(mFence)) {
+            return false;
+        }
+
+        observeComplete();
+        return true;
+    }
+
+    bool completion::wait(std::uint64_t timeout) const
+    {
+        if (mFence && vk::Result::eSuccess != mDevice.waitForFences(mFence, VK_TRUE, timeout)) {
+            return false;
+        }
+
+        observeComplete();
+        return true;
+    }
+
+    void completion::observeComplete() const
+    {
+        if (mTimeline && execution_time_t::host_timeline::time_point() == mTimeline->complete) {
+            mTimeline->complete = std::chrono::steady_clock::now();
+        }
+    }
+
     invocation::invocation()
     {
         // this space intentionally left blank
@@ -26,11 +71,16 @@ namespace clspv_utils {
     invocation::invocation(invocation_req_t req)
             : mReq(std::move(req))
     {
-        vk::QueryPoolCreateInfo poolCreateInfo;
-        poolCreateInfo.setQueryType(vk::QueryType::eTimestamp)
-                .setQueryCount(kTimestamp_count);
+        mTimestamps = mReq.mDevice.getTimestampRing().allocate(kTimestamp_count);
+        if (mReq.mDevice.getStatisticsRing().isSupported()) {
+            mStatistics = mReq.mDevice.getStatisticsRing().allocate(1);
+        }
+        mFence = mReq.mDevice.getDevice().createFenceUnique(vk::FenceCreateInfo());
 
-        mQueryPool = mReq.mDevice.getDevice().createQueryPoolUnique(poolCreateInfo);
+        if (mReq.mArgumentsLayout && descriptor_strategy::kPushDescriptor != mReq.mDescriptorStrategy) {
+            mArgumentsDescriptor = mReq.mDevice.getDescriptorArena().allocate(mReq.mArgumentsLayout,
+                                                                              getKernelArgumentDescriptorCounts(mReq.mKernelSpec.mArguments));
+        }
     }
 
     invocation::invocation(invocation&& other)
@@ -40,6 +90,37 @@ namespace clspv_utils {
     }
 
     invocation::~invocation() {
+        // The command buffer and timestamp queries must outlive any submission still using them.
+        try {
+            waitForPending();
+        }
+        catch (...) {
+            // If the wait failed, the GPU may still be using the descriptor set and uniform
+            // ranges; leak them rather than hand them to another invocation.
+            return;
+        }
+
+        if (mArgumentsDescriptor) {
+            mReq.mDevice.getDescriptorArena().release(mReq.mArgumentsLayout, mArgumentsDescriptor);
+        }
+
+        for (auto& u : mUniformAllocations) {
+            mReq.mDevice.getUniformRing().release(u);
+        }
+
+        if (mTimestamps.mPool) {
+            mReq.mDevice.getTimestampRing().release(mTimestamps);
+        }
+
+        if (mStatistics.mPool) {
+            mReq.mDevice.getStatisticsRing().release(mStatistics);
+        }
+    }
+
+    invocation& invocation::operator=(invocation&& other)
+    {
+        swap(other);
+        return *this;
     }
 
     void invocation::swap(invocation& other)
@@ -47,15 +128,28 @@ namespace clspv_utils {
         using std::swap;
 
         swap(mReq, other.mReq);
-        swap(mQueryPool, other.mQueryPool);
+        swap(mTimestamps, other.mTimestamps);
+        swap(mStatistics, other.mStatistics);
+        swap(mExpectedInvocations, other.mExpectedInvocations);
+        swap(mArgumentsDescriptor, other.mArgumentsDescriptor);
+        swap(mPipeline, other.mPipeline);
+        swap(mCommandBuffer, other.mCommandBuffer);
+        swap(mFence, other.mFence);
+        swap(mIsPending, other.mIsPending);
+        swap(mHasSubmitted, other.mHasSubmitted);
+        swap(mHostEvents, other.mHostEvents);
 
         swap(mSpecConstantArguments, other.mSpecConstantArguments);
-        swap(mBufferMemoryBarriers, other.mBufferMemoryBarriers);
-        swap(mImageMemoryBarriers, other.mImageMemoryBarriers);
+        swap(mBufferUses, other.mBufferUses);
+        swap(mImageUses, other.mImageUses);
+        swap(mUploadBuffers, other.mUploadBuffers);
+        swap(mReadbackBuffers, other.mReadbackBuffers);
 
         swap(mImageArgumentInfo, other.mImageArgumentInfo);
         swap(mBufferArgumentInfo, other.mBufferArgumentInfo);
         swap(mArgumentDescriptorWrites, other.mArgumentDescriptorWrites);
+        swap(mUniformAllocations, other.mUniformAllocations);
+        swap(mArgumentUpdateData, other.mArgumentUpdateData);
     }
 
     std::size_t invocation::countArguments() const {
@@ -97,12 +191,17 @@ namespace clspv_utils {
             fail_runtime_error("buffer is not configured as a storage buffer");
         }
 
-        mBufferMemoryBarriers.push_back(buffer.prepareForShaderRead());
-        mBufferMemoryBarriers.push_back(buffer.prepareForShaderWrite());
+        // Whether the kernel only reads the buffer isn't known, so assume it does both
         mBufferArgumentInfo.push_back(buffer.use());
+        mBufferUses.push_back({ mBufferArgumentInfo.back().buffer, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite });
+
+        if (buffer.isStaged()) {
+            mUploadBuffers.push_back(&buffer);
+            mReadbackBuffers.push_back(&buffer);
+        }
 
         vk::WriteDescriptorSet argSet;
-        argSet.setDstSet(mReq.mArgumentsDescriptor)
+        argSet.setDstSet(mArgumentsDescriptor)
                 .setDstBinding(validateArgType(countArguments(), vk::DescriptorType::eStorageBuffer))
                 .setDescriptorCount(1)
                 .setDescriptorType(vk::DescriptorType::eStorageBuffer);
@@ -114,24 +213,46 @@ namespace clspv_utils {
             fail_runtime_error("buffer is not configured as a uniform buffer");
         }
 
-        mBufferMemoryBarriers.push_back(buffer.prepareForShaderRead());
         mBufferArgumentInfo.push_back(buffer.use());
+        mBufferUses.push_back({ mBufferArgumentInfo.back().buffer, vk::AccessFlagBits::eUniformRead });
+
+        if (buffer.isStaged()) {
+            mUploadBuffers.push_back(&buffer);
+        }
 
         vk::WriteDescriptorSet argSet;
-        argSet.setDstSet(mReq.mArgumentsDescriptor)
+        argSet.setDstSet(mArgumentsDescriptor)
                 .setDstBinding(validateArgType(countArguments(), vk::DescriptorType::eUniformBuffer))
                 .setDescriptorCount(1)
                 .setDescriptorType(vk::DescriptorType::eUniformBuffer);
         mArgumentDescriptorWrites.push_back(argSet);
     }
 
+    void invocation::addUniformBufferArgument(const void* data, vk::DeviceSize numBytes) {
+        const std::uint32_t binding = validateArgType(countArguments(), vk::DescriptorType::eUniformBuffer);
+
+        const auto range = mReq.mDevice.getUniformRing().allocate(data, numBytes);
+        mUniformAllocations.push_back(range);
+
+        // The ring was written before submission, which makes the data visible to the device
+        // without a barrier.
+        mBufferArgumentInfo.push_back(vk::DescriptorBufferInfo(range.mBuffer, range.mOffset, range.mSize));
+
+        vk::WriteDescriptorSet argSet;
+        argSet.setDstSet(mArgumentsDescriptor)
+                .setDstBinding(binding)
+                .setDescriptorCount(1)
+                .setDescriptorType(vk::DescriptorType::eUniformBuffer);
+        mArgumentDescriptorWrites.push_back(argSet);
+    }
+
     void invocation::addSamplerArgument(vk::Sampler samp) {
         vk::DescriptorImageInfo samplerInfo;
         samplerInfo.setSampler(samp);
         mImageArgumentInfo.push_back(samplerInfo);
 
         vk::WriteDescriptorSet argSet;
-        argSet.setDstSet(mReq.mArgumentsDescriptor)
+        argSet.setDstSet(mArgumentsDescriptor)
                 .setDstBinding(validateArgType(countArguments(), vk::DescriptorType::eSampler))
                 .setDescriptorCount(1)
                 .setDescriptorType(vk::DescriptorType::eSampler);
@@ -139,11 +260,12 @@ namespace clspv_utils {
     }
 
     void invocation::addReadOnlyImageArgument(vulkan_utils::image& image) {
-        mImageMemoryBarriers.push_back(image.prepare(vk::ImageLayout::eShaderReadOnlyOptimal));
-        mImageArgumentInfo.push_back(image.use());
+        // The layout transition is recorded with the dispatch, but the descriptor names the layout now
+        mImageUses.push_back({ &image, vk::AccessFlagBits::eShaderRead, vk::ImageLayout::eShaderReadOnlyOptimal });
+        mImageArgumentInfo.push_back(image.use().setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal));
 
         vk::WriteDescriptorSet argSet;
-        argSet.setDstSet(mReq.mArgumentsDescriptor)
+        argSet.setDstSet(mArgumentsDescriptor)
                 .setDstBinding(validateArgType(countArguments(), vk::DescriptorType::eSampledImage))
                 .setDescriptorCount(1)
                 .setDescriptorType(vk::DescriptorType::eSampledImage);
@@ -151,11 +273,11 @@ namespace clspv_utils {
     }
 
     void invocation::addWriteOnlyImageArgument(vulkan_utils::image& image) {
-        mImageMemoryBarriers.push_back(image.prepare(vk::ImageLayout::eGeneral));
-        mImageArgumentInfo.push_back(image.use());
+        mImageUses.push_back({ &image, vk::AccessFlagBits::eShaderWrite, vk::ImageLayout::eGeneral });
+        mImageArgumentInfo.push_back(image.use().setImageLayout(vk::ImageLayout::eGeneral));
 
         vk::WriteDescriptorSet argSet;
-        argSet.setDstSet(mReq.mArgumentsDescriptor)
+        argSet.setDstSet(mArgumentsDescriptor)
                 .setDstBinding(validateArgType(countArguments(), vk::DescriptorType::eStorageImage))
                 .setDescriptorCount(1)
                 .setDescriptorType(vk::DescriptorType::eStorageImage);
@@ -167,7 +289,7 @@ namespace clspv_utils {
         mSpecConstantArguments.push_back(numElements);
     }
 
-    void invocation::updateDescriptorSets() {
+    void invocation::linkDescriptorInfo() {
         //
         // Set up to create the descriptor set write structures for arguments.
         // We will iterate the param lists in the same order,
@@ -196,102 +318,329 @@ namespace clspv_utils {
                     assert(0 && "unkown argument type");
             }
         }
+    }
 
-        //
-        // Do the actual descriptor set updates
-        //
-        mReq.mDevice.getDevice().updateDescriptorSets(mArgumentDescriptorWrites, nullptr);
+    void invocation::updateDescriptorSets() {
+        linkDescriptorInfo();
+
+        switch (mReq.mDescriptorStrategy) {
+            case descriptor_strategy::kPushDescriptor:
+                // the descriptors are pushed as the command buffer is filled
+                break;
+
+            case descriptor_strategy::kUpdateTemplate: {
+                // The template has one slot per argument binding, in argument order, which is also
+                // the order in which the arguments were added. If some were never added, the
+                // template would read garbage, so update just the ones present instead.
+                const auto numBindings = std::count_if(mReq.mKernelSpec.mArguments.begin(),
+                                                       mReq.mKernelSpec.mArguments.end(),
+                                                       [](const arg_spec_t& ka) { return 0 == ka.mOffset; });
+
+                if (mReq.mArgumentsUpdateTemplate
+                    && mArgumentDescriptorWrites.size() == static_cast<std::size_t>(numBindings)) {
+                    mArgumentUpdateData.resize(mArgumentDescriptorWrites.size());
+
+                    auto nextData = mArgumentUpdateData.begin();
+                    for (auto& a : mArgumentDescriptorWrites) {
+                        if (a.pImageInfo) {
+                            nextData->mImage = *a.pImageInfo;
+                        }
+                        else {
+                            nextData->mBuffer = *a.pBufferInfo;
+                        }
+                        ++nextData;
+                    }
+
+                    mReq.mDevice.updateDescriptorSetWithTemplate(mArgumentsDescriptor,
+                                                                 mReq.mArgumentsUpdateTemplate,
+                                                                 mArgumentUpdateData.data());
+                    break;
+                }
+            }
+            // fall through
+
+            default:
+                mReq.mDevice.getDevice().updateDescriptorSets(mArgumentDescriptorWrites, nullptr);
+                break;
+        }
     }
 
-    void invocation::fillCommandBuffer(vk::CommandBuffer commandBuffer, const vk::Extent3D& num_workgroups)
+    void invocation::fillCommandBuffer(vk::CommandBuffer                 commandBuffer,
+                                       const vk::Extent3D&               num_workgroups,
+                                       vulkan_utils::resource_tracker&   tracker)
     {
-        auto pipeline = mReq.mGetPipelineFn(mSpecConstantArguments);
+        mPipeline = mReq.mGetPipelineFn(mSpecConstantArguments);
+
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, **mPipeline);
+
+        if (descriptor_strategy::kPushDescriptor == mReq.mDescriptorStrategy) {
+            std::uint32_t argumentsSet = 0;
+            if (mReq.mLiteralSamplerDescriptor) {
+                commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                                 mReq.mPipelineLayout,
+                                                 0,
+                                                 mReq.mLiteralSamplerDescriptor,
+                                                 nullptr);
+                argumentsSet = 1;
+            }
 
-        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+            if (!mArgumentDescriptorWrites.empty()) {
+                mReq.mDevice.pushDescriptorSet(commandBuffer,
+                                               mReq.mPipelineLayout,
+                                               argumentsSet,
+                                               mArgumentDescriptorWrites);
+            }
+        }
+        else {
+            vk::DescriptorSet descriptors[] = { mReq.mLiteralSamplerDescriptor, mArgumentsDescriptor };
+            std::uint32_t numDescriptors = (descriptors[0] ? 2 : 1);
+            if (1 == numDescriptors) descriptors[0] = descriptors[1];
+
+            commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                             mReq.mPipelineLayout,
+                                             0,
+                                             { numDescriptors, descriptors },
+                                             nullptr);
+        }
 
-        vk::DescriptorSet descriptors[] = { mReq.mLiteralSamplerDescriptor, mReq.mArgumentsDescriptor };
-        std::uint32_t numDescriptors = (descriptors[0] ? 2 : 1);
-        if (1 == numDescriptors) descriptors[0] = descriptors[1];
+        // Staging transfers sit outside the timestamps, so that kernel timings stay comparable
+        // across memory placements.
+        vulkan_utils::recordUploads(commandBuffer, tracker, mUploadBuffers);
 
-        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
-                                         mReq.mPipelineLayout,
-                                         0,
-                                         { numDescriptors, descriptors },
-                                         nullptr);
+        const bool writesTimestamps = mReq.mDevice.getTimestampRing().isSupported();
+        if (writesTimestamps) {
+            commandBuffer.resetQueryPool(mTimestamps.mPool, mTimestamps.mFirstQuery, kTimestamp_count);
+            writeTimestamp(commandBuffer, kTimestamp_startOfExecution);
+        }
 
-        commandBuffer.resetQueryPool(*mQueryPool, kTimestamp_first, kTimestamp_count);
+        if (mStatistics.mPool) {
+            commandBuffer.resetQueryPool(mStatistics.mPool, mStatistics.mFirstQuery, mStatistics.mCount);
+        }
 
-        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader,
-                                     *mQueryPool,
-                                     kTimestamp_startOfExecution);
+        for (const auto& u : mBufferUses) {
+            tracker.useBuffer(u.mBuffer, vk::PipelineStageFlagBits::eComputeShader, u.mAccess);
+        }
+        for (const auto& u : mImageUses) {
+            tracker.useImage(*u.mImage, vk::PipelineStageFlagBits::eComputeShader, u.mAccess, u.mLayout);
+        }
+        tracker.recordBarriers(commandBuffer);
 
-        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eHost | vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
-                                      vk::PipelineStageFlagBits::eComputeShader,
-                                      vk::DependencyFlags(),
-                                      nullptr,    // memory barriers
-                                      mBufferMemoryBarriers,    // buffer memory barriers
-                                      mImageMemoryBarriers);    // image memory barriers
+        if (writesTimestamps) {
+            writeTimestamp(commandBuffer, kTimestamp_postHostBarrier);
+        }
 
-        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader,
-                                     *mQueryPool,
-                                     kTimestamp_postHostBarrier);
+        if (mStatistics.mPool) {
+            commandBuffer.beginQuery(mStatistics.mPool, mStatistics.mFirstQuery, vk::QueryControlFlags());
+        }
 
         commandBuffer.dispatch(num_workgroups.width, num_workgroups.height, num_workgroups.depth);
 
-        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader,
-                                     *mQueryPool,
-                                     kTimestamp_postExecution);
+        if (mStatistics.mPool) {
+            commandBuffer.endQuery(mStatistics.mPool, mStatistics.mFirstQuery);
+        }
+
+        mExpectedInvocations = uint64_t(num_workgroups.width) * num_workgroups.height * num_workgroups.depth
+                               * mReq.mWorkgroupSize.width * mReq.mWorkgroupSize.height * mReq.mWorkgroupSize.depth;
+
+        if (writesTimestamps) {
+            writeTimestamp(commandBuffer, kTimestamp_postExecution);
+        }
+
+        vulkan_utils::recordReadbacks(commandBuffer, tracker, mReadbackBuffers);
     }
 
-    void invocation::submitCommand(vk::CommandBuffer commandBuffer) {
+    void invocation::submitCommand(vk::CommandBuffer commandBuffer, vk::Fence fence) {
         vk::CommandBuffer rawCommand = commandBuffer;
         vk::SubmitInfo submitInfo;
         submitInfo.setCommandBufferCount(1)
                 .setPCommandBuffers(&rawCommand);
 
-        mReq.mDevice.getComputeQueue().submit(submitInfo, nullptr);
+        mReq.mDevice.getComputeQueue().submit(submitInfo, fence);
+    }
+
+    void invocation::waitForPending() {
+        if (mIsPending) {
+            completion(mReq.mDevice.getDevice(), *mFence, &mHostEvents).wait();
+            mIsPending = false;
+        }
+    }
 
+    void invocation::pollPending() {
+        if (mIsPending && completion(mReq.mDevice.getDevice(), *mFence, &mHostEvents).isComplete()) {
+            mIsPending = false;
+        }
     }
 
     execution_time_t invocation::run(const vk::Extent3D& num_workgroups) {
-        const auto commandBuffer = vulkan_utils::allocate_command_buffer(mReq.mDevice.getDevice(), mReq.mDevice.getCommandPool());
+        record(num_workgroups);
+        return replay();
+    }
 
-        commandBuffer->begin(vk::CommandBufferBeginInfo());
-        dispatch(*commandBuffer, num_workgroups);
-        commandBuffer->end();
+    void invocation::record(const vk::Extent3D& num_workgroups) {
+        // Re-recording a command buffer that is still executing is not allowed.
+        waitForPending();
 
-        auto start = std::chrono::high_resolution_clock::now();
-        submitCommand(*commandBuffer);
-        mReq.mDevice.getComputeQueue().waitIdle();
-        auto end = std::chrono::high_resolution_clock::now();
+        if (!mCommandBuffer) {
+            mCommandBuffer = vulkan_utils::allocate_command_buffer(mReq.mDevice.getDevice(), mReq.mDevice.getCommandPool());
+        }
+
+        // Every replay reuses the layout transitions recorded here, whose old layouts are the
+        // ones the images have now. So each image must be back in that layout when the command
+        // buffer ends. An undefined layout is valid as an old layout whatever the image is in.
+        vector<std::pair<vulkan_utils::image*, vk::ImageLayout>> startLayouts;
+        for (const auto& u : mImageUses) {
+            const bool isListed = std::any_of(startLayouts.begin(), startLayouts.end(),
+                                              [&u](const std::pair<vulkan_utils::image*, vk::ImageLayout>& l) {
+                                                  return l.first == u.mImage;
+                                              });
+            if (!isListed) {
+                startLayouts.push_back(std::make_pair(u.mImage, u.mImage->getLayout()));
+            }
+        }
+
+        vulkan_utils::resource_tracker tracker;
+
+        mCommandBuffer->begin(vk::CommandBufferBeginInfo());
+        dispatch(*mCommandBuffer, num_workgroups, tracker);
+        for (const auto& l : startLayouts) {
+            if (vk::ImageLayout::eUndefined != l.second && vk::ImageLayout::ePreinitialized != l.second) {
+                // As untracked work would use it next, which is how the next replay sees it
+                tracker.useImage(*l.first,
+                                 vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+                                 vk::AccessFlags(),
+                                 l.second);
+            }
+        }
+        tracker.recordBarriers(*mCommandBuffer);
+        mCommandBuffer->end();
+    }
+
+    execution_time_t invocation::replay() {
+        submit().wait();
+        mIsPending = false;
 
         execution_time_t result = getExecutionTime();
-        result.cpu_duration = end - start;
+        result.cpu_duration = mHostEvents.complete - mHostEvents.submit_begin;
         return result;
     }
 
+    completion invocation::submit() {
+        if (!mCommandBuffer) {
+            fail_runtime_error("cannot submit an invocation that has not been recorded");
+        }
+
+        waitForPending();
+        mReq.mDevice.getDevice().resetFences(*mFence);
+
+        mHostEvents = execution_time_t::host_timeline();
+        mHostEvents.submit_begin = std::chrono::steady_clock::now();
+        submitCommand(*mCommandBuffer, *mFence);
+        mHostEvents.submit_end = std::chrono::steady_clock::now();
+        mIsPending = true;
+        mHasSubmitted = true;
+
+        return completion(mReq.mDevice.getDevice(), *mFence, &mHostEvents);
+    }
+
     void invocation::dispatch(vk::CommandBuffer commandBuffer, const vk::Extent3D& numWorkgroups)
+    {
+        vulkan_utils::resource_tracker tracker;
+        dispatch(commandBuffer, numWorkgroups, tracker);
+    }
+
+    void invocation::dispatch(vk::CommandBuffer                 commandBuffer,
+                              const vk::Extent3D&               numWorkgroups,
+                              vulkan_utils::resource_tracker&   tracker)
     {
         updateDescriptorSets();
-        fillCommandBuffer(commandBuffer, numWorkgroups);
+        fillCommandBuffer(commandBuffer, numWorkgroups, tracker);
+    }
+
+    void invocation::writeTimestamp(vk::CommandBuffer commandBuffer, Timestamp which)
+    {
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader,
+                                     mTimestamps.mPool,
+                                     mTimestamps.mFirstQuery + which);
     }
 
     execution_time_t invocation::getExecutionTime()
     {
-        uint64_t timestamps[kTimestamp_count];
-        mReq.mDevice.getDevice().getQueryPoolResults(*mQueryPool,
-                                                     kTimestamp_first,
-                                                     kTimestamp_count,
-                                                     sizeof(uint64_t),
-                                                     timestamps,
-                                                     sizeof(uint64_t),
-                                                     vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+        // Until this invocation's own submission has reset them, its queries may still hold
+        // results from an earlier owner, or never become available at all
+        if (!mHasSubmitted) {
+            fail_runtime_error("cannot get the execution time of an invocation that has not been submitted");
+        }
+        waitForPending();
 
         execution_time_t result;
+        if (!tryGetExecutionTime(result)) {
+            result = execution_time_t();
+            result.timeline = mHostEvents;
+
+            if (mReq.mDevice.getTimestampRing().isSupported()) {
+                uint64_t timestamps[kTimestamp_count];
+                mReq.mDevice.getTimestampRing().getResults(mTimestamps, timestamps);
+                setTimestamps(result, timestamps);
+            }
+
+            if (mStatistics.mPool) {
+                uint64_t invocations = 0;
+                mReq.mDevice.getStatisticsRing().getResults(mStatistics, &invocations);
+                setStatistics(result, invocations);
+            }
+        }
+        return result;
+    }
+
+    bool invocation::tryGetExecutionTime(execution_time_t& result)
+    {
+        pollPending();
+        if (!mHasSubmitted || mIsPending) {
+            return false;
+        }
+
+        // Where timestamps aren't supported nothing was written; report zeros rather than wait
+        // for queries that never complete
+        execution_time_t harvested;
+        harvested.timeline = mHostEvents;
+
+        auto& timestampRing = mReq.mDevice.getTimestampRing();
+        if (timestampRing.isSupported()) {
+            uint64_t timestamps[kTimestamp_count];
+            if (!timestampRing.tryGetResults(mTimestamps, timestamps)) {
+                return false;
+            }
+            setTimestamps(harvested, timestamps);
+        }
+
+        if (mStatistics.mPool) {
+            uint64_t invocations = 0;
+            if (!mReq.mDevice.getStatisticsRing().tryGetResults(mStatistics, &invocations)) {
+                return false;
+            }
+            setStatistics(harvested, invocations);
+        }
+
+        result = harvested;
+        return true;
+    }
+
+    void invocation::setTimestamps(execution_time_t& result, const uint64_t* timestamps)
+    {
         result.timestamps.start = timestamps[kTimestamp_startOfExecution];
         result.timestamps.host_barrier = timestamps[kTimestamp_postHostBarrier];
         result.timestamps.execution = timestamps[kTimestamp_postExecution];
-        return result;
+
+        auto& calibration = mReq.mDevice.getClockCalibration();
+        result.timeline.gpu_start = calibration.toHostTime(result.timestamps.start);
+        result.timeline.gpu_end = calibration.toHostTime(result.timestamps.execution);
+    }
+
+    void invocation::setStatistics(execution_time_t& result, uint64_t computeShaderInvocations)
+    {
+        result.statistics.is_valid = true;
+        result.statistics.compute_shader_invocations = computeShaderInvocations;
+        result.statistics.expected_invocations = mExpectedInvocations;
     }
 
 } // namespace clspv_utils
@@ -13,6 +13,8 @@
 #include "invocation_req.hpp"
 
 #include <chrono>
+#include <cstdint>
+#include <limits>
 #include <memory>
 
 #include <vulkan/vulkan.hpp>
@@ -31,10 +33,59 @@ namespace clspv_utils {
             uint64_t execution      = 0;
         };
 
+        // Host and GPU events of one execution on the host's steady clock (see clock_calibration).
+        // Events that were not observed are left at the clock's epoch.
+        struct host_timeline {
+            typedef std::chrono::steady_clock::time_point time_point;
+
+            time_point  submit_begin;       // vkQueueSubmit called
+            time_point  submit_end;         // vkQueueSubmit returned
+            time_point  gpu_start;          // timestamps.start
+            time_point  gpu_end;            // timestamps.execution
+            time_point  complete;           // host saw the fence signalled
+        };
+
+        // Counted by a pipeline statistics query around the dispatch, where the device supports
+        // them (see device::getStatisticsRing)
+        struct pipeline_statistics {
+            bool        is_valid                    = false;
+            uint64_t    compute_shader_invocations  = 0;
+            uint64_t    expected_invocations        = 0;    // workgroups dispatched times workgroup size
+        };
+
         execution_time_t();
 
         std::chrono::duration<double>   cpu_duration;
         vulkan_timestamps               timestamps;
+        host_timeline                   timeline;
+        pipeline_statistics             statistics;
+    };
+
+    // A handle on one asynchronous submission of an invocation. The handle is only valid while
+    // the invocation that produced it is alive and has not been submitted again.
+    class completion {
+    public:
+                    completion();
+
+                    completion(vk::Device                       device,
+                               vk::Fence                        fence,
+                               execution_time_t::host_timeline* timeline);
+
+        // Both isComplete and wait stamp the submission's completion time when they first see it
+        // complete.
+        bool        isComplete() const;
+
+        // Block until the submission completes, or until timeout expires. Returns true if the
+        // submission completed.
+        bool        wait(std::uint64_t timeout = std::numeric_limits<std::uint64_t>::max()) const;
+
+    private:
+        void        observeComplete() const;
+
+    private:
+        vk::Device                          mDevice;
+        vk::Fence                           mFence;
+        execution_time_t::host_timeline*    mTimeline = nullptr;
     };
 
     class invocation {
@@ -47,32 +98,77 @@ namespace clspv_utils {
 
                     ~invocation();
 
+        invocation& operator=(invocation&& other);
+
+        // Staged (gpu-only) buffers are uploaded from their staging shadow before the dispatch;
+        // storage buffers are also read back into it afterwards. The buffer must outlive the
+        // invocation's command buffer.
         void    addStorageBufferArgument(vulkan_utils::buffer& buffer);
         void    addUniformBufferArgument(vulkan_utils::buffer& buffer);
+        // Copy numBytes of data (typically a struct of scalar kernel arguments) into a range of the
+        // device's uniform ring, and pass that range. The range lives as long as the invocation.
+        void    addUniformBufferArgument(const void* data, vk::DeviceSize numBytes);
         void    addReadOnlyImageArgument(vulkan_utils::image& image);
         void    addWriteOnlyImageArgument(vulkan_utils::image& image);
         void    addSamplerArgument(vk::Sampler samp);
         void    addLocalArraySizeArgument(unsigned int numElements);
 
-        // Execute the invocation synchronously.
+        // Execute the invocation synchronously. Equivalent to record followed by replay.
         execution_time_t    run(const vk::Extent3D& num_workgroups);
 
+        // Record the invocation into a command buffer owned by the invocation. Once recorded, the
+        // invocation may be replayed any number of times without re-recording, provided its
+        // arguments remain valid. The command buffer returns each image argument to the layout it
+        // had when recorded, so that every replay's layout transitions start from the right one.
+        void                record(const vk::Extent3D& num_workgroups);
+
+        // Submit the most recently recorded command buffer and wait for it to complete.
+        execution_time_t    replay();
+
+        // Submit the most recently recorded command buffer without waiting for it to complete.
+        // Any number of invocations may be in flight on the device's queue at once. If this
+        // invocation is itself still in flight, submit first waits for that earlier submission.
+        completion          submit();
+
+        bool                isPending() const { return mIsPending; }
+
+        bool                isRecorded() const { return (bool)mCommandBuffer; }
+
         // Record the invocation into the command buffer. The client is responsible for submitting
         // the command buffer and waiting for completion.
         void                dispatch(vk::CommandBuffer commandBuffer,
                                      const vk::Extent3D& numWorkgroups);
 
+        // As above, but share barrier bookkeeping with the other dispatches and transfers recorded
+        // into the same command buffer through the tracker, so that no barrier is recorded where
+        // the earlier commands leave no hazard, e.g. for a uniform buffer read by several kernels.
+        void                dispatch(vk::CommandBuffer commandBuffer,
+                                     const vk::Extent3D& numWorkgroups,
+                                     vulkan_utils::resource_tracker& tracker);
+
         // Return the execution time from the most recently completed execution. Clients must be
-        // careful to avoid races if the invocation is dispatched multiple times!
+        // careful to avoid races if the invocation is dispatched multiple times! If a submission
+        // is still in flight, this waits for it to complete. Throws if the invocation has never
+        // been submitted.
         execution_time_t    getExecutionTime();
 
+        // As getExecutionTime, but never blocks. Returns false, leaving result untouched, if the
+        // invocation has never been submitted, its submission is still in flight, or the GPU
+        // has not yet written all of the timestamps.
+        bool                tryGetExecutionTime(execution_time_t& result);
+
 
         void    swap(invocation& other);
 
     private:
-        void    fillCommandBuffer(vk::CommandBuffer commandBuffer, const vk::Extent3D&    num_workgroups);
+        void    fillCommandBuffer(vk::CommandBuffer                 commandBuffer,
+                                  const vk::Extent3D&               num_workgroups,
+                                  vulkan_utils::resource_tracker&   tracker);
         void    updateDescriptorSets();
-        void    submitCommand(vk::CommandBuffer commandBuffer);
+        void    linkDescriptorInfo();
+        void    submitCommand(vk::CommandBuffer commandBuffer, vk::Fence fence);
+        void    waitForPending();
+        void    pollPending();
 
         // Sanity check that the nth argument (specified by ordinal) has the indicated
         // spvmap type. Throw an exception if false. Return the binding number if true.
@@ -91,17 +187,59 @@ namespace clspv_utils {
             kTimestamp_first = kTimestamp_startOfExecution
         };
 
+    private:
+        void    writeTimestamp(vk::CommandBuffer commandBuffer, Timestamp which);
+
+        void    setTimestamps(execution_time_t& result, const uint64_t* timestamps);
+        void    setStatistics(execution_time_t& result, uint64_t computeShaderInvocations);
+
     private:
         invocation_req_t                    mReq;
-        vk::UniqueQueryPool                 mQueryPool;
 
-        vector<vk::BufferMemoryBarrier>     mBufferMemoryBarriers;
-        vector<vk::ImageMemoryBarrier>      mImageMemoryBarriers;
+        // Borrowed from the device's query rings, and returned to them once the GPU is done. There
+        // is no statistics query where the device doesn't support them.
+        query_ring::allocation              mTimestamps;
+        query_ring::allocation              mStatistics;
+        uint64_t                            mExpectedInvocations    = 0;
+
+        // Allocated from the device's descriptor arena, and returned to it once the GPU is done.
+        // Invocations that push their descriptors have no set.
+        vk::DescriptorSet                   mArgumentsDescriptor;
+
+        // Keeps the most recently recorded pipeline alive even if the kernel evicts it
+        invocation_req_t::pipeline_ref      mPipeline;
+        vk::UniqueCommandBuffer             mCommandBuffer;
+        vk::UniqueFence                     mFence;
+        bool                                mIsPending      = false;
+        bool                                mHasSubmitted   = false;    // the queries hold this invocation's results
+
+        // Host events of the most recent submission
+        execution_time_t::host_timeline     mHostEvents;
+
+        // How the kernel uses its arguments; the tracker turns these into barriers at record time
+        struct buffer_use {
+            vk::Buffer          mBuffer;
+            vk::AccessFlags     mAccess;
+        };
+
+        struct image_use {
+            vulkan_utils::image*    mImage;
+            vk::AccessFlags         mAccess;
+            vk::ImageLayout         mLayout;
+        };
+
+        vector<buffer_use>                  mBufferUses;
+        vector<image_use>                   mImageUses;
+
+        vector<vulkan_utils::buffer*>       mUploadBuffers;
+        vector<vulkan_utils::buffer*>       mReadbackBuffers;
 
         vector<vk::DescriptorImageInfo>     mImageArgumentInfo;
         vector<vk::DescriptorBufferInfo>    mBufferArgumentInfo;
 
         vector<vk::WriteDescriptorSet>      mArgumentDescriptorWrites;
+        vector<uniform_ring::allocation>    mUniformAllocations;
+        vector<descriptor_info_t>           mArgumentUpdateData;
         vector<std::uint32_t>               mSpecConstantArguments;
     };
 
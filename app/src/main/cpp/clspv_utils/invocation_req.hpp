@@ -7,6 +7,7 @@
 
 #include "clspv_utils_fwd.hpp"
 
+#include "clspv_utils_interop.hpp"
 #include "device.hpp"
 
 #include <vulkan/vulkan.hpp>
@@ -15,17 +16,28 @@
 
 namespace clspv_utils {
 
+    // One slot of the data an argument update template reads from
+    union descriptor_info_t {
+        VkDescriptorImageInfo   mImage;
+        VkDescriptorBufferInfo  mBuffer;
+    };
+
     struct invocation_req_t {
-        typedef std::function<vk::Pipeline (vk::ArrayProxy<std::uint32_t>)> get_pipeline_fn;
+        typedef shared_ptr<vk::UniquePipeline>                                      pipeline_ref;
+        typedef std::function<pipeline_ref (vk::ArrayProxy<std::uint32_t>)>         get_pipeline_fn;
+
+        device                  mDevice;
+        kernel_spec_t           mKernelSpec;
 
-        device              mDevice;
-        kernel_spec_t       mKernelSpec;
+        vk::PipelineLayout      mPipelineLayout;
+        get_pipeline_fn         mGetPipelineFn;
+        vk::Extent3D            mWorkgroupSize;
 
-        vk::PipelineLayout  mPipelineLayout;
-        get_pipeline_fn     mGetPipelineFn;
+        vk::DescriptorSet       mLiteralSamplerDescriptor;
+        vk::DescriptorSetLayout mArgumentsLayout;
 
-        vk::DescriptorSet   mLiteralSamplerDescriptor;
-        vk::DescriptorSet   mArgumentsDescriptor;
+        descriptor_strategy             mDescriptorStrategy = descriptor_strategy::kWriteDescriptorSets;
+        vk::DescriptorUpdateTemplate    mArgumentsUpdateTemplate;
     };
 }
 
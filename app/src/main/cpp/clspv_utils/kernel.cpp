@@ -6,19 +6,8 @@
 
 #include "vulkan_utils/vulkan_utils.hpp"
 
-namespace {
-
-    vk::UniquePipelineLayout create_pipeline_layout(vk::Device                                      device,
-                                                    vk::ArrayProxy<const vk::DescriptorSetLayout>   layouts)
-    {
-        vk::PipelineLayoutCreateInfo createInfo;
-        createInfo.setSetLayoutCount(layouts.size())
-                .setPSetLayouts(layouts.data());
-
-        return device.createPipelineLayoutUnique(createInfo);
-    }
-
-}
+#include <algorithm>
+#include <iterator>
 
 namespace clspv_utils {
 
@@ -32,18 +21,37 @@ namespace clspv_utils {
             mSpecConstants({ workgroup_sizes.width, workgroup_sizes.height, workgroup_sizes.depth })
     {
         if (-1 != getKernelArgumentDescriptorSet(mReq.mKernelSpec.mArguments)) {
-            mArgumentsLayout = createKernelArgumentDescriptorLayout(mReq.mKernelSpec.mArguments, mReq.mDevice.getDevice());
-
-            mArgumentsDescriptor = allocateDescriptorSet(mReq.mDevice, *mArgumentsLayout);
+            mDescriptorStrategy = mReq.mDevice.selectDescriptorStrategy(mReq.mKernelSpec.mArguments);
+            mArgumentsLayout = createKernelArgumentDescriptorLayout(mReq.mKernelSpec.mArguments,
+                                                                    mReq.mDevice.getDevice(),
+                                                                    getDescriptorSetLayoutFlags(mDescriptorStrategy));
         }
 
         vector<vk::DescriptorSetLayout> layouts;
         if (mReq.mLiteralSamplerLayout) layouts.push_back(mReq.mLiteralSamplerLayout);
         if (mArgumentsLayout) layouts.push_back(*mArgumentsLayout);
-        mPipelineLayout = create_pipeline_layout(mReq.mDevice.getDevice(), layouts);
+        mPipelineLayout = vulkan_utils::create_pipeline_layout(mReq.mDevice.getDevice(), layouts);
+
+        if (mArgumentsLayout && descriptor_strategy::kUpdateTemplate == mDescriptorStrategy) {
+            const auto entries = getKernelArgumentUpdateTemplateEntries(mReq.mKernelSpec.mArguments,
+                                                                        sizeof(descriptor_info_t));
+
+            vk::DescriptorUpdateTemplateCreateInfo createInfo;
+            createInfo.setDescriptorUpdateEntryCount(entries.size())
+                    .setPDescriptorUpdateEntries(entries.empty() ? nullptr : entries.data())
+                    .setTemplateType(vk::DescriptorUpdateTemplateType::eDescriptorSet)
+                    .setDescriptorSetLayout(*mArgumentsLayout);
+
+            mArgumentsUpdateTemplate = mReq.mDevice.createDescriptorUpdateTemplate(createInfo);
+        }
     }
 
     kernel::~kernel() {
+        mReq.mDevice.destroyDescriptorUpdateTemplate(mArgumentsUpdateTemplate);
+
+        if (mArgumentsLayout) {
+            mReq.mDevice.getDescriptorArena().forget(*mArgumentsLayout);
+        }
     }
 
     kernel::kernel(kernel &&other)
@@ -63,11 +71,14 @@ namespace clspv_utils {
         using std::swap;
 
         swap(mReq, other.mReq);
+        swap(mDescriptorStrategy, other.mDescriptorStrategy);
         swap(mArgumentsLayout, other.mArgumentsLayout);
-        swap(mArgumentsDescriptor, other.mArgumentsDescriptor);
+        swap(mArgumentsUpdateTemplate, other.mArgumentsUpdateTemplate);
         swap(mPipelineLayout, other.mPipelineLayout);
-        swap(mPipeline, other.mPipeline);
         swap(mSpecConstants, other.mSpecConstants);
+        swap(mPipelines, other.mPipelines);
+        swap(mPipelineCapacity, other.mPipelineCapacity);
+        swap(mPipelineStats, other.mPipelineStats);
     }
 
     invocation_req_t kernel::createInvocationReq() {
@@ -77,37 +88,63 @@ namespace clspv_utils {
         result.mKernelSpec = mReq.mKernelSpec;
         result.mPipelineLayout = *mPipelineLayout;
         result.mGetPipelineFn = std::bind(&kernel::updatePipeline, this, std::placeholders::_1);
+        result.mWorkgroupSize = getWorkgroupSize();
         result.mLiteralSamplerDescriptor = mReq.mLiteralSamplerDescriptor;
-        result.mArgumentsDescriptor = *mArgumentsDescriptor;
+        result.mArgumentsLayout = *mArgumentsLayout;
+        result.mDescriptorStrategy = mDescriptorStrategy;
+        result.mArgumentsUpdateTemplate = mArgumentsUpdateTemplate;
 
         return result;
     }
 
-    vk::Pipeline kernel::updatePipeline(vk::ArrayProxy<uint32_t> otherSpecConstants) {
-        // TODO Consider case where there are multiple invocations active at one.
-        // In that case, we should not delete the previous pipeline!
-        // Thus, the pipeline really needs to be in a shared state.
-
-        // If the spec constants being passed are equal to the spec constants we already have,
-        // the existing pipeline is up to date.
-        if (mPipeline
-            && mSpecConstants.size() == otherSpecConstants.size() + 3
-            && std::equal(std::next(mSpecConstants.begin(), 3), mSpecConstants.end(),
-                                    otherSpecConstants.begin()) ) {
-            return *mPipeline;
+    kernel::pipeline_ref kernel::updatePipeline(vk::ArrayProxy<uint32_t> otherSpecConstants) {
+        // The first three spec constants are always the workgroup size.
+        spec_constant_list specConstants(mSpecConstants.begin(), std::next(mSpecConstants.begin(), 3));
+        specConstants.insert(specConstants.end(), otherSpecConstants.begin(), otherSpecConstants.end());
+
+        auto found = std::find_if(mPipelines.begin(), mPipelines.end(),
+                                  [&specConstants](const pipeline_list::value_type& entry) {
+                                      return entry.first == specConstants;
+                                  });
+        if (found != mPipelines.end()) {
+            ++mPipelineStats.mHits;
+            mPipelines.splice(mPipelines.begin(), mPipelines, found);
+            return mPipelines.front().second;
         }
 
-        mSpecConstants.resize(3 + otherSpecConstants.size());
-        std::copy(otherSpecConstants.begin(), otherSpecConstants.end(), std::next(mSpecConstants.begin(), 3));
+        ++mPipelineStats.mMisses;
+
+        pipeline_ref pipeline = std::make_shared<vk::UniquePipeline>(
+                vulkan_utils::create_compute_pipeline(mReq.mDevice.getDevice(),
+                                                      mReq.mShaderModule,
+                                                      mReq.mKernelSpec.mName.c_str(),
+                                                      *mPipelineLayout,
+                                                      mReq.mPipelineCache,
+                                                      specConstants));
+
+        // Make room before inserting, so that the new pipeline is never the one evicted.
+        evictPipelines(mPipelineCapacity > 0 ? mPipelineCapacity - 1 : 0);
+        mPipelines.emplace_front(std::move(specConstants), pipeline);
+
+        return pipeline;
+    }
 
-        mPipeline = vulkan_utils::create_compute_pipeline(mReq.mDevice.getDevice(),
-                                                          mReq.mShaderModule,
-                                                          mReq.mKernelSpec.mName.c_str(),
-                                                          *mPipelineLayout,
-                                                          mReq.mPipelineCache,
-                                                          mSpecConstants);
+    void kernel::setPipelineCapacity(std::size_t capacity) {
+        if (0 == capacity) {
+            fail_runtime_error("kernel pipeline capacity must be at least one");
+        }
 
-        return *mPipeline;
+        mPipelineCapacity = capacity;
+        evictPipelines(mPipelineCapacity);
+    }
+
+    void kernel::evictPipelines(std::size_t capacity) {
+        // Evicted pipelines still referenced by an invocation stay alive until that reference
+        // is released.
+        while (mPipelines.size() > capacity) {
+            mPipelines.pop_back();
+            ++mPipelineStats.mEvictions;
+        }
     }
 
 } // namespace clspv_utils
@@ -15,10 +15,23 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include <list>
+#include <utility>
+
 namespace clspv_utils {
 
     class kernel {
     public:
+        typedef invocation_req_t::pipeline_ref  pipeline_ref;
+
+        struct pipeline_stats_t {
+            std::size_t mHits       = 0;
+            std::size_t mMisses     = 0;
+            std::size_t mEvictions  = 0;
+        };
+
+        static const std::size_t kDefaultPipelineCapacity = 8;
+
                             kernel();
 
                             kernel(kernel_req_t         layout,
@@ -35,22 +48,40 @@ namespace clspv_utils {
 
         const device&       getDevice() { return mReq.mDevice; }
 
-        vk::Pipeline        updatePipeline(vk::ArrayProxy<uint32_t> otherSpecConstants);
+        // Return the pipeline specialized for the workgroup size and the given additional spec
+        // constants, creating it if necessary. The kernel keeps the most recently used pipelines
+        // alive; callers that record the pipeline into a command buffer must hold the returned
+        // reference until that command buffer completes.
+        pipeline_ref        updatePipeline(vk::ArrayProxy<uint32_t> otherSpecConstants);
+
+        std::size_t         getPipelineCapacity() const { return mPipelineCapacity; }
+        void                setPipelineCapacity(std::size_t capacity);
+
+        const pipeline_stats_t& getPipelineStats() const { return mPipelineStats; }
 
         void                swap(kernel& other);
 
         invocation_req_t    createInvocationReq();
 
     private:
-        typedef vector<std::uint32_t>   spec_constant_list;
+        typedef vector<std::uint32_t>                           spec_constant_list;
+        typedef std::list<std::pair<spec_constant_list, pipeline_ref> > pipeline_list;
+
+    private:
+        void                evictPipelines(std::size_t capacity);
 
     private:
         kernel_req_t                    mReq;
+        descriptor_strategy             mDescriptorStrategy = descriptor_strategy::kWriteDescriptorSets;
         vk::UniqueDescriptorSetLayout   mArgumentsLayout;
-        vk::UniqueDescriptorSet         mArgumentsDescriptor;
+        vk::DescriptorUpdateTemplate    mArgumentsUpdateTemplate;
         vk::UniquePipelineLayout        mPipelineLayout;
-        vk::UniquePipeline              mPipeline;
         spec_constant_list              mSpecConstants;
+
+        // Most recently used first
+        pipeline_list                   mPipelines;
+        std::size_t                     mPipelineCapacity   = kDefaultPipelineCapacity;
+        pipeline_stats_t                mPipelineStats;
     };
 
     inline void swap(kernel& lhs, kernel& rhs)
@@ -6,16 +6,22 @@
 
 #include "interface.hpp"
 #include "kernel_req.hpp"
+#include "pipeline_cache.hpp"
 
+#include "vulkan_utils/vulkan_utils.hpp"
+
+#include <algorithm>
+#include <atomic>
 #include <istream>
 #include <functional>
 #include <memory>
+#include <system_error>
+#include <thread>
 
 namespace {
     using namespace clspv_utils;
 
-    vk::UniqueShaderModule create_shader(vk::Device     device,
-                                         std::istream&  in)
+    vector<std::uint32_t> read_spv(std::istream& in)
     {
         const auto savePos = in.tellg();
         in.seekg(0, std::ios_base::end);
@@ -31,14 +37,39 @@ namespace {
 
         in.read(reinterpret_cast<char*>(spvModule.data()), num_bytes);
 
+        return spvModule;
+    }
+
+    vk::UniqueShaderModule create_shader(vk::Device                     device,
+                                         const vector<std::uint32_t>&   spvModule)
+    {
         vk::ShaderModuleCreateInfo shaderModuleCreateInfo;
-        shaderModuleCreateInfo.setCodeSize(spvModule.size() * sizeof(decltype(spvModule)::value_type))
+        shaderModuleCreateInfo.setCodeSize(spvModule.size() * sizeof(std::uint32_t))
                 .setPCode(spvModule.data());
 
         return device.createShaderModuleUnique(shaderModuleCreateInfo);
     }
 
 
+    struct prebuild_layout {
+        vk::UniqueDescriptorSetLayout   mArgumentsLayout;
+        vk::UniquePipelineLayout        mPipelineLayout;
+        string                          mExceptionString;
+    };
+
+    string current_exception_to_string()
+    {
+        try {
+            throw;
+        }
+        catch (const std::exception& e) {
+            return e.what();
+        }
+        catch (...) {
+            return "unknown exception";
+        }
+    }
+
 } // anonymous namespace
 
 namespace clspv_utils {
@@ -65,12 +96,25 @@ namespace clspv_utils {
         mLiteralSamplerDescriptor = literalSamplerDescriptorGroup.mDescriptor;
         mLiteralSamplerDescriptorLayout = literalSamplerDescriptorGroup.mLayout;
 
-        mShaderModule = create_shader(mDevice.getDevice(), spvmoduleStream);
-        mPipelineCache = mDevice.getDevice().createPipelineCacheUnique(vk::PipelineCacheCreateInfo());
+        const auto spvModule = read_spv(spvmoduleStream);
+        mShaderModule = create_shader(mDevice.getDevice(), spvModule);
+
+        mPipelineCacheKey = createPipelineCacheKey(mDevice.getPhysicalDevice(), spvModule);
+        if (!mDevice.getPipelineCacheDirectory().empty()) {
+            mPipelineCachePath = getPipelineCachePath(mDevice.getPipelineCacheDirectory(), mPipelineCacheKey);
+        }
+        mPipelineCache = loadPipelineCache(mDevice.getDevice(), mPipelineCachePath, mPipelineCacheKey, &mPipelineCacheStatus);
     }
 
     module::~module()
     {
+        // Destructors must not throw; a cache that cannot be saved just means the next run
+        // compiles its pipelines from scratch.
+        try {
+            savePipelineCache();
+        }
+        catch (...) {
+        }
     }
 
     module& module::operator=(module&& other)
@@ -89,6 +133,124 @@ namespace clspv_utils {
         swap(mLiteralSamplerDescriptor, other.mLiteralSamplerDescriptor);
         swap(mShaderModule, other.mShaderModule);
         swap(mPipelineCache, other.mPipelineCache);
+        swap(mPipelineCacheKey, other.mPipelineCacheKey);
+        swap(mPipelineCachePath, other.mPipelineCachePath);
+        swap(mPipelineCacheStatus, other.mPipelineCacheStatus);
+    }
+
+    bool module::savePipelineCache() const
+    {
+        if (!mPipelineCache || mPipelineCachePath.empty()) {
+            return false;
+        }
+
+        return clspv_utils::savePipelineCache(mDevice.getDevice(), *mPipelineCache, mPipelineCachePath, mPipelineCacheKey);
+    }
+
+    vector<pipeline_build_result_t> module::prebuildPipelines(const vector<pipeline_variant_t>& variants,
+                                                              unsigned int                      numThreads) const
+    {
+        if (!isLoaded()) {
+            fail_runtime_error("cannot prebuild pipelines for unloaded module");
+        }
+
+        const vk::Device device = mDevice.getDevice();
+
+        vector<pipeline_build_result_t> results(variants.size());
+
+        // Layouts are created up front, on this thread, one per entry point. Only pipeline creation
+        // itself runs in parallel; the pipeline cache is internally synchronized.
+        map<string, prebuild_layout> layouts;
+        for (std::size_t i = 0; i < variants.size(); ++i) {
+            results[i].mVariant = variants[i];
+
+            const string& entryPoint = variants[i].mEntryPoint;
+            if (0 == layouts.count(entryPoint)) {
+                prebuild_layout& layout = layouts[entryPoint];
+
+                try {
+                    const auto kernelSpec = findKernelSpec(entryPoint, mModuleSpec.mKernels);
+                    if (!kernelSpec) {
+                        fail_runtime_error("cannot prebuild pipeline for unknown entry point");
+                    }
+
+                    if (-1 != getKernelArgumentDescriptorSet(kernelSpec->mArguments)) {
+                        // Match the layout the kernel will create, so that cached pipelines stay compatible
+                        const auto strategy = mDevice.selectDescriptorStrategy(kernelSpec->mArguments);
+                        layout.mArgumentsLayout = createKernelArgumentDescriptorLayout(kernelSpec->mArguments,
+                                                                                       device,
+                                                                                       getDescriptorSetLayoutFlags(strategy));
+                    }
+
+                    vector<vk::DescriptorSetLayout> setLayouts;
+                    if (mLiteralSamplerDescriptorLayout) setLayouts.push_back(mLiteralSamplerDescriptorLayout);
+                    if (layout.mArgumentsLayout) setLayouts.push_back(*layout.mArgumentsLayout);
+                    layout.mPipelineLayout = vulkan_utils::create_pipeline_layout(device, setLayouts);
+                }
+                catch (...) {
+                    layout.mExceptionString = current_exception_to_string();
+                }
+            }
+
+            results[i].mExceptionString = layouts[entryPoint].mExceptionString;
+        }
+
+        std::atomic<std::size_t> nextVariant(0);
+        auto buildPipelines = [&](unsigned int worker) {
+            for (std::size_t i = nextVariant++; i < results.size(); i = nextVariant++) {
+                pipeline_build_result_t& result = results[i];
+                if (!result.mExceptionString.empty()) {
+                    continue;
+                }
+
+                const pipeline_variant_t& variant = result.mVariant;
+
+                vector<std::uint32_t> specConstants = { variant.mWorkgroupSize.width,
+                                                        variant.mWorkgroupSize.height,
+                                                        variant.mWorkgroupSize.depth };
+                specConstants.insert(specConstants.end(), variant.mSpecConstants.begin(), variant.mSpecConstants.end());
+
+                result.mWorker = worker;
+                result.mBuildBegin = std::chrono::steady_clock::now();
+                try {
+                    vulkan_utils::create_compute_pipeline(device,
+                                                          *mShaderModule,
+                                                          variant.mEntryPoint.c_str(),
+                                                          *layouts.find(variant.mEntryPoint)->second.mPipelineLayout,
+                                                          *mPipelineCache,
+                                                          specConstants);
+                    result.mBuildEnd = std::chrono::steady_clock::now();
+                    result.mCompileTime = result.mBuildEnd - result.mBuildBegin;
+                }
+                catch (...) {
+                    result.mBuildEnd = std::chrono::steady_clock::now();
+                    result.mExceptionString = current_exception_to_string();
+                }
+            }
+        };
+
+        if (0 == numThreads) {
+            numThreads = std::max(1U, std::thread::hardware_concurrency());
+        }
+        numThreads = static_cast<unsigned int>(std::min<std::size_t>(numThreads, results.size()));
+
+        // This thread is one of the builders.
+        vector<std::thread> builders;
+        for (unsigned int t = 1; t < numThreads; ++t) {
+            try {
+                builders.emplace_back(buildPipelines, t);
+            }
+            catch (const std::system_error&) {
+                // Out of threads; make do with the builders already running.
+                break;
+            }
+        }
+        buildPipelines(0);
+        for (auto& b : builders) {
+            b.join();
+        }
+
+        return results;
     }
 
     vector<string> module::getEntryPoints() const
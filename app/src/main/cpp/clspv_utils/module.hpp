@@ -10,13 +10,30 @@
 #include "clspv_utils_interop.hpp"
 #include "device.hpp"
 #include "interface.hpp"
+#include "pipeline_cache.hpp"
 
 #include <vulkan/vulkan.hpp>
 
+#include <chrono>
 #include <iosfwd>
 
 namespace clspv_utils {
 
+    struct pipeline_variant_t {
+        string                  mEntryPoint;
+        vk::Extent3D            mWorkgroupSize;
+        vector<std::uint32_t>   mSpecConstants;     // spec constants following the workgroup size
+    };
+
+    struct pipeline_build_result_t {
+        pipeline_variant_t                      mVariant;
+        std::chrono::duration<double>           mCompileTime        = std::chrono::duration<double>(0);
+        std::chrono::steady_clock::time_point   mBuildBegin;        // unset if the build never started
+        std::chrono::steady_clock::time_point   mBuildEnd;
+        unsigned int                            mWorker             = 0;    // builder thread; 0 is the caller's
+        string                                  mExceptionString;   // empty if the pipeline compiled
+    };
+
     class module {
     public:
                             module();
@@ -39,6 +56,19 @@ namespace clspv_utils {
 
         kernel_req_t        createKernelReq(const string &entryPoint) const;
 
+        // Compile the pipelines for the requested variants into the module's pipeline cache, using
+        // up to numThreads threads (0 means one per hardware thread). Kernels later created from
+        // this module then find their pipelines in the cache instead of compiling on first
+        // dispatch. Failures are reported per variant rather than thrown.
+        vector<pipeline_build_result_t> prebuildPipelines(const vector<pipeline_variant_t>& variants,
+                                                          unsigned int                      numThreads = 0) const;
+
+        pipeline_cache_status   getPipelineCacheStatus() const { return mPipelineCacheStatus; }
+
+        // Write the pipeline cache to the device's pipeline cache directory. This also happens
+        // automatically when the module is destroyed. Returns false if nothing was written.
+        bool                savePipelineCache() const;
+
     private:
         device                  mDevice;
         module_spec_t           mModuleSpec;
@@ -47,6 +77,9 @@ namespace clspv_utils {
         vk::DescriptorSet       mLiteralSamplerDescriptor;
         vk::UniqueShaderModule  mShaderModule;
         vk::UniquePipelineCache mPipelineCache;
+        pipeline_cache_key_t    mPipelineCacheKey;
+        string                  mPipelineCachePath;
+        pipeline_cache_status   mPipelineCacheStatus = pipeline_cache_status::kNotPersisted;
     };
 
     inline void swap(module& lhs, module& rhs)
@@ -0,0 +1,255 @@
+#include "pipeline_cache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+    using namespace clspv_utils;
+
+    const char          kFileMagic[4]       = { 'C', 'L', 'P', 'C' };
+    const std::uint32_t kFileFormatVersion  = 1;
+
+    // Every blob written to disk begins with this header. The pipeline cache data that Vulkan
+    // returned follows immediately after it.
+    struct file_header_t {
+        char            mMagic[4];
+        std::uint32_t   mFormatVersion;
+        std::uint64_t   mContentHash;
+        std::uint32_t   mVendorID;
+        std::uint32_t   mDeviceID;
+        std::uint32_t   mDriverVersion;
+        std::uint32_t   mReserved;
+        std::uint8_t    mPipelineCacheUUID[VK_UUID_SIZE];
+        std::uint64_t   mDataSize;
+        std::uint64_t   mDataChecksum;
+    };
+
+    // The header Vulkan itself places at the start of pipeline cache data
+    // (VK_PIPELINE_CACHE_HEADER_VERSION_ONE).
+    struct vulkan_cache_header_t {
+        std::uint32_t   mHeaderSize;
+        std::uint32_t   mHeaderVersion;
+        std::uint32_t   mVendorID;
+        std::uint32_t   mDeviceID;
+        std::uint8_t    mPipelineCacheUUID[VK_UUID_SIZE];
+    };
+
+    const std::uint64_t kFnvOffsetBasis = 0xcbf29ce484222325ULL;
+    const std::uint64_t kFnvPrime       = 0x100000001b3ULL;
+
+    std::uint64_t fnv1a_hash(const void* data, std::size_t numBytes, std::uint64_t hash = kFnvOffsetBasis)
+    {
+        auto bytes = static_cast<const std::uint8_t*>(data);
+        for (std::size_t i = 0; i < numBytes; ++i) {
+            hash ^= bytes[i];
+            hash *= kFnvPrime;
+        }
+        return hash;
+    }
+
+    bool matches_key(const file_header_t& header, const pipeline_cache_key_t& key)
+    {
+        return header.mContentHash == key.mContentHash
+               && header.mVendorID == key.mVendorID
+               && header.mDeviceID == key.mDeviceID
+               && header.mDriverVersion == key.mDriverVersion
+               && 0 == std::memcmp(header.mPipelineCacheUUID, key.mPipelineCacheUUID, VK_UUID_SIZE);
+    }
+
+    bool matches_key(const vector<std::uint8_t>& data, const pipeline_cache_key_t& key)
+    {
+        vulkan_cache_header_t header;
+        if (data.size() < sizeof(header)) {
+            return false;
+        }
+        std::memcpy(&header, data.data(), sizeof(header));
+
+        return header.mHeaderSize >= sizeof(header)
+               && header.mHeaderSize <= data.size()
+               && header.mHeaderVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+               && header.mVendorID == key.mVendorID
+               && header.mDeviceID == key.mDeviceID
+               && 0 == std::memcmp(header.mPipelineCacheUUID, key.mPipelineCacheUUID, VK_UUID_SIZE);
+    }
+
+    // Returns true, and fills in data, only if the blob at path is intact and was written for key.
+    bool read_cache_data(const string& path, const pipeline_cache_key_t& key, vector<std::uint8_t>& data)
+    {
+        std::ifstream in(path, std::ios::in | std::ios::binary);
+        if (!in.good()) {
+            return false;
+        }
+
+        file_header_t header;
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            return false;
+        }
+
+        if (0 != std::memcmp(header.mMagic, kFileMagic, sizeof(kFileMagic))
+            || header.mFormatVersion != kFileFormatVersion
+            || !matches_key(header, key)) {
+            return false;
+        }
+
+        // Guard against a truncated or padded file before trusting mDataSize for an allocation.
+        const auto dataStart = in.tellg();
+        in.seekg(0, std::ios::end);
+        const auto dataSize = static_cast<std::uint64_t>(in.tellg() - dataStart);
+        in.seekg(dataStart, std::ios::beg);
+        if (dataSize != header.mDataSize) {
+            return false;
+        }
+
+        data.resize(static_cast<std::size_t>(dataSize));
+        if (!in.read(reinterpret_cast<char*>(data.data()), data.size())) {
+            return false;
+        }
+
+        return header.mDataChecksum == fnv1a_hash(data.data(), data.size())
+               && matches_key(data, key);
+    }
+
+} // anonymous namespace
+
+namespace clspv_utils {
+
+    pipeline_cache_key_t createPipelineCacheKey(vk::PhysicalDevice                  physicalDevice,
+                                                vk::ArrayProxy<const std::uint32_t> spvModule)
+    {
+        const auto properties = physicalDevice.getProperties();
+
+        pipeline_cache_key_t result;
+        result.mContentHash = fnv1a_hash(spvModule.data(), spvModule.size() * sizeof(std::uint32_t));
+        result.mVendorID = properties.vendorID;
+        result.mDeviceID = properties.deviceID;
+        result.mDriverVersion = properties.driverVersion;
+        std::memcpy(result.mPipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+        return result;
+    }
+
+    string getPipelineCachePath(const string& directory, const pipeline_cache_key_t& key)
+    {
+        std::uint64_t hash = key.mContentHash;
+        hash = fnv1a_hash(&key.mVendorID, sizeof(key.mVendorID), hash);
+        hash = fnv1a_hash(&key.mDeviceID, sizeof(key.mDeviceID), hash);
+        hash = fnv1a_hash(&key.mDriverVersion, sizeof(key.mDriverVersion), hash);
+        hash = fnv1a_hash(key.mPipelineCacheUUID, sizeof(key.mPipelineCacheUUID), hash);
+
+        std::ostringstream os;
+        os << directory;
+        if (!directory.empty() && directory.back() != '/') {
+            os << '/';
+        }
+        os << std::hex << std::setfill('0') << std::setw(16) << hash << ".pipelinecache";
+
+        return os.str();
+    }
+
+    const char* to_string(pipeline_cache_status status)
+    {
+        switch (status) {
+            case pipeline_cache_status::kNotPersisted:  return "not-persisted";
+            case pipeline_cache_status::kMissing:       return "missing";
+            case pipeline_cache_status::kRejected:      return "rejected";
+            case pipeline_cache_status::kLoaded:        return "loaded";
+        }
+        return "unknown";
+    }
+
+    vk::UniquePipelineCache loadPipelineCache(vk::Device                    device,
+                                              const string&                 path,
+                                              const pipeline_cache_key_t&   key,
+                                              pipeline_cache_status*        outStatus)
+    {
+        pipeline_cache_status status = pipeline_cache_status::kNotPersisted;
+        vector<std::uint8_t> data;
+
+        if (!path.empty()) {
+            if (!std::ifstream(path).good()) {
+                status = pipeline_cache_status::kMissing;
+            }
+            else if (read_cache_data(path, key, data)) {
+                status = pipeline_cache_status::kLoaded;
+            }
+            else {
+                status = pipeline_cache_status::kRejected;
+                data.clear();
+            }
+        }
+
+        vk::PipelineCacheCreateInfo createInfo;
+        createInfo.setInitialDataSize(data.size())
+                .setPInitialData(data.empty() ? nullptr : data.data());
+
+        vk::UniquePipelineCache result;
+        try {
+            result = device.createPipelineCacheUnique(createInfo);
+        }
+        catch (const vk::SystemError&) {
+            // The driver has the final say on whether the data is usable. If it refuses, fall
+            // back to an empty cache rather than failing the module load.
+            if (data.empty()) {
+                throw;
+            }
+
+            status = pipeline_cache_status::kRejected;
+            result = device.createPipelineCacheUnique(vk::PipelineCacheCreateInfo());
+        }
+
+        if (outStatus) {
+            *outStatus = status;
+        }
+
+        return result;
+    }
+
+    bool savePipelineCache(vk::Device                   device,
+                           vk::PipelineCache            pipelineCache,
+                           const string&                path,
+                           const pipeline_cache_key_t&  key)
+    {
+        if (path.empty() || !pipelineCache) {
+            return false;
+        }
+
+        const auto data = device.getPipelineCacheData(pipelineCache);
+
+        file_header_t header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.mMagic, kFileMagic, sizeof(kFileMagic));
+        header.mFormatVersion = kFileFormatVersion;
+        header.mContentHash = key.mContentHash;
+        header.mVendorID = key.mVendorID;
+        header.mDeviceID = key.mDeviceID;
+        header.mDriverVersion = key.mDriverVersion;
+        std::memcpy(header.mPipelineCacheUUID, key.mPipelineCacheUUID, VK_UUID_SIZE);
+        header.mDataSize = data.size();
+        header.mDataChecksum = fnv1a_hash(data.data(), data.size());
+
+        // Write to a temporary file and rename it into place, so that a reader never sees a
+        // partially written blob.
+        const string tempPath = path + ".tmp";
+        {
+            std::ofstream out(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(data.data()), data.size());
+            out.close();
+            if (!out) {
+                std::remove(tempPath.c_str());
+                return false;
+            }
+        }
+
+        if (0 != std::rename(tempPath.c_str(), path.c_str())) {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+} // namespace clspv_utils
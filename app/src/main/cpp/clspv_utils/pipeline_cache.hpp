@@ -0,0 +1,54 @@
+#ifndef CLSPVUTILS_PIPELINE_CACHE_HPP
+#define CLSPVUTILS_PIPELINE_CACHE_HPP
+
+#include "clspv_utils_fwd.hpp"
+
+#include "clspv_utils_interop.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+
+namespace clspv_utils {
+
+    // Identifies the pipeline cache blob that belongs to a particular SPIR-V module running on a
+    // particular device and driver. A blob saved under one key is never loaded under another.
+    struct pipeline_cache_key_t {
+        std::uint64_t   mContentHash    = 0;
+        std::uint32_t   mVendorID       = 0;
+        std::uint32_t   mDeviceID       = 0;
+        std::uint32_t   mDriverVersion  = 0;
+        std::uint8_t    mPipelineCacheUUID[VK_UUID_SIZE] = {};
+    };
+
+    enum class pipeline_cache_status {
+        kNotPersisted,  // no cache directory configured
+        kMissing,       // no blob on disk for this key
+        kRejected,      // blob on disk was stale or corrupt, and was ignored
+        kLoaded         // blob on disk was loaded into the pipeline cache
+    };
+
+    const char*             to_string(pipeline_cache_status status);
+
+    pipeline_cache_key_t    createPipelineCacheKey(vk::PhysicalDevice                   physicalDevice,
+                                                   vk::ArrayProxy<const std::uint32_t>  spvModule);
+
+    string                  getPipelineCachePath(const string&               directory,
+                                                 const pipeline_cache_key_t& key);
+
+    // Create a pipeline cache, seeded from the blob at path if that blob exists and was written for
+    // key. A missing, stale, or corrupt blob results in an empty pipeline cache.
+    vk::UniquePipelineCache loadPipelineCache(vk::Device                    device,
+                                              const string&                 path,
+                                              const pipeline_cache_key_t&   key,
+                                              pipeline_cache_status*        outStatus = nullptr);
+
+    // Returns false if the blob could not be written.
+    bool                    savePipelineCache(vk::Device                    device,
+                                              vk::PipelineCache             pipelineCache,
+                                              const string&                 path,
+                                              const pipeline_cache_key_t&   key);
+
+}
+
+#endif //CLSPVUTILS_PIPELINE_CACHE_HPP
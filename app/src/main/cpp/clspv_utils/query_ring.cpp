@@ -0,0 +1,138 @@
+#include "query_ring.hpp"
+
+#include "vulkan_utils/vulkan_utils.hpp"
+
+#include <algorithm>
+
+namespace {
+
+    const std::uint32_t kInitialPoolSize = 256;
+
+} // anonymous namespace
+
+namespace clspv_utils {
+
+    query_ring::query_ring(vk::Device                       device,
+                           vk::QueryType                    queryType,
+                           vk::QueryPipelineStatisticFlags  statistics,
+                           bool                             isSupported,
+                           std::uint64_t                    resultMask)
+            : mDevice(device),
+              mQueryType(queryType),
+              mStatistics(statistics),
+              mIsSupported(isSupported),
+              mResultMask(resultMask),
+              mRing(kInitialPoolSize)
+    {
+        if (vk::QueryType::ePipelineStatistics == mQueryType) {
+            mValuesPerQuery = 0;
+            for (VkQueryPipelineStatisticFlags bits = static_cast<VkQueryPipelineStatisticFlags>(mStatistics); bits; bits &= bits - 1) {
+                ++mValuesPerQuery;
+            }
+        }
+    }
+
+    query_ring::allocation query_ring::allocate(std::uint32_t numQueries)
+    {
+        if (0 == numQueries) {
+            fail_runtime_error("cannot allocate an empty run of queries");
+        }
+
+        const auto run = mRing.allocate(numQueries, [this](std::uint32_t capacity) {
+            return createPool(capacity);
+        });
+
+        if (mHostReset) {
+            mHostReset(**run.mResources, run.mOffset, numQueries);
+        }
+
+        ++mStats.mNumAllocations;
+        mStats.mQueriesOutstanding += numQueries;
+        mStats.mPeakQueriesOutstanding = std::max(mStats.mPeakQueriesOutstanding, mStats.mQueriesOutstanding);
+
+        allocation result;
+        result.mPool = **run.mResources;
+        result.mFirstQuery = run.mOffset;
+        result.mCount = numQueries;
+        result.mBlockId = run.mBlockId;
+        return result;
+    }
+
+    void query_ring::release(const allocation& run)
+    {
+        std::uint32_t numQueries = 0;
+        if (!mRing.release(run.mBlockId, run.mFirstQuery, numQueries)) {
+            fail_runtime_error("queries are not outstanding in this ring");
+        }
+
+        mStats.mQueriesOutstanding -= numQueries;
+    }
+
+    bool query_ring::tryGetResults(const allocation& run, std::uint64_t* results)
+    {
+        const std::uint32_t stride = mValuesPerQuery + 1;
+        mResultScratch.resize(stride * run.mCount);
+
+        const vk::Result status = mDevice.getQueryPoolResults(run.mPool,
+                                                              run.mFirstQuery,
+                                                              run.mCount,
+                                                              mResultScratch.size() * sizeof(std::uint64_t),
+                                                              mResultScratch.data(),
+                                                              stride * sizeof(std::uint64_t),
+                                                              vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability);
+        if (vk::Result::eSuccess != status && vk::Result::eNotReady != status) {
+            vk::createResultValue(status, "clspv_utils::query_ring::tryGetResults");
+        }
+
+        for (std::uint32_t i = 0; i < run.mCount; ++i) {
+            if (0 == mResultScratch[stride * i + mValuesPerQuery]) {
+                ++mStats.mNumNotReady;
+                return false;
+            }
+        }
+
+        for (std::uint32_t i = 0; i < run.mCount; ++i) {
+            for (std::uint32_t v = 0; v < mValuesPerQuery; ++v) {
+                results[mValuesPerQuery * i + v] = mResultScratch[stride * i + v] & mResultMask;
+            }
+        }
+
+        ++mStats.mNumHarvests;
+        return true;
+    }
+
+    void query_ring::getResults(const allocation& run, std::uint64_t* results)
+    {
+        const std::uint32_t numValues = mValuesPerQuery * run.mCount;
+
+        const vk::Result status = mDevice.getQueryPoolResults(run.mPool,
+                                                              run.mFirstQuery,
+                                                              run.mCount,
+                                                              numValues * sizeof(std::uint64_t),
+                                                              results,
+                                                              mValuesPerQuery * sizeof(std::uint64_t),
+                                                              vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+        vk::createResultValue(status, "clspv_utils::query_ring::getResults");
+
+        for (std::uint32_t i = 0; i < numValues; ++i) {
+            results[i] &= mResultMask;
+        }
+
+        ++mStats.mNumHarvests;
+    }
+
+    vk::UniqueQueryPool query_ring::createPool(std::uint32_t capacity)
+    {
+        vk::QueryPoolCreateInfo poolCreateInfo;
+        poolCreateInfo.setQueryType(mQueryType)
+                .setQueryCount(capacity)
+                .setPipelineStatistics(mStatistics);
+
+        vk::UniqueQueryPool result = mDevice.createQueryPoolUnique(poolCreateInfo);
+
+        ++mStats.mNumPoolsCreated;
+
+        return result;
+    }
+
+} // namespace clspv_utils
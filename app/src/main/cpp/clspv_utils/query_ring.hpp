@@ -0,0 +1,110 @@
+#ifndef CLSPVUTILS_QUERY_RING_HPP
+#define CLSPVUTILS_QUERY_RING_HPP
+
+#include "clspv_utils_fwd.hpp"
+
+#include "clspv_utils_interop.hpp"
+#include "range_ring.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+
+namespace clspv_utils {
+
+    // Hands out runs of consecutive queries of one kind, such as timestamps, so that invocations
+    // need not each create a query pool. Runs come from a range_ring, whose blocks are query pools.
+    //
+    // Clients reset a run's queries in the command buffer that writes them.
+    class query_ring {
+    public:
+        struct allocation {
+            vk::QueryPool   mPool;
+            std::uint32_t   mFirstQuery = 0;
+            std::uint32_t   mCount      = 0;
+            std::uint64_t   mBlockId    = 0;
+        };
+
+        struct stats_t {
+            std::uint64_t   mNumAllocations         = 0;
+            std::uint64_t   mNumPoolsCreated        = 0;
+            std::uint64_t   mNumHarvests            = 0;    // result sets read back
+            std::uint64_t   mNumNotReady            = 0;    // non-blocking reads that found results unavailable
+            std::uint64_t   mQueriesOutstanding     = 0;    // allocated and not yet released
+            std::uint64_t   mPeakQueriesOutstanding = 0;
+        };
+
+        // Pipeline statistics queries yield one value per statistic; other kinds yield one value
+        // per query. isSupported is false for a kind of query the device cannot perform (e.g.
+        // pipeline statistics without the pipelineStatisticsQuery feature). Timestamp rings mask
+        // every value with resultMask, to the queue's timestampValidBits; other rings use no mask.
+                        query_ring(vk::Device                       device,
+                                   vk::QueryType                    queryType,
+                                   vk::QueryPipelineStatisticFlags  statistics,
+                                   bool                             isSupported,
+                                   std::uint64_t                    resultMask = std::numeric_limits<std::uint64_t>::max());
+
+                        query_ring(const query_ring& other) = delete;
+
+        query_ring&     operator=(const query_ring& other) = delete;
+
+        // False if the device cannot perform these queries; clients must then not use the
+        // queries they are given.
+        bool            isSupported() const { return mIsSupported; }
+
+        vk::QueryType                   getQueryType() const { return mQueryType; }
+        vk::QueryPipelineStatisticFlags getStatistics() const { return mStatistics; }
+
+        // Number of values each query yields
+        std::uint32_t   getValuesPerQuery() const { return mValuesPerQuery; }
+
+        // Resets queries from the host, e.g. through VK_EXT_host_query_reset
+        typedef std::function<void (vk::QueryPool pool, std::uint32_t firstQuery, std::uint32_t queryCount)> host_reset;
+
+        // With a host reset, allocate resets each run before handing it out, so that a recycled
+        // run never reports its previous owner's results as available.
+        void            setHostReset(host_reset reset) { mHostReset = reset; }
+
+        allocation      allocate(std::uint32_t numQueries);
+
+        // The caller must guarantee that the GPU is no longer using the queries.
+        void            release(const allocation& run);
+
+        // Read the run's results, getValuesPerQuery() per query, masked with the result mask,
+        // without waiting. Returns false, and leaves results untouched, if any of them is not
+        // available yet. Without a host reset, a run's queries keep their previous owner's
+        // results until the client's own reset executes; clients must not read them before.
+        bool            tryGetResults(const allocation& run, std::uint64_t* results);
+
+        // Read the run's results, waiting for any that are not available yet.
+        void            getResults(const allocation& run, std::uint64_t* results);
+
+        const stats_t&  getStats() const { return mStats; }
+        std::size_t     getPoolCount() const { return mRing.getBlockCount(); }
+
+    private:
+        vk::UniqueQueryPool     createPool(std::uint32_t capacity);
+
+    private:
+        vk::Device                          mDevice;
+        vk::QueryType                       mQueryType;
+        vk::QueryPipelineStatisticFlags     mStatistics;
+        std::uint32_t                       mValuesPerQuery = 1;
+        bool                                mIsSupported    = false;
+        std::uint64_t                       mResultMask     = 0;
+
+        host_reset                          mHostReset;
+
+        range_ring<std::uint32_t, vk::UniqueQueryPool>  mRing;
+
+        // Scratch space for results, each query's followed by its availability
+        vector<std::uint64_t>               mResultScratch;
+
+        stats_t                             mStats;
+    };
+
+}
+
+#endif //CLSPVUTILS_QUERY_RING_HPP
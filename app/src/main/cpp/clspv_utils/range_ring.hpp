@@ -0,0 +1,181 @@
+#ifndef CLSPVUTILS_RANGE_RING_HPP
+#define CLSPVUTILS_RANGE_RING_HPP
+
+#include "clspv_utils_fwd.hpp"
+
+#include "clspv_utils_interop.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+
+namespace clspv_utils {
+
+    // The ring allocator behind uniform_ring and query_ring. Ranges of offsets are carved from the
+    // head of a ring and reclaimed from its tail. Ranges may be released in any order, but a
+    // range's space is only reclaimed once every range allocated before it has been released too.
+    //
+    // When the ring is full, a new block of twice the size takes over. Older blocks are destroyed
+    // as soon as their last range is released. Each block owns a Resources (e.g. the buffer or
+    // query pool its offsets index into), which lives exactly as long as the block.
+    template <typename Offset, typename Resources>
+    class range_ring {
+    public:
+        struct range {
+            Resources*      mResources  = nullptr;
+            std::uint64_t   mBlockId    = 0;
+            Offset          mOffset     = 0;
+        };
+
+        explicit        range_ring(Offset initialCapacity) : mInitialCapacity(initialCapacity) {}
+
+                        range_ring(const range_ring& other) = delete;
+
+        range_ring&     operator=(const range_ring& other) = delete;
+
+        // Allocate size consecutive offsets. If no block has room, createBlock(capacity) is called
+        // to make the Resources for a new block of the given capacity.
+        template <typename CreateBlock>
+        range           allocate(Offset size, CreateBlock createBlock);
+
+        // The caller must guarantee that the GPU is no longer using the range. Returns false if
+        // the range is not outstanding in this ring; otherwise sets size to the range's size.
+        bool            release(std::uint64_t blockId, Offset offset, Offset& size);
+
+        std::size_t     getBlockCount() const { return mBlocks.size(); }
+
+    private:
+        struct pending_range {
+            Offset  mBegin      = 0;
+            Offset  mEnd        = 0;
+            bool    mIsReleased = false;
+        };
+
+        struct block {
+            explicit block(Resources&& resources) : mResources(std::move(resources)) {}
+
+            Resources                   mResources;
+            std::uint64_t               mId         = 0;
+            Offset                      mCapacity   = 0;
+            Offset                      mHead       = 0;    // one past the newest range
+            Offset                      mTail       = 0;    // start of the oldest range
+            std::deque<pending_range>   mPending;
+        };
+
+        typedef shared_ptr<block> block_ref;
+
+    private:
+        static bool     tryAllocate(const block& b, Offset size, Offset& offset);
+
+    private:
+        Offset              mInitialCapacity;
+        std::uint64_t       mNextBlockId    = 1;
+
+        // The last block is the one allocations come from
+        vector<block_ref>   mBlocks;
+    };
+
+    template <typename Offset, typename Resources>
+    template <typename CreateBlock>
+    typename range_ring<Offset, Resources>::range
+    range_ring<Offset, Resources>::allocate(Offset size, CreateBlock createBlock)
+    {
+        Offset offset = 0;
+        if (mBlocks.empty() || !tryAllocate(*mBlocks.back(), size, offset)) {
+            const Offset nextCapacity = std::max<Offset>(mBlocks.empty() ? mInitialCapacity : 2 * mBlocks.back()->mCapacity,
+                                                         size);
+
+            block_ref newBlock(new block(createBlock(nextCapacity)));
+            newBlock->mId = mNextBlockId++;
+            newBlock->mCapacity = nextCapacity;
+            mBlocks.push_back(newBlock);
+
+            const bool fits = tryAllocate(*mBlocks.back(), size, offset);
+            assert(fits);
+            (void) fits;
+        }
+
+        block& current = *mBlocks.back();
+
+        pending_range pending;
+        pending.mBegin = offset;
+        pending.mEnd = offset + size;
+        current.mPending.push_back(pending);
+        current.mHead = pending.mEnd;
+
+        range result;
+        result.mResources = &current.mResources;
+        result.mBlockId = current.mId;
+        result.mOffset = offset;
+        return result;
+    }
+
+    template <typename Offset, typename Resources>
+    bool range_ring<Offset, Resources>::release(std::uint64_t blockId, Offset offset, Offset& size)
+    {
+        auto owner = std::find_if(mBlocks.begin(), mBlocks.end(), [blockId](const block_ref& b) {
+            return b->mId == blockId;
+        });
+        if (owner == mBlocks.end()) {
+            return false;
+        }
+
+        block& b = **owner;
+
+        auto pending = std::find_if(b.mPending.begin(), b.mPending.end(), [offset](const pending_range& p) {
+            return p.mBegin == offset && !p.mIsReleased;
+        });
+        if (pending == b.mPending.end()) {
+            return false;
+        }
+
+        pending->mIsReleased = true;
+        size = pending->mEnd - pending->mBegin;
+
+        // Reclaim space from the tail, up to the oldest range still in use
+        while (!b.mPending.empty() && b.mPending.front().mIsReleased) {
+            b.mPending.pop_front();
+        }
+
+        if (b.mPending.empty()) {
+            b.mHead = 0;
+            b.mTail = 0;
+
+            if (owner != std::prev(mBlocks.end())) {
+                mBlocks.erase(owner);
+            }
+        }
+        else {
+            b.mTail = b.mPending.front().mBegin;
+        }
+
+        return true;
+    }
+
+    template <typename Offset, typename Resources>
+    bool range_ring<Offset, Resources>::tryAllocate(const block& b, Offset size, Offset& offset)
+    {
+        // The ring has wrapped if the newest range lies before the oldest. An empty ring never
+        // wraps; its head and tail are both reset to 0.
+        const bool isWrapped = !b.mPending.empty() && b.mHead <= b.mTail;
+
+        if (isWrapped) {
+            offset = b.mHead;
+            return (offset + size <= b.mTail);
+        }
+
+        offset = b.mHead;
+        if (offset + size <= b.mCapacity) {
+            return true;
+        }
+
+        // Wrap around to the start, abandoning the space at the end of the block
+        offset = 0;
+        return (size <= b.mTail);
+    }
+
+}
+
+#endif //CLSPVUTILS_RANGE_RING_HPP
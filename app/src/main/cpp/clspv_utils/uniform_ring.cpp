@@ -0,0 +1,81 @@
+#include "uniform_ring.hpp"
+
+#include "vulkan_utils/vulkan_utils.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+    const vk::DeviceSize kInitialBlockSize  = 64 * 1024;
+
+    vk::DeviceSize align_up(vk::DeviceSize value, vk::DeviceSize alignment)
+    {
+        return ((value + alignment - 1) / alignment) * alignment;
+    }
+
+} // anonymous namespace
+
+namespace clspv_utils {
+
+    uniform_ring::uniform_ring(vulkan_utils::memory_allocator&  allocator,
+                               const vk::PhysicalDeviceLimits&  limits)
+            : mAllocator(allocator),
+              mAlignment(std::max<vk::DeviceSize>(1, limits.minUniformBufferOffsetAlignment)),
+              mMaxRange(limits.maxUniformBufferRange),
+              mRing(kInitialBlockSize)
+    {
+    }
+
+    uniform_ring::allocation uniform_ring::allocate(const void* data, vk::DeviceSize numBytes)
+    {
+        if (0 == numBytes || numBytes > mMaxRange) {
+            fail_runtime_error("uniform argument size is outside the device's uniform buffer range");
+        }
+
+        const vk::DeviceSize rangeSize = align_up(numBytes, mAlignment);
+
+        const auto range = mRing.allocate(rangeSize, [this](vk::DeviceSize capacity) {
+            return createBlock(capacity);
+        });
+        vulkan_utils::buffer& current = *range.mResources;
+
+        std::memcpy(current.getMappedData<std::uint8_t>() + range.mOffset, data, numBytes);
+        current.flush(range.mOffset, rangeSize);
+
+        ++mStats.mNumAllocations;
+        mStats.mBytesOutstanding += rangeSize;
+        mStats.mPeakBytesOutstanding = std::max(mStats.mPeakBytesOutstanding, mStats.mBytesOutstanding);
+
+        allocation result;
+        result.mBuffer = current.use().buffer;
+        result.mOffset = range.mOffset;
+        result.mSize = numBytes;
+        result.mBlockId = range.mBlockId;
+        return result;
+    }
+
+    void uniform_ring::release(const allocation& range)
+    {
+        vk::DeviceSize rangeSize = 0;
+        if (!mRing.release(range.mBlockId, range.mOffset, rangeSize)) {
+            fail_runtime_error("uniform range is not outstanding in this ring");
+        }
+
+        mStats.mBytesOutstanding -= rangeSize;
+    }
+
+    vulkan_utils::buffer uniform_ring::createBlock(vk::DeviceSize capacity)
+    {
+        vulkan_utils::buffer result(mAllocator,
+                                    capacity,
+                                    vk::BufferUsageFlagBits::eUniformBuffer,
+                                    vulkan_utils::buffer::kMapping_Persistent,
+                                    vulkan_utils::memory_allocator::kPlacement_Upload);
+
+        ++mStats.mNumBlocksCreated;
+
+        return result;
+    }
+
+} // namespace clspv_utils
@@ -0,0 +1,70 @@
+#ifndef CLSPVUTILS_UNIFORM_RING_HPP
+#define CLSPVUTILS_UNIFORM_RING_HPP
+
+#include "clspv_utils_fwd.hpp"
+
+#include "clspv_utils_interop.hpp"
+#include "range_ring.hpp"
+
+#include "vulkan_utils/vulkan_utils.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+
+namespace clspv_utils {
+
+    // Hands out small ranges of persistently mapped uniform buffer memory, for kernel arguments
+    // passed by value. Ranges come from a range_ring, whose blocks are uniform buffers in the
+    // memory allocator's upload placement. Blocks stay mapped for their whole lifetime, and
+    // non-coherent memory is flushed as each range is written.
+    class uniform_ring {
+    public:
+        struct allocation {
+            vk::Buffer      mBuffer;
+            vk::DeviceSize  mOffset     = 0;
+            vk::DeviceSize  mSize       = 0;
+            std::uint64_t   mBlockId    = 0;
+        };
+
+        struct stats_t {
+            std::uint64_t   mNumAllocations         = 0;
+            std::uint64_t   mNumBlocksCreated       = 0;
+            std::uint64_t   mBytesOutstanding       = 0;    // allocated and not yet released
+            std::uint64_t   mPeakBytesOutstanding   = 0;
+        };
+
+        // The allocator must outlive the ring.
+                        uniform_ring(vulkan_utils::memory_allocator&    allocator,
+                                     const vk::PhysicalDeviceLimits&    limits);
+
+                        uniform_ring(const uniform_ring& other) = delete;
+
+        uniform_ring&   operator=(const uniform_ring& other) = delete;
+
+        // Allocate a range suitably aligned for a uniform buffer descriptor, and copy numBytes of
+        // data into it. The data is visible to the device by the time a later submission begins.
+        allocation      allocate(const void* data, vk::DeviceSize numBytes);
+
+        // The caller must guarantee that the GPU is no longer using the range.
+        void            release(const allocation& range);
+
+        const stats_t&  getStats() const { return mStats; }
+        std::size_t     getBlockCount() const { return mRing.getBlockCount(); }
+
+    private:
+        vulkan_utils::buffer    createBlock(vk::DeviceSize capacity);
+
+    private:
+        vulkan_utils::memory_allocator&     mAllocator;
+        vk::DeviceSize                      mAlignment          = 1;
+        vk::DeviceSize                      mMaxRange           = 0;
+
+        range_ring<vk::DeviceSize, vulkan_utils::buffer>    mRing;
+
+        stats_t                             mStats;
+    };
+
+}
+
+#endif //CLSPVUTILS_UNIFORM_RING_HPP
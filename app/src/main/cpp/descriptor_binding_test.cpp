@@ -0,0 +1,223 @@
+#include "descriptor_binding_test.hpp"
+
+#include "clspv_utils/descriptor_arena.hpp"
+#include "clspv_utils/interface.hpp"
+#include "clspv_utils/invocation_req.hpp"
+
+#include "test_utils.hpp"
+#include "util.hpp"
+#include "vulkan_utils/vulkan_utils.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include "boost/accumulators/accumulators.hpp"
+#include "boost/accumulators/statistics.hpp"
+#include "boost/accumulators/statistics/mean.hpp"
+#include "boost/accumulators/statistics/max.hpp"
+#include "boost/accumulators/statistics/min.hpp"
+#include <boost/units/io.hpp>
+#include <boost/units/systems/si.hpp>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+    const vk::DeviceSize kBufferSize = 1024;
+
+    const char* getStrategyName(clspv_utils::descriptor_strategy strategy)
+    {
+        switch (strategy) {
+            case clspv_utils::descriptor_strategy::kWriteDescriptorSets:    return "writeDescriptorSets";
+            case clspv_utils::descriptor_strategy::kUpdateTemplate:         return "updateTemplate";
+            case clspv_utils::descriptor_strategy::kPushDescriptor:         return "pushDescriptor";
+            default:                                                        return "unknown";
+        }
+    }
+
+    // A kernel taking numArguments global buffers, as clspv would describe it
+    clspv_utils::kernel_spec_t::arg_list createArguments(std::size_t numArguments)
+    {
+        clspv_utils::kernel_spec_t::arg_list result;
+
+        for (std::size_t i = 0; i < numArguments; ++i) {
+            clspv_utils::arg_spec_t arg;
+            arg.mKind = clspv_utils::arg_spec_t::kind_buffer;
+            arg.mOrdinal = i;
+            arg.mDescriptorSet = 0;
+            arg.mBinding = i;
+            arg.mOffset = 0;
+            result.push_back(arg);
+        }
+
+        return result;
+    }
+
+    void runOneTest(const clspv_utils::device&          device,
+                    clspv_utils::descriptor_strategy    strategy,
+                    std::size_t                         numArguments,
+                    unsigned int                        numIterations)
+    {
+        namespace ba = boost::accumulators;
+
+        const auto durations = descriptor_binding_test::timeDescriptorStrategy(device, strategy, numArguments, numIterations);
+        if (durations.empty()) {
+            LOGI("descriptorBinding(%s) numArguments:%u unsupported",
+                 getStrategyName(strategy),
+                 static_cast<unsigned int>(numArguments));
+            return;
+        }
+
+        ba::accumulator_set<double, ba::stats<ba::tag::mean, ba::tag::max, ba::tag::min>> acc;
+        for (auto& d : durations) {
+            acc(d.count());
+        }
+
+        std::ostringstream os;
+        os << boost::units::engineering_prefix
+           << "descriptorBinding(" << getStrategyName(strategy) << ")"
+           << " numArguments:" << numArguments
+           << " count:" << durations.size()
+           << " mean:" << ba::mean(acc) * boost::units::si::seconds
+           << " max:" << ba::max(acc) * boost::units::si::seconds
+           << " min:" << ba::min(acc) * boost::units::si::seconds;
+
+        LOGI("%s", os.str().c_str());
+    }
+
+} // anonymous namespace
+
+namespace descriptor_binding_test {
+
+    std::vector<test_utils::StopWatch::duration> timeDescriptorStrategy(const clspv_utils::device&        device,
+                                                                        clspv_utils::descriptor_strategy  strategy,
+                                                                        std::size_t                       numArguments,
+                                                                        unsigned int                      iterations)
+    {
+        std::vector<test_utils::StopWatch::duration> results;
+
+        if (!device.supportsDescriptorStrategy(strategy)) {
+            return results;
+        }
+
+        const vk::Device vkDevice = device.getDevice();
+        const auto arguments = createArguments(numArguments);
+
+        auto layout = clspv_utils::createKernelArgumentDescriptorLayout(arguments,
+                                                                        vkDevice,
+                                                                        clspv_utils::getDescriptorSetLayoutFlags(strategy));
+        auto pipelineLayout = vulkan_utils::create_pipeline_layout(vkDevice, *layout);
+
+        // Every argument refers to the same buffer; only the cost of binding it is of interest.
+        vulkan_utils::buffer buffer(device.getMemoryAllocator(), kBufferSize, vk::BufferUsageFlagBits::eStorageBuffer);
+        const vk::DescriptorBufferInfo bufferInfo = buffer.use();
+
+        clspv_utils::descriptor_arena arena(vkDevice);
+        vk::DescriptorSet descriptorSet;
+        if (clspv_utils::descriptor_strategy::kPushDescriptor != strategy) {
+            descriptorSet = arena.allocate(*layout, clspv_utils::getKernelArgumentDescriptorCounts(arguments));
+        }
+
+        std::vector<vk::WriteDescriptorSet> writes;
+        for (auto& ka : arguments) {
+            vk::WriteDescriptorSet argSet;
+            argSet.setDstSet(descriptorSet)
+                    .setDstBinding(ka.mBinding)
+                    .setDescriptorCount(1)
+                    .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                    .setPBufferInfo(&bufferInfo);
+            writes.push_back(argSet);
+        }
+
+        vk::DescriptorUpdateTemplate updateTemplate;
+        std::vector<clspv_utils::descriptor_info_t> updateData(numArguments);
+        if (clspv_utils::descriptor_strategy::kUpdateTemplate == strategy) {
+            const auto entries = clspv_utils::getKernelArgumentUpdateTemplateEntries(arguments,
+                                                                                     sizeof(clspv_utils::descriptor_info_t));
+
+            vk::DescriptorUpdateTemplateCreateInfo createInfo;
+            createInfo.setDescriptorUpdateEntryCount(entries.size())
+                    .setPDescriptorUpdateEntries(entries.empty() ? nullptr : entries.data())
+                    .setTemplateType(vk::DescriptorUpdateTemplateType::eDescriptorSet)
+                    .setDescriptorSetLayout(*layout);
+            updateTemplate = device.createDescriptorUpdateTemplate(createInfo);
+        }
+
+        // The command buffer is only recorded, never submitted.
+        auto commandBuffer = vulkan_utils::allocate_command_buffer(vkDevice, device.getCommandPool());
+        commandBuffer->begin(vk::CommandBufferBeginInfo());
+
+        results.reserve(iterations);
+
+        test_utils::StopWatch stopWatch;
+        for (unsigned int i = iterations; i > 0; --i) {
+            stopWatch.restart();
+
+            switch (strategy) {
+                case clspv_utils::descriptor_strategy::kWriteDescriptorSets:
+                    vkDevice.updateDescriptorSets(writes, nullptr);
+                    commandBuffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, *pipelineLayout, 0, descriptorSet, nullptr);
+                    break;
+
+                case clspv_utils::descriptor_strategy::kUpdateTemplate:
+                    // Gathering the update data is part of the per-dispatch cost
+                    for (auto& d : updateData) {
+                        d.mBuffer = bufferInfo;
+                    }
+                    device.updateDescriptorSetWithTemplate(descriptorSet, updateTemplate, updateData.data());
+                    commandBuffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, *pipelineLayout, 0, descriptorSet, nullptr);
+                    break;
+
+                case clspv_utils::descriptor_strategy::kPushDescriptor:
+                    device.pushDescriptorSet(*commandBuffer, *pipelineLayout, 0, writes);
+                    break;
+            }
+
+            results.push_back(stopWatch.getSplitTime());
+        }
+
+        commandBuffer->end();
+        device.destroyDescriptorUpdateTemplate(updateTemplate);
+
+        return results;
+    }
+
+    void runAllTests(const clspv_utils::device& device)
+    {
+        // In increasing order
+        const std::size_t argumentCounts[] = { 1, 4, 16 };
+        const std::size_t numArgumentCounts = sizeof(argumentCounts) / sizeof(argumentCounts[0]);
+
+        const clspv_utils::descriptor_strategy strategies[] = {
+                clspv_utils::descriptor_strategy::kWriteDescriptorSets,
+                clspv_utils::descriptor_strategy::kUpdateTemplate,
+                clspv_utils::descriptor_strategy::kPushDescriptor,
+        };
+
+        // The spec only guarantees 4 storage buffers per stage, so counts are limited to what the
+        // device allows for each strategy; a count that the limit folds onto the one before it is
+        // not run twice.
+        const std::size_t maxStorageBuffers = device.getPhysicalDevice().getProperties().limits.maxPerStageDescriptorStorageBuffers;
+        // Without push descriptors, runOneTest reports the strategy as unsupported
+        const std::size_t maxPushDescriptors = (device.supportsDescriptorStrategy(clspv_utils::descriptor_strategy::kPushDescriptor)
+                                                ? std::min<std::size_t>(maxStorageBuffers, device.getMaxPushDescriptors())
+                                                : maxStorageBuffers);
+
+        const unsigned int numIterations = 1000;
+
+        for (std::size_t i = 0; i < numArgumentCounts; ++i) {
+            for (auto strategy : strategies) {
+                const std::size_t maxArguments = (clspv_utils::descriptor_strategy::kPushDescriptor == strategy
+                                                  ? maxPushDescriptors
+                                                  : maxStorageBuffers);
+                const std::size_t numArguments = std::min(argumentCounts[i], maxArguments);
+                if (i > 0 && std::min(argumentCounts[i - 1], maxArguments) == numArguments) {
+                    continue;
+                }
+
+                runOneTest(device, strategy, numArguments, numIterations);
+            }
+        }
+    }
+}
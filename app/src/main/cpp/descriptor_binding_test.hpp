@@ -0,0 +1,23 @@
+#ifndef CLSPVTEST_DESCRIPTORBINDINGTEST_HPP
+#define CLSPVTEST_DESCRIPTORBINDINGTEST_HPP
+
+#include "test_utils.hpp"
+
+#include "clspv_utils/device.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace descriptor_binding_test {
+
+    // Time the host work needed to bind numArguments storage buffers for one dispatch, using the
+    // given strategy. Returns no timings if the device does not support the strategy.
+    std::vector<test_utils::StopWatch::duration> timeDescriptorStrategy(const clspv_utils::device&        device,
+                                                                        clspv_utils::descriptor_strategy  strategy,
+                                                                        std::size_t                       numArguments,
+                                                                        unsigned int                      iterations);
+
+    void runAllTests(const clspv_utils::device& device);
+}
+
+#endif //CLSPVTEST_DESCRIPTORBINDINGTEST_HPP
@@ -6,17 +6,17 @@
 
 namespace copybuffertobuffer_kernel {
 
-    clspv_utils::execution_time_t
-    invoke(clspv_utils::kernel&     kernel,
-           vulkan_utils::buffer&    src_buffer,
-           vulkan_utils::buffer&    dst_buffer,
-           std::int32_t             src_pitch,
-           std::int32_t             src_offset,
-           std::int32_t             dst_pitch,
-           std::int32_t             dst_offset,
-           bool                     is32Bit,
-           std::int32_t             width,
-           std::int32_t             height)
+    test_utils::Dispatch
+    makeDispatch(clspv_utils::kernel&     kernel,
+                 vulkan_utils::buffer&    src_buffer,
+                 vulkan_utils::buffer&    dst_buffer,
+                 std::int32_t             src_pitch,
+                 std::int32_t             src_offset,
+                 std::int32_t             dst_pitch,
+                 std::int32_t             dst_offset,
+                 bool                     is32Bit,
+                 std::int32_t             width,
+                 std::int32_t             height)
     {
         struct scalar_args {
             std::int32_t inSrcPitch;         // offset 0
@@ -35,18 +35,14 @@ namespace copybuffertobuffer_kernel {
         static_assert(20 == offsetof(scalar_args, inWidth), "inWidth offset incorrect");
         static_assert(24 == offsetof(scalar_args, inHeight), "inHeight offset incorrect");
 
-        vulkan_utils::buffer scalarBuffer = vulkan_utils::createUniformBuffer(kernel.getDevice().getDevice(),
-                                                                              kernel.getDevice().getMemoryProperties(),
-                                                                              sizeof(scalar_args));
-        auto scalars = scalarBuffer.map<scalar_args>();
-        scalars->inSrcPitch = src_pitch;
-        scalars->inSrcOffset = src_offset;
-        scalars->inDstPitch = dst_pitch;
-        scalars->inDstOffset = dst_offset;
-        scalars->inIs32Bit = is32Bit;
-        scalars->inWidth = width;
-        scalars->inHeight = height;
-        scalars.reset();
+        scalar_args scalars;
+        scalars.inSrcPitch = src_pitch;
+        scalars.inSrcOffset = src_offset;
+        scalars.inDstPitch = dst_pitch;
+        scalars.inDstOffset = dst_offset;
+        scalars.inIs32Bit = is32Bit;
+        scalars.inWidth = width;
+        scalars.inHeight = height;
 
         const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
                                                                           vk::Extent3D(width, height, 1));
@@ -55,9 +51,24 @@ namespace copybuffertobuffer_kernel {
 
         invocation.addStorageBufferArgument(src_buffer);
         invocation.addStorageBufferArgument(dst_buffer);
-        invocation.addUniformBufferArgument(scalarBuffer);
+        invocation.addUniformBufferArgument(&scalars, sizeof(scalars));
+
+        return test_utils::Dispatch{ std::move(invocation), num_workgroups };
+    }
 
-        return invocation.run(num_workgroups);
+    clspv_utils::execution_time_t
+    invoke(clspv_utils::kernel&     kernel,
+           vulkan_utils::buffer&    src_buffer,
+           vulkan_utils::buffer&    dst_buffer,
+           std::int32_t             src_pitch,
+           std::int32_t             src_offset,
+           std::int32_t             dst_pitch,
+           std::int32_t             dst_offset,
+           bool                     is32Bit,
+           std::int32_t             width,
+           std::int32_t             height)
+    {
+        return test_utils::run_dispatch(makeDispatch(kernel, src_buffer, dst_buffer, src_pitch, src_offset, dst_pitch, dst_offset, is32Bit, width, height));
     }
 
     test_utils::KernelTest::invocation_tests getAllTestVariants()
@@ -94,11 +105,9 @@ namespace copybuffertobuffer_kernel {
         mIs32Bit = (sizeofPixelComponent == 4);
 
         // allocate buffers and images
-        mSrcBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                       device.getMemoryProperties(),
+        mSrcBuffer = vulkan_utils::createStorageBuffer(device.getMemoryAllocator(),
                                                        buffer_size);
-        mDstBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                       device.getMemoryProperties(),
+        mDstBuffer = vulkan_utils::createStorageBuffer(device.getMemoryAllocator(),
                                                        buffer_size);
     }
 
@@ -107,18 +116,18 @@ namespace copybuffertobuffer_kernel {
 
     }
 
-    clspv_utils::execution_time_t TestBase::run(clspv_utils::kernel& kernel)
+    test_utils::Dispatch TestBase::createDispatch(clspv_utils::kernel& kernel)
     {
-        return invoke(kernel,
-                      mSrcBuffer,
-                      mDstBuffer,
-                      mBufferExtent.width,  // src_pitch
-                      0,                    // src_offset
-                      mBufferExtent.width,  // dst_pitch
-                      0,                    // dst_offset
-                      mIs32Bit,             // is32Bit
-                      mBufferExtent.width,  // width
-                      mBufferExtent.height);// height
+        return makeDispatch(kernel,
+                            mSrcBuffer,
+                            mDstBuffer,
+                            mBufferExtent.width,  // src_pitch
+                            0,                    // src_offset
+                            mBufferExtent.width,  // dst_pitch
+                            0,                    // dst_offset
+                            mIs32Bit,             // is32Bit
+                            mBufferExtent.width,  // width
+                            mBufferExtent.height);// height
     }
 
 
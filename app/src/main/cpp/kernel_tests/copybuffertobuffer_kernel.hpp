@@ -15,6 +15,18 @@
 
 namespace copybuffertobuffer_kernel {
 
+    test_utils::Dispatch
+    makeDispatch(clspv_utils::kernel&     kernel,
+                 vulkan_utils::buffer&    src_buffer,
+                 vulkan_utils::buffer&    dst_buffer,
+                 std::int32_t             src_pitch,
+                 std::int32_t             src_offset,
+                 std::int32_t             dst_pitch,
+                 std::int32_t             dst_offset,
+                 bool                     is32Bit,
+                 std::int32_t             width,
+                 std::int32_t             height);
+
     clspv_utils::execution_time_t
     invoke(clspv_utils::kernel&     kernel,
            vulkan_utils::buffer&    src_buffer,
@@ -29,13 +41,13 @@ namespace copybuffertobuffer_kernel {
 
     test_utils::KernelTest::invocation_tests getAllTestVariants();
 
-    struct TestBase : public test_utils::Test
+    struct TestBase : public test_utils::DispatchTest
     {
         TestBase(clspv_utils::kernel& kernel, const std::vector<std::string>& args, std::size_t sizeofPixelComponent, unsigned int numComponents);
 
         ~TestBase();
 
-        virtual clspv_utils::execution_time_t run(clspv_utils::kernel& kernel) override;
+        virtual test_utils::Dispatch createDispatch(clspv_utils::kernel& kernel) override;
 
         vk::Extent3D            mBufferExtent;
         vulkan_utils::buffer    mSrcBuffer;
@@ -80,7 +92,11 @@ namespace copybuffertobuffer_kernel {
                                                        dstBufferMap.get() + buffer_length);
         }
 
-        using TestBase::run;
+        virtual std::size_t getBytesTransferred() const override
+        {
+            // every pixel is read once and written once
+            return 2 * mBufferExtent.width * mBufferExtent.height * mBufferExtent.depth * sizeof(PixelType);
+        }
 
         virtual test_utils::Evaluation evaluate(bool verbose) override
         {
@@ -24,18 +24,18 @@ namespace  {
 
 namespace copybuffertoimage_kernel {
 
-    clspv_utils::execution_time_t
-    invoke(clspv_utils::kernel&     kernel,
-           vulkan_utils::buffer&    src_buffer,
-           vulkan_utils::image&     dst_image,
-           int                      src_offset,
-           int                      src_pitch,
-           cl_channel_order         src_channel_order,
-           cl_channel_type          src_channel_type,
-           bool                     swap_components,
-           bool                     premultiply,
-           int                      width,
-           int                      height)
+    test_utils::Dispatch
+    makeDispatch(clspv_utils::kernel&     kernel,
+                 vulkan_utils::buffer&    src_buffer,
+                 vulkan_utils::image&     dst_image,
+                 int                      src_offset,
+                 int                      src_pitch,
+                 cl_channel_order         src_channel_order,
+                 cl_channel_type          src_channel_type,
+                 bool                     swap_components,
+                 bool                     premultiply,
+                 int                      width,
+                 int                      height)
     {
         struct scalar_args {
             int inSrcOffset;        // offset 0
@@ -59,19 +59,15 @@ namespace copybuffertoimage_kernel {
         static_assert(24 == offsetof(scalar_args, inWidth), "inWidth offset incorrect");
         static_assert(28 == offsetof(scalar_args, inHeight), "inHeight offset incorrect");
 
-        vulkan_utils::buffer scalarBuffer = vulkan_utils::createUniformBuffer(kernel.getDevice().getDevice(),
-                                                                              kernel.getDevice().getMemoryProperties(),
-                                                                              sizeof(scalar_args));
-        auto scalars = scalarBuffer.map<scalar_args>();
-        scalars->inSrcOffset = src_offset;
-        scalars->inSrcPitch = src_pitch;
-        scalars->inSrcChannelOrder = src_channel_order;
-        scalars->inSrcChannelType = src_channel_type;
-        scalars->inSwapComponents = (swap_components ? 1 : 0);
-        scalars->inPremultiply = (premultiply ? 1 : 0);
-        scalars->inWidth = width;
-        scalars->inHeight = height;
-        scalars.reset();
+        scalar_args scalars;
+        scalars.inSrcOffset = src_offset;
+        scalars.inSrcPitch = src_pitch;
+        scalars.inSrcChannelOrder = src_channel_order;
+        scalars.inSrcChannelType = src_channel_type;
+        scalars.inSwapComponents = (swap_components ? 1 : 0);
+        scalars.inPremultiply = (premultiply ? 1 : 0);
+        scalars.inWidth = width;
+        scalars.inHeight = height;
 
         const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
                                                                           vk::Extent3D(width, height, 1));
@@ -80,9 +76,25 @@ namespace copybuffertoimage_kernel {
 
         invocation.addStorageBufferArgument(src_buffer);
         invocation.addWriteOnlyImageArgument(dst_image);
-        invocation.addUniformBufferArgument(scalarBuffer);
+        invocation.addUniformBufferArgument(&scalars, sizeof(scalars));
+
+        return test_utils::Dispatch{ std::move(invocation), num_workgroups };
+    }
 
-        return invocation.run(num_workgroups);
+    clspv_utils::execution_time_t
+    invoke(clspv_utils::kernel&     kernel,
+           vulkan_utils::buffer&    src_buffer,
+           vulkan_utils::image&     dst_image,
+           int                      src_offset,
+           int                      src_pitch,
+           cl_channel_order         src_channel_order,
+           cl_channel_type          src_channel_type,
+           bool                     swap_components,
+           bool                     premultiply,
+           int                      width,
+           int                      height)
+    {
+        return test_utils::run_dispatch(makeDispatch(kernel, src_buffer, dst_image, src_offset, src_pitch, src_channel_order, src_channel_type, swap_components, premultiply, width, height));
     }
 
     test_utils::KernelTest::invocation_tests getAllTestVariants()
@@ -17,6 +17,19 @@
 
 namespace copybuffertoimage_kernel {
 
+    test_utils::Dispatch
+    makeDispatch(clspv_utils::kernel&     kernel,
+                 vulkan_utils::buffer&    src_buffer,
+                 vulkan_utils::image&     dst_image,
+                 int                      src_offset,
+                 int                      src_pitch,
+                 cl_channel_order         src_channel_order,
+                 cl_channel_type          src_channel_type,
+                 bool                     swap_components,
+                 bool                     premultiply,
+                 int                      width,
+                 int                      height);
+
     clspv_utils::execution_time_t
     invoke(clspv_utils::kernel&     kernel,
            vulkan_utils::buffer&    src_buffer,
@@ -33,7 +46,7 @@ namespace copybuffertoimage_kernel {
     test_utils::KernelTest::invocation_tests getAllTestVariants();
 
     template <typename BufferPixelType, typename ImagePixelType>
-    struct Test : public test_utils::Test
+    struct Test : public test_utils::DispatchTest
     {
         Test(clspv_utils::kernel& kernel, const std::vector<std::string>& args) :
                 mBufferExtent(64, 64, 1)
@@ -56,16 +69,13 @@ namespace copybuffertoimage_kernel {
             const std::size_t buffer_size = buffer_length * sizeof(BufferPixelType);
 
             // allocate buffers and images
-            mSrcBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                           device.getMemoryProperties(),
+            mSrcBuffer = vulkan_utils::createStorageBuffer(device.getMemoryAllocator(),
                                                            buffer_size);
-            mDstImage = vulkan_utils::image(device.getDevice(),
-                                         device.getMemoryProperties(),
+            mDstImage = vulkan_utils::image(device.getMemoryAllocator(),
                                          mBufferExtent,
                                          vk::Format(pixels::traits<ImagePixelType>::vk_pixel_type),
                                          vulkan_utils::image::kUsage_ReadWrite);
-            mDstImageStaging = vulkan_utils::createStagingBuffer(device.getDevice(),
-                                                                 device.getMemoryProperties(),
+            mDstImageStaging = vulkan_utils::createStagingBuffer(device.getMemoryAllocator(),
                                                                  mDstImage,
                                                                  false,
                                                                  true);
@@ -92,19 +102,25 @@ namespace copybuffertoimage_kernel {
                                                             dstImageMap.get() + buffer_length);
         }
 
-        virtual clspv_utils::execution_time_t run(clspv_utils::kernel& kernel) override
+        virtual std::size_t getBytesTransferred() const override
+        {
+            // every pixel is read once and written once
+            return mBufferExtent.width * mBufferExtent.height * mBufferExtent.depth * (sizeof(BufferPixelType) + sizeof(ImagePixelType));
+        }
+
+        virtual test_utils::Dispatch createDispatch(clspv_utils::kernel& kernel) override
         {
-            return invoke(kernel,
-                          mSrcBuffer,
-                          mDstImage,
-                          0,
-                          mBufferExtent.width,
-                          pixels::traits<BufferPixelType>::cl_pixel_order,
-                          pixels::traits<BufferPixelType>::cl_pixel_type,
-                          false,
-                          false,
-                          mBufferExtent.width,
-                          mBufferExtent.height);
+            return makeDispatch(kernel,
+                                mSrcBuffer,
+                                mDstImage,
+                                0,
+                                mBufferExtent.width,
+                                pixels::traits<BufferPixelType>::cl_pixel_order,
+                                pixels::traits<BufferPixelType>::cl_pixel_type,
+                                false,
+                                false,
+                                mBufferExtent.width,
+                                mBufferExtent.height);
         }
 
         virtual test_utils::Evaluation evaluate(bool verbose) override
@@ -136,7 +152,7 @@ namespace copybuffertoimage_kernel {
 
         static bool isSupported(clspv_utils::device& device)
         {
-            vulkan_utils::image::supportsFormatUse(device.getPhysicalDevice(),
+            return vulkan_utils::image::supportsFormatUse(device.getPhysicalDevice(),
                                                    vk::Format(pixels::traits<ImagePixelType>::vk_pixel_type),
                                                    vulkan_utils::image::kUsage_ReadWrite);
         }
@@ -25,17 +25,17 @@ namespace  {
 
 namespace copyimagetobuffer_kernel {
 
-    clspv_utils::execution_time_t
-    invoke(clspv_utils::kernel&     kernel,
-           vulkan_utils::image&     src_image,
-           vulkan_utils::buffer&    dst_buffer,
-           int                      dst_offset,
-           int                      dst_pitch,
-           cl_channel_order         dst_channel_order,
-           cl_channel_type          dst_channel_type,
-           bool                     swap_components,
-           int                      width,
-           int                      height)
+    test_utils::Dispatch
+    makeDispatch(clspv_utils::kernel&     kernel,
+                 vulkan_utils::image&     src_image,
+                 vulkan_utils::buffer&    dst_buffer,
+                 int                      dst_offset,
+                 int                      dst_pitch,
+                 cl_channel_order         dst_channel_order,
+                 cl_channel_type          dst_channel_type,
+                 bool                     swap_components,
+                 int                      width,
+                 int                      height)
     {
         struct scalar_args {
             int inDestOffset;       // offset 0
@@ -57,18 +57,14 @@ namespace copyimagetobuffer_kernel {
         static_assert(20 == offsetof(scalar_args, inWidth), "inWidth offset incorrect");
         static_assert(24 == offsetof(scalar_args, inHeight), "inHeight offset incorrect");
 
-        vulkan_utils::buffer scalarBuffer = vulkan_utils::createUniformBuffer(kernel.getDevice().getDevice(),
-                                                                              kernel.getDevice().getMemoryProperties(),
-                                                                              sizeof(scalar_args));
-        auto scalars = scalarBuffer.map<scalar_args>();
-        scalars->inDestOffset = dst_offset;
-        scalars->inDestPitch = width;
-        scalars->inDestChannelOrder = dst_channel_order;
-        scalars->inDestChannelType = dst_channel_type;
-        scalars->inSwapComponents = (swap_components ? 1 : 0);
-        scalars->inWidth = width;
-        scalars->inHeight = height;
-        scalars.reset();
+        scalar_args scalars;
+        scalars.inDestOffset = dst_offset;
+        scalars.inDestPitch = width;
+        scalars.inDestChannelOrder = dst_channel_order;
+        scalars.inDestChannelType = dst_channel_type;
+        scalars.inSwapComponents = (swap_components ? 1 : 0);
+        scalars.inWidth = width;
+        scalars.inHeight = height;
 
         const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
                                                                           vk::Extent3D(width, height, 1));
@@ -77,9 +73,24 @@ namespace copyimagetobuffer_kernel {
 
         invocation.addReadOnlyImageArgument(src_image);
         invocation.addStorageBufferArgument(dst_buffer);
-        invocation.addUniformBufferArgument(scalarBuffer);
+        invocation.addUniformBufferArgument(&scalars, sizeof(scalars));
+
+        return test_utils::Dispatch{ std::move(invocation), num_workgroups };
+    }
 
-        return invocation.run(num_workgroups);
+    clspv_utils::execution_time_t
+    invoke(clspv_utils::kernel&     kernel,
+           vulkan_utils::image&     src_image,
+           vulkan_utils::buffer&    dst_buffer,
+           int                      dst_offset,
+           int                      dst_pitch,
+           cl_channel_order         dst_channel_order,
+           cl_channel_type          dst_channel_type,
+           bool                     swap_components,
+           int                      width,
+           int                      height)
+    {
+        return test_utils::run_dispatch(makeDispatch(kernel, src_image, dst_buffer, dst_offset, dst_pitch, dst_channel_order, dst_channel_type, swap_components, width, height));
     }
 
     test_utils::KernelTest::invocation_tests getAllTestVariants()
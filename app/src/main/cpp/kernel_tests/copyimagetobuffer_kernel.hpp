@@ -15,6 +15,18 @@
 
 namespace copyimagetobuffer_kernel {
 
+    test_utils::Dispatch
+    makeDispatch(clspv_utils::kernel&     kernel,
+                 vulkan_utils::image&     src_image,
+                 vulkan_utils::buffer&    dst_buffer,
+                 int                      dst_offset,
+                 int                      dst_pitch,
+                 cl_channel_order         dst_channel_order,
+                 cl_channel_type          dst_channel_type,
+                 bool                     swap_components,
+                 int                      width,
+                 int                      height);
+
     clspv_utils::execution_time_t
     invoke(clspv_utils::kernel&     kernel,
            vulkan_utils::image&     src_image,
@@ -30,7 +42,7 @@ namespace copyimagetobuffer_kernel {
     test_utils::KernelTest::invocation_tests getAllTestVariants();
 
     template <typename BufferPixelType, typename ImagePixelType>
-    struct Test : public test_utils::Test
+    struct Test : public test_utils::DispatchTest
     {
         Test(clspv_utils::kernel& kernel, const std::vector<std::string>& args) :
             mBufferExtent(64, 64, 1)
@@ -41,16 +53,13 @@ namespace copyimagetobuffer_kernel {
             const std::size_t buffer_size = buffer_length * sizeof(BufferPixelType);
 
             // allocate buffers and images
-            mDstBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                           device.getMemoryProperties(),
+            mDstBuffer = vulkan_utils::createStorageBuffer(device.getMemoryAllocator(),
                                                            buffer_size);
-            mSrcImage = vulkan_utils::image(device.getDevice(),
-                                                     device.getMemoryProperties(),
+            mSrcImage = vulkan_utils::image(device.getMemoryAllocator(),
                                                      mBufferExtent,
                                                      vk::Format(pixels::traits<ImagePixelType>::vk_pixel_type),
                                                      vulkan_utils::image::kUsage_ReadOnly);
-            mSrcImageStaging = vulkan_utils::createStagingBuffer(device.getDevice(),
-                                                                 device.getMemoryProperties(),
+            mSrcImageStaging = vulkan_utils::createStagingBuffer(device.getMemoryAllocator(),
                                                                  mSrcImage,
                                                                  true,
                                                                  false);
@@ -86,18 +95,24 @@ namespace copyimagetobuffer_kernel {
             test_utils::invert_pixel_buffer<BufferPixelType>(dstBufferMap.get(), dstBufferMap.get() + buffer_length);
         }
 
-        virtual clspv_utils::execution_time_t run(clspv_utils::kernel& kernel) override
+        virtual std::size_t getBytesTransferred() const override
+        {
+            // every pixel is read once and written once
+            return mBufferExtent.width * mBufferExtent.height * mBufferExtent.depth * (sizeof(ImagePixelType) + sizeof(BufferPixelType));
+        }
+
+        virtual test_utils::Dispatch createDispatch(clspv_utils::kernel& kernel) override
         {
-            return invoke(kernel,
-                          mSrcImage,
-                          mDstBuffer,
-                          0,
-                          mBufferExtent.width,
-                          pixels::traits<BufferPixelType>::cl_pixel_order,
-                          pixels::traits<BufferPixelType>::cl_pixel_type,
-                          false,
-                          mBufferExtent.width,
-                          mBufferExtent.height);
+            return makeDispatch(kernel,
+                                mSrcImage,
+                                mDstBuffer,
+                                0,
+                                mBufferExtent.width,
+                                pixels::traits<BufferPixelType>::cl_pixel_order,
+                                pixels::traits<BufferPixelType>::cl_pixel_type,
+                                false,
+                                mBufferExtent.width,
+                                mBufferExtent.height);
         }
 
         virtual test_utils::Evaluation evaluate(bool verbose) override
@@ -6,16 +6,16 @@
 
 namespace fill_kernel {
 
-    clspv_utils::execution_time_t
-    invoke(clspv_utils::kernel&     kernel,
-           vulkan_utils::buffer&    dst_buffer,
-           int                      pitch,
-           int                      device_format,
-           int                      offset_x,
-           int                      offset_y,
-           int                      width,
-           int                      height,
-           const gpu_types::float4& color) {
+    test_utils::Dispatch
+    makeDispatch(clspv_utils::kernel&     kernel,
+                 vulkan_utils::buffer&    dst_buffer,
+                 int                      pitch,
+                 int                      device_format,
+                 int                      offset_x,
+                 int                      offset_y,
+                 int                      width,
+                 int                      height,
+                 const gpu_types::float4& color) {
         struct scalar_args {
             int inPitch;        // offset 0
             int inDeviceFormat; // DevicePixelFormat offset 4
@@ -34,18 +34,14 @@ namespace fill_kernel {
         static_assert(20 == offsetof(scalar_args, inHeight), "inHeight offset incorrect");
         static_assert(32 == offsetof(scalar_args, inColor), "inColor offset incorrect");
 
-        vulkan_utils::buffer scalarBuffer = vulkan_utils::createUniformBuffer(kernel.getDevice().getDevice(),
-                                                                              kernel.getDevice().getMemoryProperties(),
-                                                                              sizeof(scalar_args));
-        auto scalars = scalarBuffer.map<scalar_args>();
-        scalars->inPitch = pitch;
-        scalars->inDeviceFormat = device_format;
-        scalars->inOffsetX = offset_x;
-        scalars->inOffsetY = offset_y;
-        scalars->inWidth = width;
-        scalars->inHeight = height;
-        scalars->inColor = color;
-        scalars.reset();
+        scalar_args scalars;
+        scalars.inPitch = pitch;
+        scalars.inDeviceFormat = device_format;
+        scalars.inOffsetX = offset_x;
+        scalars.inOffsetY = offset_y;
+        scalars.inWidth = width;
+        scalars.inHeight = height;
+        scalars.inColor = color;
 
         const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
                                                                           vk::Extent3D(width, height, 1));
@@ -53,8 +49,22 @@ namespace fill_kernel {
         clspv_utils::invocation invocation(kernel.createInvocationReq());
 
         invocation.addStorageBufferArgument(dst_buffer);
-        invocation.addUniformBufferArgument(scalarBuffer);
-        return invocation.run(num_workgroups);
+        invocation.addUniformBufferArgument(&scalars, sizeof(scalars));
+        return test_utils::Dispatch{ std::move(invocation), num_workgroups };
+    }
+
+    clspv_utils::execution_time_t
+    invoke(clspv_utils::kernel&     kernel,
+           vulkan_utils::buffer&    dst_buffer,
+           int                      pitch,
+           int                      device_format,
+           int                      offset_x,
+           int                      offset_y,
+           int                      width,
+           int                      height,
+           const gpu_types::float4& color)
+    {
+        return test_utils::run_dispatch(makeDispatch(kernel, dst_buffer, pitch, device_format, offset_x, offset_y, width, height, color));
     }
 
     test_utils::KernelTest::invocation_tests getAllTestVariants()
@@ -15,6 +15,17 @@
 
 namespace fill_kernel {
 
+    test_utils::Dispatch
+    makeDispatch(clspv_utils::kernel&             kernel,
+                 vulkan_utils::buffer&            dst_buffer,
+                 int                              pitch,
+                 int                              device_format,
+                 int                              offset_x,
+                 int                              offset_y,
+                 int                              width,
+                 int                              height,
+                 const gpu_types::float4&         color);
+
     clspv_utils::execution_time_t
     invoke(clspv_utils::kernel&             kernel,
            vulkan_utils::buffer&            dst_buffer,
@@ -29,7 +40,7 @@ namespace fill_kernel {
     test_utils::KernelTest::invocation_tests getAllTestVariants();
 
     template <typename PixelType>
-    struct Test : public test_utils::Test
+    struct Test : public test_utils::DispatchTest
     {
         Test(clspv_utils::kernel& kernel, const std::vector<std::string>& args) :
             mBufferExtent(64, 64, 1),
@@ -53,8 +64,7 @@ namespace fill_kernel {
             // allocate image buffer
             const std::size_t buffer_length = mBufferExtent.width * mBufferExtent.height * mBufferExtent.depth;
             const std::size_t buffer_size = buffer_length * sizeof(PixelType);
-            mDstBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                           device.getMemoryProperties(),
+            mDstBuffer = vulkan_utils::createStorageBuffer(device.getMemoryAllocator(),
                                                            buffer_size);
         }
 
@@ -74,16 +84,21 @@ namespace fill_kernel {
             return os.str();
         }
 
-        virtual clspv_utils::execution_time_t run(clspv_utils::kernel& kernel) override
+        virtual std::size_t getBytesTransferred() const override
         {
+            // every pixel is written once
+            return mBufferExtent.width * mBufferExtent.height * mBufferExtent.depth * sizeof(PixelType);
+        }
 
-            return invoke(kernel,
-                          mDstBuffer, // dst_buffer
-                          mBufferExtent.width,   // pitch
-                          pixels::traits<PixelType>::device_pixel_format, // device_format
-                          0, 0, // offset_x, offset_y
-                          mBufferExtent.width, mBufferExtent.height, // width, height
-                          mFillColor); // color
+        virtual test_utils::Dispatch createDispatch(clspv_utils::kernel& kernel) override
+        {
+            return makeDispatch(kernel,
+                                mDstBuffer, // dst_buffer
+                                mBufferExtent.width,   // pitch
+                                pixels::traits<PixelType>::device_pixel_format, // device_format
+                                0, 0, // offset_x, offset_y
+                                mBufferExtent.width, mBufferExtent.height, // width, height
+                                mFillColor); // color
         }
 
         virtual test_utils::Evaluation evaluate(bool verbose) override
@@ -16,10 +16,10 @@ namespace {
 
 namespace fillarraystruct_kernel {
 
-    clspv_utils::execution_time_t
-    invoke(clspv_utils::kernel&     kernel,
-           vulkan_utils::buffer&    destination_buffer,
-           unsigned int             num_elements)
+    test_utils::Dispatch
+    makeDispatch(clspv_utils::kernel&     kernel,
+                 vulkan_utils::buffer&    destination_buffer,
+                 unsigned int             num_elements)
     {
         const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
                                                                           vk::Extent3D(num_elements, 1, 1));
@@ -27,7 +27,15 @@ namespace fillarraystruct_kernel {
         clspv_utils::invocation invocation(kernel.createInvocationReq());
 
         invocation.addStorageBufferArgument(destination_buffer);
-        return invocation.run(num_workgroups);
+        return test_utils::Dispatch{ std::move(invocation), num_workgroups };
+    }
+
+    clspv_utils::execution_time_t
+    invoke(clspv_utils::kernel&     kernel,
+           vulkan_utils::buffer&    destination_buffer,
+           unsigned int             num_elements)
+    {
+        return test_utils::run_dispatch(makeDispatch(kernel, destination_buffer, num_elements));
     }
 
     Test::Test(clspv_utils::kernel& kernel, const std::vector<std::string>& args) :
@@ -38,8 +46,7 @@ namespace fillarraystruct_kernel {
         // allocate destination buffer
         const std::size_t buffer_size = mBufferWidth * sizeof(FloatArrayWrapper);
         const int num_floats_in_buffer = num_floats_in_struct * mBufferWidth;
-        mDstBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                       device.getMemoryProperties(),
+        mDstBuffer = vulkan_utils::createStorageBuffer(device.getMemoryAllocator(),
                                                        buffer_size);
 
         mExpectedResults.resize(mBufferWidth);
@@ -69,11 +76,11 @@ namespace fillarraystruct_kernel {
 
     }
 
-    clspv_utils::execution_time_t Test::run(clspv_utils::kernel& kernel)
+    test_utils::Dispatch Test::createDispatch(clspv_utils::kernel& kernel)
     {
-        return invoke(kernel,
-                      mDstBuffer,
-                      mBufferWidth);
+        return makeDispatch(kernel,
+                            mDstBuffer,
+                            mBufferWidth);
     }
 
     test_utils::Evaluation Test::evaluate(bool verbose)
@@ -14,18 +14,23 @@
 
 namespace fillarraystruct_kernel {
 
+    test_utils::Dispatch
+    makeDispatch(clspv_utils::kernel&     kernel,
+                 vulkan_utils::buffer&    destination_buffer,
+                 unsigned int             num_elements);
+
     clspv_utils::execution_time_t
     invoke(clspv_utils::kernel&     kernel,
            vulkan_utils::buffer&    destination_buffer,
            unsigned int             num_elements);
 
-    struct Test : public test_utils::Test
+    struct Test : public test_utils::DispatchTest
     {
         Test(clspv_utils::kernel& kernel, const std::vector<std::string>& args);
 
         virtual void prepare() override;
 
-        virtual clspv_utils::execution_time_t run(clspv_utils::kernel& kernel) override;
+        virtual test_utils::Dispatch createDispatch(clspv_utils::kernel& kernel) override;
 
         virtual test_utils::Evaluation evaluate(bool verbose) override;
 
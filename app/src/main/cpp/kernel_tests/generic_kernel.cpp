@@ -21,6 +21,29 @@ namespace {
         boost::algorithm::unhex(hexString, std::back_inserter(result));
         return result;
     }
+
+    // The -las arguments, in order, found the way the Test constructor finds them: after the
+    // number of workgroups, skipping the values of the other options
+    std::vector<std::uint32_t> findLocalArraySizes(const std::vector<std::string>& args) {
+        std::vector<std::uint32_t> result;
+
+        if (args.size() < 3) return result;
+
+        for (auto arg = std::next(args.begin(), 3); arg != args.end(); arg = std::next(arg)) {
+            const bool hasValue = (*arg == "-pb" || *arg == "-sb" || *arg == "-ub" || *arg == "-las" || *arg == "-label");
+            if (!hasValue) continue;
+
+            const auto value = std::next(arg);
+            if (value == args.end()) break;
+
+            if (*arg == "-las") {
+                result.push_back(std::atoi(value->c_str()));
+            }
+            arg = value;
+        }
+
+        return result;
+    }
 }
 
 namespace generic_kernel {
@@ -50,8 +73,7 @@ namespace generic_kernel {
                 if (arg == args.end()) clspv_utils::fail_runtime_error("badly formed arguments to generic test");
                 const std::size_t bufferSize = std::atoi(arg->c_str());
 
-                mStorageBuffers.push_back(vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                                            device.getMemoryProperties(),
+                mStorageBuffers.push_back(vulkan_utils::createStorageBuffer(device.getMemoryAllocator(),
                                                                             bufferSize));
                 mArgOrder.push_back(kind_storageBuffer);
             }
@@ -61,27 +83,26 @@ namespace generic_kernel {
                 if (arg == args.end()) clspv_utils::fail_runtime_error("badly formed arguments to generic test");
                 const auto bufferContents = hexToBytes(*arg);
 
-                mStorageBuffers.push_back(vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                                            device.getMemoryProperties(),
-                                                                            bufferContents.size()));
+                // Keep the contents in host memory the device can use in place, if it supports
+                // importing host memory; otherwise the buffer copies them.
+                auto hostStorage = vulkan_utils::allocate_importable_host_memory(device.getMemoryAllocator(),
+                                                                                 bufferContents.size());
+                std::memcpy(hostStorage.get(), bufferContents.data(), bufferContents.size());
+
+                mStorageBuffers.push_back(vulkan_utils::buffer(device.getMemoryAllocator(),
+                                                               hostStorage,
+                                                               bufferContents.size(),
+                                                               vulkan_utils::importable_host_size(device.getMemoryAllocator(),
+                                                                                                  bufferContents.size()),
+                                                               vk::BufferUsageFlagBits::eStorageBuffer));
                 mArgOrder.push_back(kind_storageBuffer);
-
-                auto bufferMap = mStorageBuffers.back().map<void>();
-                std::memcpy(bufferMap.get(), bufferContents.data(), bufferContents.size());
             }
             else if (*arg == "-ub") {
                 // add a uniform buffer argument
                 arg = std::next(arg);
                 if (arg == args.end()) clspv_utils::fail_runtime_error("badly formed arguments to generic test");
-                const auto bufferContents = hexToBytes(*arg);
-
-                mUniformBuffers.push_back(vulkan_utils::createUniformBuffer(device.getDevice(),
-                                                                            device.getMemoryProperties(),
-                                                                            bufferContents.size()));
+                mUniformArguments.push_back(hexToBytes(*arg));
                 mArgOrder.push_back(kind_uniformBuffer);
-
-                auto bufferMap = mUniformBuffers.back().map<void>();
-                std::memcpy(bufferMap.get(), bufferContents.data(), bufferContents.size());
             }
             else if (*arg == "-las") {
                 // add a local array size argument
@@ -112,12 +133,12 @@ namespace generic_kernel {
     {
     }
 
-    clspv_utils::execution_time_t Test::run(clspv_utils::kernel& kernel)
+    clspv_utils::invocation Test::createInvocation(clspv_utils::kernel& kernel)
     {
         clspv_utils::invocation invocation(kernel.createInvocationReq());
 
         auto storageBufferArg = mStorageBuffers.begin();
-        auto uniformBufferArg = mUniformBuffers.begin();
+        auto uniformArg = mUniformArguments.begin();
         auto localArraySizeArg = mLocalArraySizes.begin();
 
         for (auto arg : mArgOrder) {
@@ -130,9 +151,9 @@ namespace generic_kernel {
                     break;
 
                 case kind_uniformBuffer:
-                    if (uniformBufferArg == mUniformBuffers.end()) clspv_utils::fail_runtime_error("not enough uniform buffers");
-                    invocation.addUniformBufferArgument(*uniformBufferArg);
-                    uniformBufferArg = std::next(uniformBufferArg);
+                    if (uniformArg == mUniformArguments.end()) clspv_utils::fail_runtime_error("not enough uniform buffers");
+                    invocation.addUniformBufferArgument(uniformArg->data(), uniformArg->size());
+                    uniformArg = std::next(uniformArg);
                     break;
 
                 case kind_LocalArraySize:
@@ -147,7 +168,25 @@ namespace generic_kernel {
             }
         }
 
-        return invocation.run(mNumWorkgroups);
+        return invocation;
+    }
+
+    clspv_utils::execution_time_t Test::run(clspv_utils::kernel& kernel)
+    {
+        return createInvocation(kernel).run(mNumWorkgroups);
+    }
+
+    void Test::record(clspv_utils::kernel& kernel)
+    {
+        prepare();
+
+        mInvocation = createInvocation(kernel);
+        mInvocation.record(mNumWorkgroups);
+    }
+
+    clspv_utils::execution_time_t Test::replay(clspv_utils::kernel& kernel)
+    {
+        return mInvocation.replay();
     }
 
     std::string Test::getParameterString() const
@@ -164,7 +203,11 @@ namespace generic_kernel {
 
     test_utils::KernelTest::invocation_tests getAllTestVariants()
     {
-        return test_utils::KernelTest::invocation_tests({ test_utils::make_invocation_test<Test>("") });
+        const auto localArraySizes = [](const vk::Extent3D&, const std::vector<std::string>& args) {
+            return findLocalArraySizes(args);
+        };
+
+        return test_utils::KernelTest::invocation_tests({ test_utils::make_invocation_test<Test>("", localArraySizes) });
     }
 
     formatter::formatter(const char*           entryPoint,
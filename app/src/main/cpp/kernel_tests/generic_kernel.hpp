@@ -6,6 +6,7 @@
 #define CLSPVTEST_GENERIC_KERNEL_HPP
 
 #include "clspv_utils/clspv_utils_fwd.hpp"
+#include "clspv_utils/invocation.hpp"
 #include "test_utils.hpp"
 #include "vulkan_utils/vulkan_utils.hpp"
 
@@ -16,7 +17,7 @@ namespace generic_kernel {
     struct Test : public test_utils::Test
     {
         typedef std::vector<vulkan_utils::buffer>           storage_list;
-        typedef std::vector<vulkan_utils::buffer>           uniform_list;
+        typedef std::vector<std::vector<std::uint8_t>>      uniform_list;
         typedef std::vector<std::size_t>                    local_size_list;
 
         enum arg_kind
@@ -36,16 +37,22 @@ namespace generic_kernel {
 
         virtual test_utils::Evaluation evaluate(bool verbose) override;
 
-        std::string             mParameterString;
+        virtual void record(clspv_utils::kernel& kernel) override;
+
+        virtual clspv_utils::execution_time_t replay(clspv_utils::kernel& kernel) override;
 
-        // TODO unify storage_list and uniform_list into buffer_list
+        clspv_utils::invocation createInvocation(clspv_utils::kernel& kernel);
+
+        std::string             mParameterString;
 
         storage_list            mStorageBuffers;
-        uniform_list            mUniformBuffers;
+        uniform_list            mUniformArguments;
         local_size_list         mLocalArraySizes;
         std::vector<arg_kind>   mArgOrder;
 
         vk::Extent3D        mNumWorkgroups;
+
+        clspv_utils::invocation mInvocation;
     };
 
     class formatter
@@ -4,36 +4,46 @@
 
 #include "readconstantdata_kernel.hpp"
 
+#include "clspv_utils/invocation.hpp"
 #include "clspv_utils/kernel.hpp"
 
-namespace readconstantdata_kernel {
-
-    clspv_utils::execution_time_t
-    invoke(clspv_utils::kernel&     kernel,
-           vulkan_utils::buffer&    dst_buffer,
-           int                      width)
-    {
-        struct scalar_args {
-            int inWidth;            // offset 0
-        };
-        static_assert(0 == offsetof(scalar_args, inWidth), "inWidth offset incorrect");
+namespace {
 
-        vulkan_utils::buffer scalarBuffer = vulkan_utils::createUniformBuffer(kernel.getDevice().getDevice(),
-                                                                              kernel.getDevice().getMemoryProperties(),
-                                                                              sizeof(scalar_args));
-        auto scalars = scalarBuffer.map<scalar_args>();
-        scalars->inWidth = width;
-        scalars.reset();
+    struct scalar_args {
+        int inWidth;            // offset 0
+    };
+    static_assert(0 == offsetof(scalar_args, inWidth), "inWidth offset incorrect");
 
-        const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
-                                                                          vk::Extent3D(width, 1, 1));
+    clspv_utils::invocation createInvocation(clspv_utils::kernel&   kernel,
+                                             vulkan_utils::buffer&  dst_buffer,
+                                             int                    width)
+    {
+        scalar_args scalars;
+        scalars.inWidth = width;
 
         clspv_utils::invocation invocation(kernel.createInvocationReq());
 
         invocation.addStorageBufferArgument(dst_buffer);
-        invocation.addUniformBufferArgument(scalarBuffer);
+        invocation.addUniformBufferArgument(&scalars, sizeof(scalars));
 
-        return invocation.run(num_workgroups);
+        return invocation;
+    }
+
+    vk::Extent3D computeNumWorkgroups(clspv_utils::kernel& kernel, int width)
+    {
+        return vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(), vk::Extent3D(width, 1, 1));
+    }
+
+}
+
+namespace readconstantdata_kernel {
+
+    clspv_utils::execution_time_t
+    invoke(clspv_utils::kernel&     kernel,
+           vulkan_utils::buffer&    dst_buffer,
+           int                      width)
+    {
+        return createInvocation(kernel, dst_buffer, width).run(computeNumWorkgroups(kernel, width));
     }
 
     Test::Test(clspv_utils::kernel& kernel, const std::vector<std::string>& args) :
@@ -48,8 +58,7 @@ namespace readconstantdata_kernel {
         const std::size_t constant_data_length = 12;
 
         // allocate buffers and images
-        mDstBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                       device.getMemoryProperties(),
+        mDstBuffer = vulkan_utils::createStorageBuffer(device.getMemoryAllocator(),
                                                        buffer_size);
 
         // set up expected results of the destination buffer
@@ -83,6 +92,19 @@ namespace readconstantdata_kernel {
                       mBufferExtent.width);
     }
 
+    void Test::record(clspv_utils::kernel& kernel)
+    {
+        prepare();
+
+        mInvocation = createInvocation(kernel, mDstBuffer, mBufferExtent.width);
+        mInvocation.record(computeNumWorkgroups(kernel, mBufferExtent.width));
+    }
+
+    clspv_utils::execution_time_t Test::replay(clspv_utils::kernel& kernel)
+    {
+        return mInvocation.replay();
+    }
+
     test_utils::Evaluation Test::evaluate(bool verbose)
     {
         auto dstBufferMap = mDstBuffer.map<float>();
@@ -6,6 +6,7 @@
 #define CLSPVTEST_READCONSTANTDATA_KERNEL_HPP
 
 #include "clspv_utils/clspv_utils_fwd.hpp"
+#include "clspv_utils/invocation.hpp"
 #include "gpu_types.hpp"
 #include "test_utils.hpp"
 #include "vulkan_utils/vulkan_utils.hpp"
@@ -29,9 +30,15 @@ namespace readconstantdata_kernel {
 
         virtual test_utils::Evaluation evaluate(bool verbose) override;
 
+        virtual void record(clspv_utils::kernel& kernel) override;
+
+        virtual clspv_utils::execution_time_t replay(clspv_utils::kernel& kernel) override;
+
         vk::Extent3D            mBufferExtent;
         vulkan_utils::buffer    mDstBuffer;
         std::vector<float>      mExpectedResults;
+
+        clspv_utils::invocation mInvocation;
     };
 
     test_utils::KernelTest::invocation_tests getAllTestVariants();
@@ -319,13 +319,13 @@ namespace {
 
 namespace readlocalsize_kernel {
 
-    clspv_utils::execution_time_t
-    invoke(clspv_utils::kernel&     kernel,
-           vulkan_utils::buffer&    outLocalSizes,
-           int                      inWidth,
-           int                      inHeight,
-           int                      inPitch,
-           idtype_t                 inIdType) {
+    test_utils::Dispatch
+    makeDispatch(clspv_utils::kernel&     kernel,
+                 vulkan_utils::buffer&    outLocalSizes,
+                 int                      inWidth,
+                 int                      inHeight,
+                 int                      inPitch,
+                 idtype_t                 inIdType) {
         struct scalar_args {
             int width;  // offset 0
             int height; // offset 4
@@ -337,15 +337,11 @@ namespace readlocalsize_kernel {
         static_assert(8 == offsetof(scalar_args, pitch), "pitch offset incorrect");
         static_assert(12 == offsetof(scalar_args, idtype), "idtype offset incorrect");
 
-        vulkan_utils::buffer scalarBuffer = vulkan_utils::createUniformBuffer(kernel.getDevice().getDevice(),
-                                                                              kernel.getDevice().getMemoryProperties(),
-                                                                              sizeof(scalar_args));
-        auto scalars = scalarBuffer.map<scalar_args>();
-        scalars->width = inWidth;
-        scalars->height = inHeight;
-        scalars->pitch = inPitch;
-        scalars->idtype = inIdType;
-        scalars.reset();
+        scalar_args scalars;
+        scalars.width = inWidth;
+        scalars.height = inHeight;
+        scalars.pitch = inPitch;
+        scalars.idtype = inIdType;
 
         const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
                                                                           vk::Extent3D(inWidth, inHeight, 1));
@@ -353,9 +349,20 @@ namespace readlocalsize_kernel {
         clspv_utils::invocation invocation(kernel.createInvocationReq());
 
         invocation.addStorageBufferArgument(outLocalSizes);
-        invocation.addUniformBufferArgument(scalarBuffer);
+        invocation.addUniformBufferArgument(&scalars, sizeof(scalars));
+
+        return test_utils::Dispatch{ std::move(invocation), num_workgroups };
+    }
 
-        return invocation.run(num_workgroups);
+    clspv_utils::execution_time_t
+    invoke(clspv_utils::kernel&     kernel,
+           vulkan_utils::buffer&    outLocalSizes,
+           int                      inWidth,
+           int                      inHeight,
+           int                      inPitch,
+           idtype_t                 inIdType)
+    {
+        return test_utils::run_dispatch(makeDispatch(kernel, outLocalSizes, inWidth, inHeight, inPitch, inIdType));
     }
 
     Test::Test(clspv_utils::kernel& kernel, const std::vector<std::string>& args) :
@@ -372,8 +379,7 @@ namespace readlocalsize_kernel {
         // allocate data buffer
         auto num_elements = mBufferExtent.width * mBufferExtent.height * mBufferExtent.depth;
         const std::size_t buffer_size = num_elements * sizeof(std::int32_t);
-        mDstBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                       device.getMemoryProperties(),
+        mDstBuffer = vulkan_utils::createStorageBuffer(device.getMemoryAllocator(),
                                                        buffer_size);
 
         mExpectedResults = compute_expected_results(mIdType,
@@ -396,14 +402,14 @@ namespace readlocalsize_kernel {
         return string_from_idtype(mIdType);
     }
 
-    clspv_utils::execution_time_t Test::run(clspv_utils::kernel& kernel)
+    test_utils::Dispatch Test::createDispatch(clspv_utils::kernel& kernel)
     {
-        return invoke(kernel,
-                      mDstBuffer,
-                      mBufferExtent.width,
-                      mBufferExtent.height,
-                      mBufferExtent.width,
-                      mIdType);
+        return makeDispatch(kernel,
+                            mDstBuffer,
+                            mBufferExtent.width,
+                            mBufferExtent.height,
+                            mBufferExtent.width,
+                            mIdType);
     }
 
     test_utils::Evaluation Test::evaluate(bool verbose)
@@ -35,6 +35,14 @@ namespace readlocalsize_kernel {
     };
 
 
+    test_utils::Dispatch
+    makeDispatch(clspv_utils::kernel&     kernel,
+                 vulkan_utils::buffer&    outLocalSizes,
+                 int                      inWidth,
+                 int                      inHeight,
+                 int                      inPitch,
+                 idtype_t                 inIdType);
+
     clspv_utils::execution_time_t
     invoke(clspv_utils::kernel&     kernel,
            vulkan_utils::buffer&    outLocalSizes,
@@ -44,7 +52,7 @@ namespace readlocalsize_kernel {
            idtype_t                 inIdType);
 
 
-    struct Test : public test_utils::Test
+    struct Test : public test_utils::DispatchTest
     {
         Test(clspv_utils::kernel& kernel, const std::vector<std::string>& args);
 
@@ -52,7 +60,7 @@ namespace readlocalsize_kernel {
 
         virtual std::string getParameterString() const override;
 
-        virtual clspv_utils::execution_time_t run(clspv_utils::kernel& kernel) override;
+        virtual test_utils::Dispatch createDispatch(clspv_utils::kernel& kernel) override;
 
         virtual test_utils::Evaluation  evaluate(bool verbose) override;
 
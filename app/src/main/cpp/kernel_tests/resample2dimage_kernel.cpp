@@ -51,11 +51,11 @@ namespace {
 
 namespace resample2dimage_kernel {
 
-    clspv_utils::execution_time_t
-    invoke(clspv_utils::kernel&     kernel,
-           vulkan_utils::image&     src_image,
-           vulkan_utils::buffer&    dst_buffer,
-           vk::Extent3D             extent)
+    test_utils::Dispatch
+    makeDispatch(clspv_utils::kernel&     kernel,
+                 vulkan_utils::image&     src_image,
+                 vulkan_utils::buffer&    dst_buffer,
+                 vk::Extent3D             extent)
     {
         if (1 != extent.depth)
         {
@@ -69,13 +69,9 @@ namespace resample2dimage_kernel {
         static_assert(0 == offsetof(scalar_args, inWidth), "inWidth offset incorrect");
         static_assert(4 == offsetof(scalar_args, inHeight), "inHeight offset incorrect");
 
-        vulkan_utils::buffer scalarBuffer = vulkan_utils::createUniformBuffer(kernel.getDevice().getDevice(),
-                                                                              kernel.getDevice().getMemoryProperties(),
-                                                                              sizeof(scalar_args));
-        auto scalars = scalarBuffer.map<scalar_args>();
-        scalars->inWidth = extent.width;
-        scalars->inHeight = extent.height;
-        scalars.reset();
+        scalar_args scalars;
+        scalars.inWidth = extent.width;
+        scalars.inHeight = extent.height;
 
         const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
                                                                           extent);
@@ -84,9 +80,18 @@ namespace resample2dimage_kernel {
 
         invocation.addReadOnlyImageArgument(src_image);
         invocation.addStorageBufferArgument(dst_buffer);
-        invocation.addUniformBufferArgument(scalarBuffer);
+        invocation.addUniformBufferArgument(&scalars, sizeof(scalars));
+
+        return test_utils::Dispatch{ std::move(invocation), num_workgroups };
+    }
 
-        return invocation.run(num_workgroups);
+    clspv_utils::execution_time_t
+    invoke(clspv_utils::kernel&     kernel,
+           vulkan_utils::image&     src_image,
+           vulkan_utils::buffer&    dst_buffer,
+           vk::Extent3D             extent)
+    {
+        return test_utils::run_dispatch(makeDispatch(kernel, src_image, dst_buffer, extent));
     }
 
     Test::Test(clspv_utils::kernel& kernel, const std::vector<std::string>& args) :
@@ -107,16 +112,13 @@ namespace resample2dimage_kernel {
         const std::size_t buffer_size = buffer_length * sizeof(BufferPixelType);
 
         // allocate buffers and images
-        mDstBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                       device.getMemoryProperties(),
+        mDstBuffer = vulkan_utils::createStorageBuffer(device.getMemoryAllocator(),
                                                        buffer_size);
-        mSrcImage = vulkan_utils::image(device.getDevice(),
-                                     device.getMemoryProperties(),
+        mSrcImage = vulkan_utils::image(device.getMemoryAllocator(),
                                      vk::Extent3D(image_width, image_height, 1),
                                      vk::Format(pixels::traits<ImagePixelType>::vk_pixel_type),
                                      vulkan_utils::image::kUsage_ReadOnly);
-        mSrcImageStaging = vulkan_utils::createStagingBuffer(device.getDevice(),
-                                                             device.getMemoryProperties(),
+        mSrcImageStaging = vulkan_utils::createStagingBuffer(device.getMemoryAllocator(),
                                                              mSrcImage,
                                                              true,
                                                              false);
@@ -168,12 +170,12 @@ namespace resample2dimage_kernel {
         std::fill(dstBufferMap.get(), dstBufferMap.get() + buffer_length, BufferPixelType(0.0f, 0.0f, 0.0f, 0.0f));
     }
 
-    clspv_utils::execution_time_t Test::run(clspv_utils::kernel& kernel)
+    test_utils::Dispatch Test::createDispatch(clspv_utils::kernel& kernel)
     {
-        return invoke(kernel,
-                      mSrcImage,
-                      mDstBuffer,
-                      mBufferExtent);
+        return makeDispatch(kernel,
+                            mSrcImage,
+                            mDstBuffer,
+                            mBufferExtent);
     }
 
     test_utils::Evaluation Test::evaluate(bool verbose)
@@ -14,13 +14,19 @@
 
 namespace resample2dimage_kernel {
 
+    test_utils::Dispatch
+    makeDispatch(clspv_utils::kernel&     kernel,
+                 vulkan_utils::image&     src_image,
+                 vulkan_utils::buffer&    dst_buffer,
+                 vk::Extent3D             extent);
+
     clspv_utils::execution_time_t
     invoke(clspv_utils::kernel&     kernel,
            vulkan_utils::image&     src_image,
            vulkan_utils::buffer&    dst_buffer,
            vk::Extent3D             extent);
 
-    struct Test : public test_utils::Test
+    struct Test : public test_utils::DispatchTest
     {
         typedef gpu_types::float4 BufferPixelType;
         typedef gpu_types::float4 ImagePixelType;
@@ -29,7 +35,7 @@ namespace resample2dimage_kernel {
 
         virtual void prepare() override;
 
-        virtual clspv_utils::execution_time_t run(clspv_utils::kernel& kernel) override;
+        virtual test_utils::Dispatch createDispatch(clspv_utils::kernel& kernel) override;
 
         virtual test_utils::Evaluation evaluate(bool verbose) override;
 
@@ -20,13 +20,13 @@ namespace {
 
 namespace resample3dimage_kernel {
 
-    clspv_utils::execution_time_t
-    invoke(clspv_utils::kernel&     kernel,
-           vulkan_utils::image&     src_image,
-           vulkan_utils::buffer&    dst_buffer,
-           int                      width,
-           int                      height,
-           int                      depth)
+    test_utils::Dispatch
+    makeDispatch(clspv_utils::kernel&     kernel,
+                 vulkan_utils::image&     src_image,
+                 vulkan_utils::buffer&    dst_buffer,
+                 int                      width,
+                 int                      height,
+                 int                      depth)
     {
         struct scalar_args {
             int inWidth;            // offset 0
@@ -37,14 +37,10 @@ namespace resample3dimage_kernel {
         static_assert(4 == offsetof(scalar_args, inHeight), "inHeight offset incorrect");
         static_assert(8 == offsetof(scalar_args, inDepth), "inDepth offset incorrect");
 
-        vulkan_utils::buffer scalarBuffer = vulkan_utils::createUniformBuffer(kernel.getDevice().getDevice(),
-                                                                              kernel.getDevice().getMemoryProperties(),
-                                                                              sizeof(scalar_args));
-        auto scalars = scalarBuffer.map<scalar_args>();
-        scalars->inWidth = width;
-        scalars->inHeight = height;
-        scalars->inDepth = depth;
-        scalars.reset();
+        scalar_args scalars;
+        scalars.inWidth = width;
+        scalars.inHeight = height;
+        scalars.inDepth = depth;
 
         const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
                                                                           vk::Extent3D(width, height, depth));
@@ -53,9 +49,20 @@ namespace resample3dimage_kernel {
 
         invocation.addReadOnlyImageArgument(src_image);
         invocation.addStorageBufferArgument(dst_buffer);
-        invocation.addUniformBufferArgument(scalarBuffer);
+        invocation.addUniformBufferArgument(&scalars, sizeof(scalars));
+
+        return test_utils::Dispatch{ std::move(invocation), num_workgroups };
+    }
 
-        return invocation.run(num_workgroups);
+    clspv_utils::execution_time_t
+    invoke(clspv_utils::kernel&     kernel,
+           vulkan_utils::image&     src_image,
+           vulkan_utils::buffer&    dst_buffer,
+           int                      width,
+           int                      height,
+           int                      depth)
+    {
+        return test_utils::run_dispatch(makeDispatch(kernel, src_image, dst_buffer, width, height, depth));
     }
 
     Test::Test(clspv_utils::kernel& kernel, const std::vector<std::string>& args) :
@@ -83,16 +90,13 @@ namespace resample3dimage_kernel {
         };
 
         // allocate buffers and images
-        mDstBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                       device.getMemoryProperties(),
+        mDstBuffer = vulkan_utils::createStorageBuffer(device.getMemoryAllocator(),
                                                        buffer_size);
-        mSrcImage = vulkan_utils::image(device.getDevice(),
-                                     device.getMemoryProperties(),
+        mSrcImage = vulkan_utils::image(device.getMemoryAllocator(),
                                      imageExtent,
                                      vk::Format(pixels::traits<ImagePixelType>::vk_pixel_type),
                                      vulkan_utils::image::kUsage_ReadOnly);
-        mSrcImageStaging = vulkan_utils::createStagingBuffer(device.getDevice(),
-                                                             device.getMemoryProperties(),
+        mSrcImageStaging = vulkan_utils::createStagingBuffer(device.getMemoryAllocator(),
                                                              mSrcImage,
                                                              true,
                                                              false);
@@ -150,14 +154,14 @@ namespace resample3dimage_kernel {
         std::fill(dstBufferMap.get(), dstBufferMap.get() + buffer_length, gpu_types::float4(0.0f, 0.0f, 0.0f, 0.0f));
     }
 
-    clspv_utils::execution_time_t Test::run(clspv_utils::kernel& kernel)
+    test_utils::Dispatch Test::createDispatch(clspv_utils::kernel& kernel)
     {
-        return invoke(kernel,
-                      mSrcImage,
-                      mDstBuffer,
-                      mBufferExtent.width,
-                      mBufferExtent.height,
-                      mBufferExtent.depth);
+        return makeDispatch(kernel,
+                            mSrcImage,
+                            mDstBuffer,
+                            mBufferExtent.width,
+                            mBufferExtent.height,
+                            mBufferExtent.depth);
     }
 
     test_utils::Evaluation Test::evaluate(bool verbose)
@@ -14,6 +14,14 @@
 
 namespace resample3dimage_kernel {
 
+    test_utils::Dispatch
+    makeDispatch(clspv_utils::kernel &kernel,
+                 vulkan_utils::image &src_image,
+                 vulkan_utils::buffer &dst_buffer,
+                 int width,
+                 int height,
+                 int depth);
+
     clspv_utils::execution_time_t
     invoke(clspv_utils::kernel &kernel,
            vulkan_utils::image &src_image,
@@ -22,7 +30,7 @@ namespace resample3dimage_kernel {
            int height,
            int depth);
 
-    struct Test : public test_utils::Test
+    struct Test : public test_utils::DispatchTest
     {
         typedef gpu_types::float4 BufferPixelType;
         typedef gpu_types::float4 ImagePixelType;
@@ -31,7 +39,7 @@ namespace resample3dimage_kernel {
 
         virtual void prepare() override;
 
-        virtual clspv_utils::execution_time_t run(clspv_utils::kernel& kernel) override;
+        virtual test_utils::Dispatch createDispatch(clspv_utils::kernel& kernel) override;
 
         virtual test_utils::Evaluation evaluate(bool verbose) override;
 
@@ -6,14 +6,22 @@
 
 #include "clspv_utils/kernel.hpp"
 
+namespace {
+    // The kernel's local array holds two elements per work item
+    std::uint32_t local_array_size(const vk::Extent3D& workgroup_sizes)
+    {
+        return 2 * workgroup_sizes.width;
+    }
+}
+
 namespace strangeshuffle_kernel {
 
-    clspv_utils::execution_time_t
-    invoke(clspv_utils::kernel&     kernel,
-           vulkan_utils::buffer&    index_buffer,
-           vulkan_utils::buffer&    source_buffer,
-           vulkan_utils::buffer&    destination_buffer,
-           std::size_t              num_elements)
+    test_utils::Dispatch
+    makeDispatch(clspv_utils::kernel&     kernel,
+                 vulkan_utils::buffer&    index_buffer,
+                 vulkan_utils::buffer&    source_buffer,
+                 vulkan_utils::buffer&    destination_buffer,
+                 std::size_t              num_elements)
     {
         if (0 != (num_elements % 2)) {
             throw std::runtime_error("num_elements must be even");
@@ -28,8 +36,18 @@ namespace strangeshuffle_kernel {
         invocation.addStorageBufferArgument(index_buffer);
         invocation.addStorageBufferArgument(source_buffer);
         invocation.addStorageBufferArgument(destination_buffer);
-        invocation.addLocalArraySizeArgument(2 * workgroup_sizes.width);
-        return invocation.run(num_workgroups);
+        invocation.addLocalArraySizeArgument(local_array_size(workgroup_sizes));
+        return test_utils::Dispatch{ std::move(invocation), num_workgroups };
+    }
+
+    clspv_utils::execution_time_t
+    invoke(clspv_utils::kernel&     kernel,
+           vulkan_utils::buffer&    index_buffer,
+           vulkan_utils::buffer&    source_buffer,
+           vulkan_utils::buffer&    destination_buffer,
+           std::size_t              num_elements)
+    {
+        return test_utils::run_dispatch(makeDispatch(kernel, index_buffer, source_buffer, destination_buffer, num_elements));
     }
 
     Test::Test(clspv_utils::kernel& kernel, const std::vector<std::string>& args) :
@@ -39,17 +57,14 @@ namespace strangeshuffle_kernel {
 
         // allocate source and destination buffers
         const std::size_t pixel_buffer_size = mBufferWidth * sizeof(gpu_types::float4);
-        mSrcBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                       device.getMemoryProperties(),
+        mSrcBuffer = vulkan_utils::createStorageBuffer(device.getMemoryAllocator(),
                                                        pixel_buffer_size);
-        mDstBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                       device.getMemoryProperties(),
+        mDstBuffer = vulkan_utils::createStorageBuffer(device.getMemoryAllocator(),
                                                        pixel_buffer_size);
 
         // allocate index buffer
         const std::size_t index_buffer_size = mBufferWidth * sizeof(int32_t);
-        mIndexBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                         device.getMemoryProperties(),
+        mIndexBuffer = vulkan_utils::createStorageBuffer(device.getMemoryAllocator(),
                                                          index_buffer_size);
 
         auto srcBufferMap = mSrcBuffer.map<gpu_types::float4>();
@@ -65,13 +80,13 @@ namespace strangeshuffle_kernel {
         test_utils::fill_random_pixels<gpu_types::float4>(dstBufferMap.get(), dstBufferMap.get() + mBufferWidth);
     }
 
-    clspv_utils::execution_time_t Test::run(clspv_utils::kernel& kernel)
+    test_utils::Dispatch Test::createDispatch(clspv_utils::kernel& kernel)
     {
-        return invoke(kernel,
-                      mIndexBuffer,
-                      mSrcBuffer,
-                      mDstBuffer,
-                      mBufferWidth);
+        return makeDispatch(kernel,
+                            mIndexBuffer,
+                            mSrcBuffer,
+                            mDstBuffer,
+                            mBufferWidth);
     }
 
     test_utils::Evaluation Test::evaluate(bool verbose)
@@ -88,6 +103,10 @@ namespace strangeshuffle_kernel {
 
     test_utils::KernelTest::invocation_tests getAllTestVariants()
     {
-        return test_utils::KernelTest::invocation_tests({ test_utils::make_invocation_test<Test>("") });
+        const auto localArraySizes = [](const vk::Extent3D& workgroupSize, const std::vector<std::string>&) {
+            return std::vector<std::uint32_t>({ local_array_size(workgroupSize) });
+        };
+
+        return test_utils::KernelTest::invocation_tests({ test_utils::make_invocation_test<Test>("", localArraySizes) });
     }
 }
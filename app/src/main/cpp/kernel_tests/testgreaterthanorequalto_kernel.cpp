@@ -8,10 +8,10 @@
 
 namespace testgreaterthanorequalto_kernel {
 
-    clspv_utils::execution_time_t
-    invoke(clspv_utils::kernel&     kernel,
-           vulkan_utils::buffer&    dst_buffer,
-           vk::Extent3D             extent)
+    test_utils::Dispatch
+    makeDispatch(clspv_utils::kernel&     kernel,
+                 vulkan_utils::buffer&    dst_buffer,
+                 vk::Extent3D             extent)
     {
         if (1 != extent.depth)
         {
@@ -25,13 +25,9 @@ namespace testgreaterthanorequalto_kernel {
         static_assert(0 == offsetof(scalar_args, inWidth), "inWidth offset incorrect");
         static_assert(4 == offsetof(scalar_args, inHeight), "inHeight offset incorrect");
 
-        vulkan_utils::buffer scalarBuffer = vulkan_utils::createUniformBuffer(kernel.getDevice().getDevice(),
-                                                                              kernel.getDevice().getMemoryProperties(),
-                                                                              sizeof(scalar_args));
-        auto scalars = scalarBuffer.map<scalar_args>();
-        scalars->inWidth = extent.width;
-        scalars->inHeight = extent.height;
-        scalars.reset();
+        scalar_args scalars;
+        scalars.inWidth = extent.width;
+        scalars.inHeight = extent.height;
 
         const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
                                                                           extent);
@@ -39,9 +35,17 @@ namespace testgreaterthanorequalto_kernel {
         clspv_utils::invocation invocation(kernel.createInvocationReq());
 
         invocation.addStorageBufferArgument(dst_buffer);
-        invocation.addUniformBufferArgument(scalarBuffer);
+        invocation.addUniformBufferArgument(&scalars, sizeof(scalars));
+
+        return test_utils::Dispatch{ std::move(invocation), num_workgroups };
+    }
 
-        return invocation.run(num_workgroups);
+    clspv_utils::execution_time_t
+    invoke(clspv_utils::kernel&     kernel,
+           vulkan_utils::buffer&    dst_buffer,
+           vk::Extent3D             extent)
+    {
+        return test_utils::run_dispatch(makeDispatch(kernel, dst_buffer, extent));
     }
 
     Test::Test(clspv_utils::kernel& kernel, const std::vector<std::string>& args) :
@@ -53,8 +57,7 @@ namespace testgreaterthanorequalto_kernel {
         const std::size_t buffer_size = buffer_length * sizeof(float);
 
         // allocate buffers and images
-        mDstBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                       device.getMemoryProperties(),
+        mDstBuffer = vulkan_utils::createStorageBuffer(device.getMemoryAllocator(),
                                                        buffer_size);
 
         // set up expected results of the destination buffer
@@ -81,11 +84,11 @@ namespace testgreaterthanorequalto_kernel {
         dstBufferMap.reset();
     }
 
-    clspv_utils::execution_time_t Test::run(clspv_utils::kernel& kernel)
+    test_utils::Dispatch Test::createDispatch(clspv_utils::kernel& kernel)
     {
-        return invoke(kernel,
-                      mDstBuffer,
-                      mBufferExtent);
+        return makeDispatch(kernel,
+                            mDstBuffer,
+                            mBufferExtent);
     }
 
     test_utils::Evaluation Test::evaluate(bool verbose)
@@ -4,22 +4,18 @@
 
 #include "memmove_test.hpp"
 
+#include "test_statistics.hpp"
 #include "test_utils.hpp"
 #include "util.hpp"
 #include "vulkan_utils/vulkan_utils.hpp"
 
 #include <vulkan/vulkan.hpp>
 
-#include "boost/accumulators/accumulators.hpp"
-#include "boost/accumulators/statistics.hpp"
-#include "boost/accumulators/statistics/mean.hpp"
-#include "boost/accumulators/statistics/max.hpp"
-#include "boost/accumulators/statistics/min.hpp"
-#include "boost/accumulators/statistics/variance.hpp"
 #include <boost/units/io.hpp>
 #include <boost/units/systems/information.hpp>
 #include <boost/units/systems/si.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <sstream>
@@ -28,58 +24,10 @@
 
 namespace {
 
-    template <typename T>
-    struct statistics {
-        typedef T   value_type;
-        typedef T   variance_type;
+    // Leading iterations run to warm caches and page tables, and left out of the statistics
+    const unsigned int kWarmupIterations = 1;
 
-        unsigned int    count       = 0;
-        value_type      mean        = value_type();
-        value_type      min         = value_type();
-        value_type      max         = value_type();
-        variance_type   variance    = variance_type();
-    };
-
-    template <>
-    struct statistics<boost::units::quantity<boost::units::si::time>> {
-        typedef boost::units::derived_dimension<boost::units::time_base_dimension, 2>::type time_variance_dimension;
-        typedef boost::units::unit<time_variance_dimension, boost::units::si::system> time_variance;
-
-        typedef boost::units::quantity<boost::units::si::time>  value_type;
-        typedef boost::units::quantity<time_variance>           variance_type;
-
-        unsigned int    count       = 0;
-        value_type      mean        = value_type();
-        value_type      min         = value_type();
-        value_type      max         = value_type();
-        variance_type   variance    = variance_type();
-    };
-
-    template <typename T>
-    statistics<typename T::value_type> compute_stats(const T& container)
-    {
-        namespace ba = boost::accumulators;
-
-        ba::accumulator_set<typename T::value_type,
-                            ba::stats<ba::tag::count,
-                                      ba::tag::mean,
-                                      ba::tag::variance,
-                                      ba::tag::max,
-                                      ba::tag::min>> acc;
-        acc = std::for_each(std::begin(container), std::end(container), acc);
-
-        statistics<typename T::value_type> result;
-        result.count = ba::count(acc);
-        result.mean = ba::mean(acc);
-        result.max = ba::max(acc);
-        result.min = ba::min(acc);
-        result.variance = ba::variance(acc);
-
-        return result;
-    }
-
-    statistics<boost::units::quantity<boost::units::si::time>>
-    compute_stats(const std::vector<test_utils::StopWatch::duration>& durations)
+    test_statistics::summary compute_stats(const std::vector<test_utils::StopWatch::duration>& durations)
     {
         std::vector<double> values;
         values.reserve(durations.size());
@@ -87,18 +35,11 @@ namespace {
         std::transform(durations.begin(), durations.end(),
                        std::back_inserter(values),
                        [](const test_utils::StopWatch::duration& d) { return d.count(); });
-        const auto scalarStats = compute_stats(values);
 
-        statistics<boost::units::quantity<boost::units::si::time>> results;
-        results.count = scalarStats.count;
-        results.mean = scalarStats.mean * boost::units::si::seconds;
-        results.min = scalarStats.min * boost::units::si::seconds;
-        results.max = scalarStats.max * boost::units::si::seconds;
-        results.variance = scalarStats.variance * boost::units::si::seconds * boost::units::si::seconds;
-
-        return results;
+        return test_statistics::summarize(values);
     }
 
+#if defined(__ANDROID__)
     class AHBBuffer {
     public:
         AHBBuffer();
@@ -153,6 +94,7 @@ namespace {
         swap(mBuffer, other.mBuffer);
         swap(mMappedPtr, other.mMappedPtr);
     }
+#endif
 
     template <typename Fn>
     void runOneTest(const std::string& label,
@@ -160,20 +102,27 @@ namespace {
                     unsigned int numIterations,
                     Fn testFn)
     {
-        const auto stats = compute_stats(testFn(bufferSize, numIterations));
+        auto durations = testFn(bufferSize, kWarmupIterations + numIterations);
+        durations.erase(durations.begin(), durations.begin() + std::min<std::size_t>(kWarmupIterations, durations.size()));
+        const auto stats = compute_stats(durations);
 
+        const auto seconds = boost::units::si::seconds;
         const boost::units::quantity<boost::units::information::info> bufferBytes = bufferSize * boost::units::information::bytes;
 
         std::ostringstream os;
         os << boost::units::engineering_prefix
            << label
            << " bufferSize:" << bufferBytes
-           << " count:" << stats.count
-           << " mean:" << stats.mean
-           << " rate:" << bufferBytes/stats.mean
-           << " variance" << stats.variance
-           << " max:" << stats.max
-           << " min:" << stats.min;
+           << " count:" << stats.mCount
+           << " mean:" << stats.mMean * seconds
+           << " rate:" << bufferBytes/(stats.mMean * seconds)
+           << " stdDeviation:" << stats.mStdDeviation * seconds
+           << " median:" << stats.mMedian * seconds
+           << " mad:" << stats.mMad * seconds
+           << " p90:" << stats.mP90 * seconds
+           << " p99:" << stats.mP99 * seconds
+           << " max:" << stats.mMax * seconds
+           << " min:" << stats.mMin * seconds;
 
         LOGI("%s", os.str().c_str());
     }
@@ -189,17 +138,17 @@ namespace memmove_test{
         return timeTransfer(source.data(), destination.data(), bufferSize, iterations);
     }
 
-    std::vector<test_utils::StopWatch::duration> timeSystem2VkDeviceMemory(vk::Device device,
+    std::vector<test_utils::StopWatch::duration> timeSystem2VkDeviceMemory(vulkan_utils::memory_allocator& allocator,
                                                                            std::size_t bufferSize,
-                                                                           const vk::PhysicalDeviceMemoryProperties &memProps,
                                                                            vk::BufferUsageFlags usageFlags,
                                                                            unsigned int iterations) {
         std::vector<std::uint8_t>   source(bufferSize);
-        vulkan_utils::buffer        destBuffer(device, memProps, bufferSize, usageFlags);
+        vulkan_utils::buffer        destBuffer(allocator, bufferSize, usageFlags, vulkan_utils::buffer::kMapping_Persistent);
 
-        auto destination = destBuffer.map();
+        auto results = timeTransfer(source.data(), destBuffer.getMappedData(), bufferSize, iterations);
+        destBuffer.flush();
 
-        return timeTransfer(source.data(), destination.get(), bufferSize, iterations);
+        return results;
     }
 
     std::vector<test_utils::StopWatch::duration> timeTransfer(const void* source,
@@ -244,8 +193,9 @@ namespace memmove_test{
         const std::size_t   bufferSize      = 3840 * 2160 * 4;
         const unsigned int  numIterations   = 10;
 
-        const vk::Device                            device      = *info.device;
-        const vk::PhysicalDeviceMemoryProperties    memProps    = info.gpu.getMemoryProperties();
+        vulkan_utils::memory_allocator allocator(*info.device,
+                                                 info.gpu.getMemoryProperties(),
+                                                 info.gpu.getProperties().limits);
 
         for (auto size : bufferSizes)
         {
@@ -253,9 +203,9 @@ namespace memmove_test{
 
             for (auto usage : usageFlags)
             {
-                const auto timeSystem2Vulkan = [&device, &memProps, usage](std::size_t bufferSize,
-                                                                           unsigned int numIterations) {
-                    return timeSystem2VkDeviceMemory(device, bufferSize, memProps,
+                const auto timeSystem2Vulkan = [&allocator, usage](std::size_t bufferSize,
+                                                                   unsigned int numIterations) {
+                    return timeSystem2VkDeviceMemory(allocator, bufferSize,
                                                      usage,
                                                      numIterations);
                 };
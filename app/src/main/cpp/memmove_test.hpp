@@ -7,6 +7,7 @@
 
 #include "test_utils.hpp"
 #include "util.hpp"
+#include "vulkan_utils/memory_allocator.hpp"
 
 #include <vulkan/vulkan.hpp>
 
@@ -18,9 +19,8 @@ namespace memmove_test {
     std::vector<test_utils::StopWatch::duration> timeSystem2System(std::size_t bufferSize,
                                                                    unsigned int iterations);
 
-    std::vector<test_utils::StopWatch::duration> timeSystem2VkDeviceMemory(vk::Device device,
+    std::vector<test_utils::StopWatch::duration> timeSystem2VkDeviceMemory(vulkan_utils::memory_allocator& allocator,
                                                                            std::size_t bufferSize,
-                                                                           const vk::PhysicalDeviceMemoryProperties &memProps,
                                                                            vk::BufferUsageFlags usageFlags,
                                                                            unsigned int iterations);
 
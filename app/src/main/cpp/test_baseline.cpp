@@ -0,0 +1,318 @@
+#include "test_baseline.hpp"
+
+#include "test_statistics.hpp"
+#include "test_utils.hpp"
+#include "util.hpp"
+#include "vulkan_utils/vulkan_utils.hpp"
+
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <istream>
+
+namespace {
+    typedef std::map<std::string, std::string> json_fields;
+
+    // Parses one flat JSON object, as test_result_export writes them: string, number, and
+    // boolean members only. Null members are left out of fields.
+    class record_parser {
+    public:
+        explicit record_parser(const std::string& line) : mLine(line), mPos(0) {}
+
+        bool parse(json_fields& fields) {
+            skipSpace();
+            if (!consume('{')) return false;
+
+            skipSpace();
+            if (consume('}')) return true;
+
+            for (;;) {
+                std::string name;
+                skipSpace();
+                if (!parseString(name)) return false;
+
+                skipSpace();
+                if (!consume(':')) return false;
+
+                skipSpace();
+                std::string value;
+                if (peek() == '"') {
+                    if (!parseString(value)) return false;
+                    fields[name] = value;
+                }
+                else {
+                    if (!parseLiteral(value)) return false;
+                    if (value != "null") fields[name] = value;
+                }
+
+                skipSpace();
+                if (consume('}')) return true;
+                if (!consume(',')) return false;
+            }
+        }
+
+    private:
+        char peek() const {
+            return (mPos < mLine.size() ? mLine[mPos] : '\0');
+        }
+
+        bool consume(char c) {
+            if (peek() != c || mPos >= mLine.size()) return false;
+            ++mPos;
+            return true;
+        }
+
+        void skipSpace() {
+            while (mPos < mLine.size() && std::isspace(static_cast<unsigned char>(mLine[mPos]))) ++mPos;
+        }
+
+        bool parseString(std::string& out) {
+            if (!consume('"')) return false;
+
+            while (mPos < mLine.size() && mLine[mPos] != '"') {
+                char c = mLine[mPos++];
+                if ('\\' == c) {
+                    if (mPos >= mLine.size()) return false;
+                    switch (mLine[mPos++]) {
+                        case '"':   c = '"'; break;
+                        case '\\':  c = '\\'; break;
+                        case '/':   c = '/'; break;
+                        case 'b':   c = '\b'; break;
+                        case 'f':   c = '\f'; break;
+                        case 'n':   c = '\n'; break;
+                        case 'r':   c = '\r'; break;
+                        case 't':   c = '\t'; break;
+                        case 'u': {
+                            if (mPos + 4 > mLine.size()) return false;
+                            const std::string hex = mLine.substr(mPos, 4);
+                            char* end = nullptr;
+                            const unsigned long code = std::strtoul(hex.c_str(), &end, 16);
+                            if (end != hex.c_str() + hex.size()) return false;
+                            mPos += 4;
+                            // Only control characters are escaped by the writer; anything wider is not a name we match
+                            c = (code < 0x80 ? static_cast<char>(code) : '?');
+                            break;
+                        }
+                        default:
+                            return false;
+                    }
+                }
+                out += c;
+            }
+
+            return consume('"');
+        }
+
+        bool parseLiteral(std::string& out) {
+            const std::size_t begin = mPos;
+            while (mPos < mLine.size() && mLine[mPos] != ',' && mLine[mPos] != '}'
+                   && !std::isspace(static_cast<unsigned char>(mLine[mPos]))) {
+                ++mPos;
+            }
+
+            out = mLine.substr(begin, mPos - begin);
+            return !out.empty();
+        }
+
+        const std::string&  mLine;
+        std::size_t         mPos;
+    };
+
+    std::string fieldOrEmpty(const json_fields& fields, const char* name) {
+        const auto found = fields.find(name);
+        return (found == fields.end() ? std::string() : found->second);
+    }
+
+    bool numberField(const json_fields& fields, const char* name, double& value) {
+        const auto found = fields.find(name);
+        if (found == fields.end()) return false;
+
+        char* end = nullptr;
+        value = std::strtod(found->second.c_str(), &end);
+        return end == found->second.c_str() + found->second.size() && std::isfinite(value);
+    }
+
+    // Tabs never appear in manifest tokens, so they keep the parts of a key apart
+    std::string makeKey(const std::string& module,
+                        const std::string& entryPoint,
+                        const std::string& variation,
+                        const std::string& parameters,
+                        const std::string& workgroupSize) {
+        return module + '\t' + entryPoint + '\t' + variation + '\t' + parameters + '\t' + workgroupSize;
+    }
+
+    std::string makeLabel(const std::string& module,
+                          const std::string& entryPoint,
+                          const std::string& variation,
+                          const std::string& parameters,
+                          const std::string& workgroupSize) {
+        std::string result = module + '/' + entryPoint;
+        if (!variation.empty()) result += ' ' + variation;
+        if (!parameters.empty()) result += ' ' + parameters;
+        result += " wg:" + workgroupSize;
+        return result;
+    }
+
+    bool workgroupSizeFields(const json_fields& fields, vk::Extent3D& workgroupSize) {
+        double x = 0.0, y = 0.0, z = 0.0;
+        if (!numberField(fields, "workgroup_size_x", x)
+            || !numberField(fields, "workgroup_size_y", y)
+            || !numberField(fields, "workgroup_size_z", z)) {
+            return false;
+        }
+
+        workgroupSize = vk::Extent3D(static_cast<std::uint32_t>(x),
+                                     static_cast<std::uint32_t>(y),
+                                     static_cast<std::uint32_t>(z));
+        return true;
+    }
+
+    const char* const kExecutionTime = "executionTime";
+    const char* const kWallClockTime = "wallClockTime";
+
+    // Timestamps are usable only if every iteration on both sides has them
+    bool hasExecutionTimes(const test_baseline::run_samples& samples) {
+        return !samples.mExecutionNs.empty() && samples.mExecutionNs.size() == samples.mWallClockNs.size();
+    }
+}
+
+namespace test_baseline {
+
+    const char* to_string(verdict v) {
+        switch (v) {
+            case verdict::kUnchanged:   return "unchanged";
+            case verdict::kRegression:  return "REGRESSION";
+            case verdict::kImprovement: return "IMPROVEMENT";
+            case verdict::kNoBaseline:  return "no baseline";
+        }
+        return "";
+    }
+
+    sample_set read(std::istream& is) {
+        sample_set result;
+
+        std::string line;
+        while (std::getline(is, line)) {
+            json_fields fields;
+            if (!record_parser(line).parse(fields)) continue;
+
+            double timingIterations = 0.0;
+            if (!numberField(fields, "timing_iterations", timingIterations) || timingIterations <= 0.0) continue;
+            if ("true" == fieldOrEmpty(fields, "warmup")) continue;
+
+            double wallClockNs = 0.0;
+            if (!numberField(fields, "wall_clock_ns", wallClockNs)) continue;
+
+            const std::string module = fieldOrEmpty(fields, "module");
+            const std::string entryPoint = fieldOrEmpty(fields, "entry_point");
+            const std::string variation = fieldOrEmpty(fields, "variation");
+            const std::string parameters = fieldOrEmpty(fields, "parameters");
+            vk::Extent3D workgroupExtent;
+            if (!workgroupSizeFields(fields, workgroupExtent)) continue;
+            const std::string workgroupSize = test_utils::workgroup_size_string(workgroupExtent);
+
+            run_samples& samples = result[makeKey(module, entryPoint, variation, parameters, workgroupSize)];
+            if (samples.mLabel.empty()) {
+                samples.mLabel = makeLabel(module, entryPoint, variation, parameters, workgroupSize);
+            }
+
+            samples.mWallClockNs.push_back(wallClockNs);
+
+            double executionNs = 0.0;
+            if (numberField(fields, "execution_ns", executionNs)) {
+                samples.mExecutionNs.push_back(executionNs);
+            }
+        }
+
+        return result;
+    }
+
+    sample_set collect(const sample_info& info, const test_manifest::results& manifestResults) {
+        sample_set result;
+
+        for (auto& mr : manifestResults) {
+            for (auto& kr : mr.second.mKernelResults) {
+                const test_utils::KernelTest& kernelTest = *kr.first;
+                if (0 == kernelTest.mTimingIterations) continue;
+
+                const std::string workgroupSize = test_utils::workgroup_size_string(kernelTest.mWorkgroupSize);
+
+                for (auto& ir : kr.second.mInvocationResults) {
+                    const test_utils::InvocationResult& invocationResult = ir.second;
+                    if (invocationResult.mIsWarmup) continue;
+
+                    const std::string& variation = ir.first->mVariation;
+                    run_samples& samples = result[makeKey(mr.first->mName,
+                                                          kernelTest.mEntryName,
+                                                          variation,
+                                                          invocationResult.mParameters,
+                                                          workgroupSize)];
+                    if (samples.mLabel.empty()) {
+                        samples.mLabel = makeLabel(mr.first->mName,
+                                                   kernelTest.mEntryName,
+                                                   variation,
+                                                   invocationResult.mParameters,
+                                                   workgroupSize);
+                    }
+
+                    const clspv_utils::execution_time_t& times = invocationResult.mExecutionTime;
+                    samples.mWallClockNs.push_back(std::chrono::duration<double, std::nano>(times.cpu_duration).count());
+                    if (0 != times.timestamps.execution) {
+                        samples.mExecutionNs.push_back(vulkan_utils::timestamp_delta_ns(times.timestamps.host_barrier,
+                                                                                        times.timestamps.execution,
+                                                                                        info.physical_device_properties,
+                                                                                        info.graphics_queue_family_properties));
+                    }
+                }
+            }
+        }
+
+        return result;
+    }
+
+    comparisons compare(const sample_set& baseline, const sample_set& current, const options& opts) {
+        comparisons result;
+
+        for (auto& c : current) {
+            comparison cmp;
+            cmp.mLabel = c.second.mLabel;
+
+            const auto b = baseline.find(c.first);
+            if (b == baseline.end() || b->second.mWallClockNs.empty()) {
+                cmp.mMetric = (hasExecutionTimes(c.second) ? kExecutionTime : kWallClockTime);
+                cmp.mCurrentCount = c.second.mWallClockNs.size();
+                cmp.mCurrentMedianNs = test_statistics::summarize(hasExecutionTimes(c.second)
+                                                                  ? c.second.mExecutionNs
+                                                                  : c.second.mWallClockNs).mMedian;
+                cmp.mVerdict = verdict::kNoBaseline;
+                result.push_back(cmp);
+                continue;
+            }
+
+            const bool useExecution = hasExecutionTimes(b->second) && hasExecutionTimes(c.second);
+            const std::vector<double>& baselineNs = (useExecution ? b->second.mExecutionNs : b->second.mWallClockNs);
+            const std::vector<double>& currentNs = (useExecution ? c.second.mExecutionNs : c.second.mWallClockNs);
+
+            cmp.mMetric = (useExecution ? kExecutionTime : kWallClockTime);
+            cmp.mBaselineCount = baselineNs.size();
+            cmp.mCurrentCount = currentNs.size();
+            cmp.mBaselineMedianNs = test_statistics::summarize(baselineNs).mMedian;
+            cmp.mCurrentMedianNs = test_statistics::summarize(currentNs).mMedian;
+            cmp.mRelativeChange = (cmp.mBaselineMedianNs > 0.0
+                                   ? (cmp.mCurrentMedianNs - cmp.mBaselineMedianNs) / cmp.mBaselineMedianNs
+                                   : 0.0);
+            cmp.mPValue = test_statistics::mannWhitneyPValue(baselineNs, currentNs);
+
+            if (cmp.mPValue < opts.mAlpha && std::abs(cmp.mRelativeChange) >= opts.mMinRelativeChange) {
+                cmp.mVerdict = (cmp.mRelativeChange > 0.0 ? verdict::kRegression : verdict::kImprovement);
+            }
+
+            result.push_back(cmp);
+        }
+
+        return result;
+    }
+
+}
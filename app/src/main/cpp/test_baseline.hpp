@@ -0,0 +1,65 @@
+#ifndef CLSPVTEST_TEST_BASELINE_HPP
+#define CLSPVTEST_TEST_BASELINE_HPP
+
+#include "test_manifest.hpp"
+
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+struct sample_info;
+
+namespace test_baseline {
+
+    // The timed (non-warmup) iterations of one timing run. Runs are matched across result sets
+    // by module, entry point, variation, parameters, and workgroup size.
+    struct run_samples {
+        std::string         mLabel;             // for logs
+        std::vector<double> mExecutionNs;       // empty if the queue had no timestamps
+        std::vector<double> mWallClockNs;
+    };
+
+    typedef std::map<std::string, run_samples> sample_set;
+
+    // Timing runs of a results file written in JSON lines (see test_result_export). Lines that
+    // are not timing iterations, or that cannot be parsed, are skipped.
+    sample_set read(std::istream& is);
+
+    sample_set collect(const sample_info& info, const test_manifest::results& manifestResults);
+
+    struct options {
+        double  mAlpha              = 0.01;     // significance level of the Mann-Whitney U test
+        double  mMinRelativeChange  = 0.05;     // smallest change in median that is flagged
+    };
+
+    enum class verdict {
+        kUnchanged,
+        kRegression,
+        kImprovement,
+        kNoBaseline
+    };
+
+    const char* to_string(verdict v);
+
+    // A change is flagged only if it is both statistically significant and at least as large as
+    // the threshold; the median is compared, so that a few slow iterations don't dominate.
+    struct comparison {
+        std::string mLabel;
+        const char* mMetric             = "";   // executionTime, or wallClockTime if either side lacks timestamps
+        std::size_t mBaselineCount      = 0;
+        std::size_t mCurrentCount       = 0;
+        double      mBaselineMedianNs   = 0.0;
+        double      mCurrentMedianNs    = 0.0;
+        double      mRelativeChange     = 0.0;  // of the median; positive is slower
+        double      mPValue             = 1.0;
+        verdict     mVerdict            = verdict::kUnchanged;
+    };
+
+    typedef std::vector<comparison> comparisons;
+
+    // One comparison for every timing run in current
+    comparisons compare(const sample_set& baseline, const sample_set& current, const options& opts = options());
+}
+
+#endif //CLSPVTEST_TEST_BASELINE_HPP
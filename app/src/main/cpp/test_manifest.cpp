@@ -22,6 +22,9 @@
 #include "crlf_savvy.hpp"
 #include "util.hpp"
 
+#include <algorithm>
+#include <cstdlib>
+
 namespace
 {
     using namespace test_manifest;
@@ -121,6 +124,69 @@ namespace
         }
     }
 
+    void read_trace_op(std::istream& is, manifest_t& manifest)
+    {
+        // write a timeline of the run to a file in the output directory
+        std::string fileName;
+        is >> fileName;
+
+        if (fileName.empty() || fileName[0] == '#')
+        {
+            throw std::runtime_error("missing trace file name");
+        }
+
+        manifest.trace_file = fileName;
+    }
+
+    void read_results_op(std::istream& is, manifest_t& manifest)
+    {
+        // write one record per invocation to a file in the output directory
+        std::string fileName;
+        is >> fileName;
+
+        if (fileName.empty() || fileName[0] == '#')
+        {
+            throw std::runtime_error("missing results file name");
+        }
+
+        manifest.results_files.push_back(fileName);
+    }
+
+    void read_baseline_op(std::istream& is, manifest_t& manifest)
+    {
+        // compare timing runs with a results file in the output directory
+        std::string fileName;
+        is >> fileName;
+
+        if (fileName.empty() || fileName[0] == '#')
+        {
+            throw std::runtime_error("missing baseline file name");
+        }
+
+        // the thresholds are optional; a failed read leaves the defaults in place
+        double minChange = manifest.baseline_min_change;
+        double alpha = manifest.baseline_alpha;
+
+        double value = 0.0;
+        if (is >> value)
+        {
+            minChange = value;
+            if (is >> value)
+            {
+                alpha = value;
+            }
+        }
+
+        if (0.0 > minChange || 0.0 >= alpha || 1.0 <= alpha)
+        {
+            throw std::runtime_error("illegal baseline thresholds requested");
+        }
+
+        manifest.baseline_file = fileName;
+        manifest.baseline_min_change = minChange;
+        manifest.baseline_alpha = alpha;
+    }
+
     bool read_verbosity_op(std::istream& is)
     {
         bool result = false;
@@ -145,6 +211,91 @@ namespace
         return result;
     }
 
+    unsigned int read_warmup_op(std::istream& is)
+    {
+        // set the number of untimed iterations subsequent timing tests run first
+        int iterations = -1;
+        is >> iterations;
+
+        if (is.fail() || 0 > iterations)
+        {
+            throw std::runtime_error("illegal warmup iteration count requested");
+        }
+
+        return static_cast<unsigned int>(iterations);
+    }
+
+    test_utils::AdaptiveTiming read_adaptive_op(std::istream& is)
+    {
+        // set the limits of subsequent timing tests whose iteration count is auto
+        test_utils::AdaptiveTiming result;
+        double budgetSeconds = 0.0;
+        is >> result.mMinIterations
+           >> result.mMaxIterations
+           >> result.mTargetRelativeConfidence
+           >> budgetSeconds;
+
+        if (is.fail()
+            || 0 == result.mMaxIterations
+            || result.mMinIterations > result.mMaxIterations
+            || 0.0 >= result.mTargetRelativeConfidence
+            || 0.0 >= budgetSeconds)
+        {
+            throw std::runtime_error("illegal adaptive timing limits requested");
+        }
+
+        result.mBudget = std::chrono::duration<double>(budgetSeconds);
+        return result;
+    }
+
+    bool read_outliers_op(std::istream& is)
+    {
+        // set whether subsequent timing tests reject outliers from their statistics
+        std::string keep_reject;
+        is >> keep_reject;
+
+        if (keep_reject == "keep")
+        {
+            return false;
+        }
+        else if (keep_reject == "reject")
+        {
+            return true;
+        }
+        else
+        {
+            throw std::runtime_error("unrecognized outliers value");
+        }
+    }
+
+    vulkan_utils::memory_allocator::placement read_placement_op(std::istream& is)
+    {
+        // set memory placement of buffers created by subsequent tests
+        std::string placement;
+        is >> placement;
+
+        if (placement == "dynamic")
+        {
+            return vulkan_utils::memory_allocator::kPlacement_Dynamic;
+        }
+        else if (placement == "upload")
+        {
+            return vulkan_utils::memory_allocator::kPlacement_Upload;
+        }
+        else if (placement == "readback")
+        {
+            return vulkan_utils::memory_allocator::kPlacement_Readback;
+        }
+        else if (placement == "gpu-only")
+        {
+            return vulkan_utils::memory_allocator::kPlacement_GpuOnly;
+        }
+        else
+        {
+            throw std::runtime_error("unrecognized placement value");
+        }
+    }
+
     test_utils::KernelTest::test_arguments read_test_args(std::istream& is)
     {
         test_utils::KernelTest::test_arguments result;
@@ -186,7 +337,8 @@ namespace
     void read_test_op(std::istream&         is,
                       const std::string&    op,
                       manifest_t&           manifest,
-                      bool                  verbose)
+                      bool                  verbose,
+                      vulkan_utils::memory_allocator::placement placement)
     {
         if (manifest.tests.empty())
         {
@@ -195,6 +347,7 @@ namespace
 
         test_utils::KernelTest testEntry;
         testEntry.mIsVerbose = verbose;
+        testEntry.mBufferPlacement = placement;
 
         std::string testName;
         is >> testEntry.mEntryName
@@ -221,7 +374,11 @@ namespace
     void read_time_op(std::istream&         is,
                       const std::string&    op,
                       manifest_t&           manifest,
-                      bool                  verbose)
+                      bool                  verbose,
+                      vulkan_utils::memory_allocator::placement placement,
+                      unsigned int          warmupIterations,
+                      const test_utils::AdaptiveTiming& adaptive,
+                      bool                  rejectOutliers)
     {
         if (manifest.tests.empty())
         {
@@ -230,11 +387,15 @@ namespace
 
         test_utils::KernelTest testEntry;
         testEntry.mIsVerbose = verbose;
+        testEntry.mBufferPlacement = placement;
+        testEntry.mWarmupIterations = warmupIterations;
+        testEntry.mRejectOutliers = rejectOutliers;
 
         std::string testName;
+        std::string iterations;
         is >> testEntry.mEntryName
            >> testName
-           >> testEntry.mTimingIterations
+           >> iterations
            >> testEntry.mWorkgroupSize.width
            >> testEntry.mWorkgroupSize.height
            >> testEntry.mWorkgroupSize.depth;
@@ -242,6 +403,22 @@ namespace
         testEntry.mArguments = read_test_args(is);
         testEntry.mInvocationTests = lookup_test_series(testName);
 
+        if (iterations == "auto")
+        {
+            testEntry.mAdaptiveTiming = adaptive;
+            testEntry.mAdaptiveTiming.mIsEnabled = true;
+            testEntry.mTimingIterations = adaptive.mMaxIterations;
+        }
+        else
+        {
+            std::istringstream iterationStream(iterations);
+            iterationStream >> testEntry.mTimingIterations;
+            if (iterationStream.fail() || !iterationStream.eof() || '-' == iterations[0])
+            {
+                throw std::runtime_error("illegal iteration count requested");
+            }
+        }
+
         validate_kernel_test(testEntry, testName);
         if (0 >= testEntry.mTimingIterations)
         {
@@ -251,6 +428,163 @@ namespace
         manifest.tests.back().mKernelTests.push_back(testEntry);
     }
 
+    struct unit_scale
+    {
+        const char* mName;
+        double      mScale;
+    };
+
+    const unit_scale kTimeUnits[] = {
+            { "ns", 1.0e-9 },
+            { "us", 1.0e-6 },
+            { "ms", 1.0e-3 },
+            { "s",  1.0 },
+    };
+
+    const unit_scale kRateUnits[] = {
+            { "B/s",   1.0 },
+            { "KB/s",  1.0e3 },
+            { "MB/s",  1.0e6 },
+            { "GB/s",  1.0e9 },
+            { "TB/s",  1.0e12 },
+            { "KiB/s", 1024.0 },
+            { "MiB/s", 1024.0 * 1024.0 },
+            { "GiB/s", 1024.0 * 1024.0 * 1024.0 },
+    };
+
+    void read_expect_statistic(const std::string& statistic, test_utils::TimingExpectation& expectation)
+    {
+        if (statistic == "mean")
+        {
+            expectation.mUseMean = true;
+        }
+        else if (statistic == "median")
+        {
+            expectation.mQuantile = 0.5;
+        }
+        else if (statistic == "min")
+        {
+            expectation.mQuantile = 0.0;
+        }
+        else if (statistic == "max")
+        {
+            expectation.mQuantile = 1.0;
+        }
+        else if (statistic.size() > 1 && statistic[0] == 'p')
+        {
+            // pNN, the NNth percentile
+            std::istringstream percentileStream(statistic.substr(1));
+            double percentile = -1.0;
+            percentileStream >> percentile;
+            if (percentileStream.fail() || !percentileStream.eof() || 0.0 > percentile || 100.0 < percentile)
+            {
+                throw std::runtime_error("illegal expectation percentile");
+            }
+            expectation.mQuantile = percentile / 100.0;
+        }
+        else
+        {
+            throw std::runtime_error("unrecognized expectation statistic");
+        }
+    }
+
+    bool read_expect_relation(const std::string& relation, test_utils::TimingExpectation& expectation)
+    {
+        typedef test_utils::TimingExpectation::relation relation_t;
+
+        if (relation == "<")        expectation.mRelation = relation_t::kLess;
+        else if (relation == "<=")  expectation.mRelation = relation_t::kLessEqual;
+        else if (relation == ">")   expectation.mRelation = relation_t::kGreater;
+        else if (relation == ">=")  expectation.mRelation = relation_t::kGreaterEqual;
+        else                        return false;
+
+        return true;
+    }
+
+    template <std::size_t N>
+    double read_expect_limit(std::istream& is, const unit_scale (&units)[N], std::string& text)
+    {
+        // the unit may follow the number directly (1.5ms) or as its own token (1.5 ms)
+        std::string limit;
+        is >> limit;
+        text = limit;
+
+        const char* begin = limit.c_str();
+        char* end = nullptr;
+        const double value = std::strtod(begin, &end);
+        if (end == begin || 0.0 > value)
+        {
+            throw std::runtime_error("illegal expectation limit");
+        }
+
+        std::string unit(end);
+        if (unit.empty())
+        {
+            is >> unit;
+            text += unit;
+        }
+
+        for (auto& u : units)
+        {
+            if (unit == u.mName)
+            {
+                return value * u.mScale;
+            }
+        }
+
+        throw std::runtime_error("unrecognized expectation unit");
+    }
+
+    void read_expect_op(std::istream& is, const std::string& op, manifest_t& manifest)
+    {
+        // attach a performance budget to the most recent timing test of an entry point
+        if (manifest.tests.empty())
+        {
+            throw std::runtime_error("no module for expectation");
+        }
+
+        test_utils::TimingExpectation expectation;
+        expectation.mMeasure = (op == "expect_rate"
+                                ? test_utils::TimingExpectation::measure::kRate
+                                : test_utils::TimingExpectation::measure::kTime);
+
+        std::string entryName;
+        std::string token;
+        is >> entryName >> token;
+
+        // the statistic is optional, and defaults to the median
+        std::string statistic("median");
+        if (!read_expect_relation(token, expectation))
+        {
+            statistic = token;
+            read_expect_statistic(statistic, expectation);
+
+            is >> token;
+            if (!read_expect_relation(token, expectation))
+            {
+                throw std::runtime_error("unrecognized expectation relation");
+            }
+        }
+
+        std::string limit;
+        expectation.mLimit = (expectation.mMeasure == test_utils::TimingExpectation::measure::kRate
+                              ? read_expect_limit(is, kRateUnits, limit)
+                              : read_expect_limit(is, kTimeUnits, limit));
+        expectation.mText = statistic + ' ' + token + ' ' + limit;
+
+        auto& kernelTests = manifest.tests.back().mKernelTests;
+        auto found = std::find_if(kernelTests.rbegin(), kernelTests.rend(),
+                                  [&entryName](const test_utils::KernelTest& kt) {
+                                      return kt.mEntryName == entryName && kt.mTimingIterations > 0;
+                                  });
+        if (found == kernelTests.rend())
+        {
+            throw std::runtime_error("no timing test for expectation");
+        }
+
+        found->mExpectations.push_back(expectation);
+    }
+
     void ensure_all_entries_tested(test_utils::ModuleTest& moduleTest)
     {
         android_utils::iassetstream spvmapStream(moduleTest.mName + ".spvmap");
@@ -315,6 +649,10 @@ namespace test_manifest
         manifest_t result;
         unsigned int iterations = 1;
         bool verbose = false;
+        auto placement = vulkan_utils::memory_allocator::kPlacement_Dynamic;
+        unsigned int warmupIterations = 0;
+        test_utils::AdaptiveTiming adaptive;
+        bool rejectOutliers = false;
 
         while (!in.eof())
         {
@@ -337,11 +675,15 @@ namespace test_manifest
                 }
                 else if (op == "test" || op == "test2d" || op == "test3d")
                 {
-                    read_test_op(in_line, op, result, verbose);
+                    read_test_op(in_line, op, result, verbose, placement);
                 }
                 else if (op == "time")
                 {
-                    read_time_op(in_line, op, result, verbose);
+                    read_time_op(in_line, op, result, verbose, placement, warmupIterations, adaptive, rejectOutliers);
+                }
+                else if (op == "expect_time" || op == "expect_rate")
+                {
+                    read_expect_op(in_line, op, result);
                 }
                 else if (op == "skip")
                 {
@@ -351,10 +693,38 @@ namespace test_manifest
                 {
                     read_vkvalidation_op(in_line, result);
                 }
+                else if (op == "trace")
+                {
+                    read_trace_op(in_line, result);
+                }
+                else if (op == "results")
+                {
+                    read_results_op(in_line, result);
+                }
+                else if (op == "baseline")
+                {
+                    read_baseline_op(in_line, result);
+                }
                 else if (op == "verbosity")
                 {
                     verbose = read_verbosity_op(in_line);
                 }
+                else if (op == "warmup")
+                {
+                    warmupIterations = read_warmup_op(in_line);
+                }
+                else if (op == "adaptive")
+                {
+                    adaptive = read_adaptive_op(in_line);
+                }
+                else if (op == "outliers")
+                {
+                    rejectOutliers = read_outliers_op(in_line);
+                }
+                else if (op == "placement")
+                {
+                    placement = read_placement_op(in_line);
+                }
                 else if (op == "end")
                 {
                     // terminate reading the manifest
@@ -16,6 +16,11 @@ namespace test_manifest {
 
     struct manifest_t {
         bool                                use_validation_layer = true;
+        std::string                         trace_file;     // empty if no trace is wanted
+        std::vector<std::string>            results_files;
+        std::string                         baseline_file;  // empty if the run is not compared
+        double                              baseline_min_change = 0.05;
+        double                              baseline_alpha = 0.01;
         std::vector<test_utils::ModuleTest> tests;
     };
 
@@ -0,0 +1,271 @@
+#include "test_result_export.hpp"
+
+#include "test_utils.hpp"
+#include "util.hpp"
+#include "vulkan_utils/vulkan_utils.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <vector>
+
+namespace {
+    struct field {
+        enum kind {
+            kString,
+            kNumber,
+            kBoolean,
+            kNull
+        };
+
+        const char* mName;
+        kind        mKind;
+        std::string mText;
+    };
+
+    typedef std::vector<field> record;
+
+    class record_builder {
+    public:
+        void addString(const char* name, const std::string& value) {
+            mRecord.push_back(field{ name, field::kString, value });
+        }
+
+        void addBoolean(const char* name, bool value) {
+            mRecord.push_back(field{ name, field::kBoolean, value ? "true" : "false" });
+        }
+
+        template <typename T>
+        void addNumber(const char* name, T value) {
+            std::ostringstream os;
+            os << std::setprecision(12) << value;
+            mRecord.push_back(field{ name, field::kNumber, os.str() });
+        }
+
+        template <typename T>
+        void addNumber(const char* name, T value, bool isValid) {
+            if (isValid) {
+                addNumber(name, value);
+            }
+            else {
+                mRecord.push_back(field{ name, field::kNull, std::string() });
+            }
+        }
+
+        const record&   getRecord() const { return mRecord; }
+
+    private:
+        record  mRecord;
+    };
+
+    typedef clspv_utils::execution_time_t::host_timeline::time_point time_point;
+
+    bool isObserved(const time_point& t) {
+        return time_point() != t;
+    }
+
+    double intervalNs(const time_point& from, const time_point& to) {
+        return std::chrono::duration<double, std::nano>(to - from).count();
+    }
+
+    record makeRecord(const sample_info&                        info,
+                      const test_utils::ModuleTest&             moduleTest,
+                      const test_utils::KernelTest::result&     kr,
+                      const test_utils::InvocationTest::result& ir,
+                      unsigned int                              iteration) {
+        const test_utils::KernelTest& kernelTest = *kr.first;
+        const test_utils::InvocationResult& result = ir.second;
+        const clspv_utils::execution_time_t& times = result.mExecutionTime;
+        const bool isTiming = (kernelTest.mTimingIterations > 0);
+
+        record_builder builder;
+        builder.addString("device", info.physical_device_properties.deviceName);
+        builder.addString("module", moduleTest.mName);
+        builder.addString("entry_point", kernelTest.mEntryName);
+        builder.addString("variation", ir.first->mVariation);
+        builder.addString("parameters", result.mParameters);
+        builder.addNumber("bytes_transferred", result.mBytesTransferred, 0 != result.mBytesTransferred);
+        builder.addNumber("workgroup_size_x", kernelTest.mWorkgroupSize.width);
+        builder.addNumber("workgroup_size_y", kernelTest.mWorkgroupSize.height);
+        builder.addNumber("workgroup_size_z", kernelTest.mWorkgroupSize.depth);
+        builder.addNumber("timing_iterations", kernelTest.mTimingIterations);
+        builder.addNumber("warmup_iterations", kernelTest.mWarmupIterations);
+        builder.addNumber("iteration", iteration);
+        builder.addBoolean("warmup", result.mIsWarmup);
+        builder.addBoolean("adaptive", kernelTest.mAdaptiveTiming.mIsEnabled);
+        builder.addString("stop_reason", isTiming ? test_utils::to_string(result.mTimingStop) : "");
+
+        builder.addString("result", test_utils::to_string(result.mEvaluation));
+        builder.addNumber("num_correct", result.mEvaluation.mNumCorrect);
+        builder.addNumber("num_errors", result.mEvaluation.mNumErrors);
+        builder.addString("exception", kr.second.mExceptionString);
+
+        // Invocations leave the timestamps zero if the queue cannot write them
+        const bool hasTimestamps = (0 != times.timestamps.execution);
+        builder.addNumber("timestamp_start", times.timestamps.start, hasTimestamps);
+        builder.addNumber("timestamp_host_barrier", times.timestamps.host_barrier, hasTimestamps);
+        builder.addNumber("timestamp_execution", times.timestamps.execution, hasTimestamps);
+        builder.addNumber("timestamp_period_ns", info.physical_device_properties.limits.timestampPeriod);
+        builder.addNumber("timestamp_valid_bits", info.graphics_queue_family_properties.timestampValidBits);
+        builder.addNumber("execution_ns",
+                          vulkan_utils::timestamp_delta_ns(times.timestamps.host_barrier,
+                                                           times.timestamps.execution,
+                                                           info.physical_device_properties,
+                                                           info.graphics_queue_family_properties),
+                          hasTimestamps);
+        builder.addNumber("host_barrier_ns",
+                          vulkan_utils::timestamp_delta_ns(times.timestamps.start,
+                                                           times.timestamps.host_barrier,
+                                                           info.physical_device_properties,
+                                                           info.graphics_queue_family_properties),
+                          hasTimestamps);
+
+        const auto& timeline = times.timeline;
+        builder.addNumber("wall_clock_ns", std::chrono::duration<double, std::nano>(times.cpu_duration).count());
+        builder.addNumber("submit_latency_ns",
+                          intervalNs(timeline.submit_begin, timeline.submit_end),
+                          isObserved(timeline.submit_begin) && isObserved(timeline.submit_end));
+        builder.addNumber("queue_wait_ns",
+                          intervalNs(timeline.submit_end, timeline.gpu_start),
+                          isObserved(timeline.submit_end) && isObserved(timeline.gpu_start));
+        builder.addNumber("completion_latency_ns",
+                          intervalNs(timeline.gpu_end, timeline.complete),
+                          isObserved(timeline.gpu_end) && isObserved(timeline.complete));
+
+        builder.addNumber("shader_invocations", times.statistics.compute_shader_invocations, times.statistics.is_valid);
+        builder.addNumber("expected_invocations", times.statistics.expected_invocations, times.statistics.is_valid);
+
+        // Timing runs don't evaluate, and report their setup with the first iteration only
+        builder.addNumber("evaluation_ns", std::chrono::duration<double, std::nano>(result.mEvalTime).count(), !isTiming);
+        builder.addNumber("setup_ns", std::chrono::duration<double, std::nano>(result.mSetupTime).count(), isTiming && 0 == iteration);
+
+        return builder.getRecord();
+    }
+
+    record makeEmptyRecord(const sample_info& info) {
+        const test_utils::ModuleTest moduleTest;
+        const test_utils::KernelTest kernelTest;
+        const test_utils::InvocationTest invocationTest;
+
+        return makeRecord(info,
+                          moduleTest,
+                          test_utils::KernelTest::result(&kernelTest, test_utils::KernelResult()),
+                          test_utils::InvocationTest::result(&invocationTest, test_utils::InvocationResult()),
+                          0);
+    }
+
+    std::vector<record> collectRecords(const sample_info& info, const test_manifest::results& manifestResults) {
+        std::vector<record> result;
+
+        for (auto& mr : manifestResults) {
+            for (auto& kr : mr.second.mKernelResults) {
+                // Timing runs produce consecutive results for the same invocation test
+                const test_utils::InvocationTest* previous = nullptr;
+                unsigned int iteration = 0;
+
+                for (auto& ir : kr.second.mInvocationResults) {
+                    if (ir.first != previous) {
+                        previous = ir.first;
+                        iteration = 0;
+                    }
+
+                    result.push_back(makeRecord(info, *mr.first, kr, ir, iteration++));
+                }
+            }
+        }
+
+        return result;
+    }
+
+    // Quoted only where needed, per RFC 4180
+    std::string escapeCsv(const std::string& s) {
+        if (std::string::npos == s.find_first_of(",\"\r\n")) {
+            return s;
+        }
+
+        std::string result("\"");
+        for (char c : s) {
+            if ('"' == c) result += '"';
+            result += c;
+        }
+        result += '"';
+        return result;
+    }
+}
+
+namespace test_result_export {
+
+    std::string escapeJson(const std::string &s) {
+        std::ostringstream os;
+        for (char c : s) {
+            switch (c) {
+                case '"':   os << "\\\""; break;
+                case '\\':  os << "\\\\"; break;
+                case '\n':  os << "\\n"; break;
+                case '\r':  os << "\\r"; break;
+                case '\t':  os << "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c)
+                           << std::dec << std::setfill(' ');
+                    }
+                    else {
+                        os << c;
+                    }
+                    break;
+            }
+        }
+        return os.str();
+    }
+
+    void writeJsonLines(const sample_info &info, const test_manifest::results &manifestResults, std::ostream &os) {
+        for (auto& r : collectRecords(info, manifestResults)) {
+            os << '{';
+            for (auto f = r.begin(); f != r.end(); ++f) {
+                if (f != r.begin()) os << ',';
+                os << '"' << f->mName << "\":";
+                switch (f->mKind) {
+                    case field::kString:    os << '"' << escapeJson(f->mText) << '"'; break;
+                    case field::kNumber:
+                    case field::kBoolean:   os << f->mText; break;
+                    case field::kNull:      os << "null"; break;
+                }
+            }
+            os << '}' << std::endl;
+        }
+    }
+
+    void writeCsv(const sample_info &info, const test_manifest::results &manifestResults, std::ostream &os) {
+        const auto records = collectRecords(info, manifestResults);
+
+        // Every record has the same fields in the same order; an empty run still gets its header
+        const record header = (records.empty() ? makeEmptyRecord(info) : records.front());
+        for (auto f = header.begin(); f != header.end(); ++f) {
+            if (f != header.begin()) os << ',';
+            os << f->mName;
+        }
+        os << "\r\n";
+
+        for (auto& r : records) {
+            for (auto f = r.begin(); f != r.end(); ++f) {
+                if (f != r.begin()) os << ',';
+                os << escapeCsv(f->mText);
+            }
+            os << "\r\n";
+        }
+    }
+
+    void writeResults(const sample_info &info, const test_manifest::results &manifestResults, const std::string &fileName, std::ostream &os) {
+        const std::string csvSuffix(".csv");
+        const bool isCsv = fileName.size() >= csvSuffix.size()
+                           && 0 == fileName.compare(fileName.size() - csvSuffix.size(), csvSuffix.size(), csvSuffix);
+        if (isCsv) {
+            writeCsv(info, manifestResults, os);
+        }
+        else {
+            writeJsonLines(info, manifestResults, os);
+        }
+    }
+
+}
@@ -0,0 +1,30 @@
+#ifndef CLSPVTEST_TEST_RESULT_EXPORT_HPP
+#define CLSPVTEST_TEST_RESULT_EXPORT_HPP
+
+#include "test_manifest.hpp"
+
+#include <iosfwd>
+#include <string>
+
+struct sample_info;
+
+namespace test_result_export {
+    // Both formats hold one record per invocation; a timing run has one per iteration, warmup
+    // iterations included and marked. Records carry the raw GPU timestamps alongside the
+    // durations derived from them, so that tools can redo the statistics. Values that were not
+    // measured are null in JSON and empty in CSV.
+
+    // One JSON object per line
+    void writeJsonLines(const sample_info &info, const test_manifest::results &manifestResults, std::ostream &os);
+
+    // A header row, then one row per record
+    void writeCsv(const sample_info &info, const test_manifest::results &manifestResults, std::ostream &os);
+
+    // CSV if fileName ends in ".csv", JSON lines otherwise
+    void writeResults(const sample_info &info, const test_manifest::results &manifestResults, const std::string &fileName, std::ostream &os);
+
+    // s, escaped for use inside a JSON string literal
+    std::string escapeJson(const std::string &s);
+}
+
+#endif //CLSPVTEST_TEST_RESULT_EXPORT_HPP
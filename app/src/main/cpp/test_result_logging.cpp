@@ -4,6 +4,7 @@
 
 #include "test_result_logging.hpp"
 
+#include "test_statistics.hpp"
 #include "test_utils.hpp"
 #include "util.hpp"
 #include "vulkan_utils/vulkan_utils.hpp"
@@ -16,6 +17,9 @@
 #include <boost/units/systems/si/prefixes.hpp>
 
 #include <algorithm>
+#include <iomanip>
+#include <iterator>
+#include <map>
 #include <sstream>
 #include <utility>
 
@@ -59,6 +63,48 @@ namespace {
         boost::units::quantity<boost::units::si::time> wallClockTime;
         boost::units::quantity<boost::units::si::time> executionTime;
         boost::units::quantity<boost::units::si::time> hostBarrierTime;
+        boost::units::quantity<boost::units::si::time> submitLatency;       // inside vkQueueSubmit
+        boost::units::quantity<boost::units::si::time> queueWait;           // submitted until the GPU starts
+        boost::units::quantity<boost::units::si::time> completionLatency;   // GPU done until the host notices
+
+        // From pipeline statistics, where the device supports them
+        bool    hasStatistics       = false;
+        double  shaderInvocations   = 0.0;
+        double  expectedInvocations = 0.0;
+    };
+
+    typedef boost::units::quantity<boost::units::si::time> execution_times::* time_member;
+
+    // The times summarized across the iterations of a timing run
+    struct time_field {
+        const char* mName;
+        time_member mMember;
+    };
+
+    const time_field kTimeFields[] = {
+            { "wallClockTime",      &execution_times::wallClockTime },
+            { "executionTime",      &execution_times::executionTime },
+            { "hostBarrierTime",    &execution_times::hostBarrierTime },
+            { "submitLatency",      &execution_times::submitLatency },
+            { "queueWait",          &execution_times::queueWait },
+            { "completionLatency",  &execution_times::completionLatency },
+    };
+
+    const std::size_t kNumTimeFields = sizeof(kTimeFields) / sizeof(kTimeFields[0]);
+
+    // Each member holds one statistic of every time field
+    struct TimingSummary {
+        std::size_t                 mNumSamples = 0;
+        execution_times             mMean;
+        execution_times             mStdDeviation;
+        execution_times             mConfidenceLow;     // 95% interval for the mean
+        execution_times             mConfidenceHigh;
+        execution_times             mMedian;
+        execution_times             mMad;
+        execution_times             mP90;
+        execution_times             mP99;
+        execution_times             mMax;
+        std::vector<std::size_t>    mNumOutliers;       // by time field
     };
 
     struct InvocationSummary {
@@ -75,15 +121,36 @@ namespace {
         messages_t                                      mMessages;
     };
 
+    // A performance budget checked against the timed iterations of one variation and set of
+    // parameters of a timing run. Budgets see every timed iteration, outliers included, since
+    // tail latency is often what they limit.
+    struct ExpectationSummary {
+        const test_utils::TimingExpectation*    mExpectation    = nullptr;
+        const std::string*                      mVariation      = nullptr;
+        const std::string*                      mParameters     = nullptr;
+        const char*                             mMetric         = "";       // the time field measured
+        bool                                    mIsMeasured     = false;    // false without samples, or without a byte count for a rate
+        double                                  mObserved       = 0.0;      // seconds, or bytes per second
+        ResultCounts                            mCounts         = ResultCounts::null();
+    };
+
     struct KernelSummary {
         std::string                     mEntryPoint;
         ResultCounts                    mCounts             = ResultCounts::null();
         std::vector<InvocationSummary>  mInvocationSummaries;
         const std::string*              mExceptionMessage   = nullptr;
 
+        const clspv_utils::pipeline_build_result_t* mPipelineBuild  = nullptr;
+        clspv_utils::kernel::pipeline_stats_t       mPipelineStats;
+
         unsigned int                    mTimingIterations   = 0;
-        execution_times                 mMeanTimes;
-        execution_times                 mStdDeviationTimes;
+        unsigned int                    mWarmupIterations   = 0;
+        bool                            mIsAdaptive         = false;
+        test_utils::TimingStop          mTimingStop         = test_utils::TimingStop::kIterations;
+        bool                            mRejectOutliers     = false;
+        boost::units::quantity<boost::units::si::time>  mSetupTime;
+        TimingSummary                   mTiming;
+        std::vector<ExpectationSummary> mExpectations;
     };
 
     struct ModuleSummary {
@@ -95,6 +162,11 @@ namespace {
         std::vector<KernelSummary>  mKernelSummaries;
         const std::string*          mExceptionMessage   = nullptr;
         untested_entries_t          mUntestedEntries;
+
+        // Only for a module that loaded
+        bool                                            mIsLoaded               = false;
+        clspv_utils::pipeline_cache_status              mPipelineCacheStatus    = clspv_utils::pipeline_cache_status::kNotPersisted;
+        boost::units::quantity<boost::units::si::time>  mPrebuildTime;
     };
 
     struct ManifestSummary {
@@ -114,9 +186,22 @@ namespace {
         return os;
     }
 
+    // Zero if either event was not observed
+    boost::units::quantity<boost::units::si::time>
+    measureInterval(const clspv_utils::execution_time_t::host_timeline::time_point& from,
+                    const clspv_utils::execution_time_t::host_timeline::time_point& to) {
+        const clspv_utils::execution_time_t::host_timeline::time_point unobserved;
+        if (from == unobserved || to == unobserved) {
+            return 0.0 * boost::units::si::seconds;
+        }
+
+        return std::chrono::duration<double>(to - from).count() * boost::units::si::seconds;
+    }
+
     execution_times
     measureInvocationTime(const sample_info &info, const test_utils::InvocationResult &ir) {
         auto &timestamps = ir.mExecutionTime.timestamps;
+        auto &timeline = ir.mExecutionTime.timeline;
 
         execution_times result;
         result.wallClockTime = ir.mExecutionTime.cpu_duration.count() * boost::units::si::seconds;
@@ -128,6 +213,14 @@ namespace {
                                                                timestamps.host_barrier,
                                                                info.physical_device_properties,
                                                                info.graphics_queue_family_properties);
+        result.submitLatency = measureInterval(timeline.submit_begin, timeline.submit_end);
+        result.queueWait = measureInterval(timeline.submit_end, timeline.gpu_start);
+        result.completionLatency = measureInterval(timeline.gpu_end, timeline.complete);
+
+        auto &statistics = ir.mExecutionTime.statistics;
+        result.hasStatistics = statistics.is_valid;
+        result.shaderInvocations = static_cast<double>(statistics.compute_shader_invocations);
+        result.expectedInvocations = static_cast<double>(statistics.expected_invocations);
 
         return result;
     }
@@ -140,57 +233,143 @@ namespace {
         LOGD("%*s%s", indentLevel*3, "", s.c_str());
     }
 
-    std::pair<execution_times, execution_times>
-    computeSummaryStats(const sample_info &info, const test_utils::KernelResult::results &resultSet) {
-        typedef boost::units::derived_dimension<boost::units::time_base_dimension, 2>::type time_variance_dimension;
-        typedef boost::units::unit<time_variance_dimension, boost::units::si::system> time_variance;
-
-        struct var_execution_times {
-            boost::units::quantity<time_variance> wallClockTime;
-            boost::units::quantity<time_variance> executionTime;
-            boost::units::quantity<time_variance> hostBarrierTime;
-        };
-
+    // Statistics of the measured (non-warmup) iterations of a timing run
+    TimingSummary computeSummaryStats(const sample_info &info, const test_utils::KernelResult::results &resultSet, bool rejectOutliers) {
         std::vector<execution_times> times;
         times.reserve(resultSet.size());
-        transform(resultSet.begin(), resultSet.end(), std::back_inserter(times),
-                  [&info](const test_utils::InvocationTest::result &ir) {
-                      return measureInvocationTime(info, ir.second);
-                  });
-        auto num_times = times.size();
-
-        execution_times mean = accumulate(times.begin(), times.end(), execution_times(),
-                                          [&info](execution_times accum, const execution_times &t) {
-                                              accum.wallClockTime += t.wallClockTime;
-                                              accum.executionTime += t.executionTime;
-                                              accum.hostBarrierTime += t.hostBarrierTime;
-                                              return accum;
-                                          });
-        mean.wallClockTime /= num_times;
-        mean.executionTime /= num_times;
-        mean.hostBarrierTime /= num_times;
-
-        var_execution_times variance;
-        if (num_times > 1) {
-            variance = accumulate(times.begin(), times.end(), var_execution_times(),
-                                  [mean](var_execution_times accum, const execution_times &t) {
-                                      accum.wallClockTime += pow<2>(mean.wallClockTime - t.wallClockTime);
-                                      accum.executionTime += pow<2>(mean.executionTime - t.executionTime);
-                                      accum.hostBarrierTime += pow<2>(mean.hostBarrierTime - t.hostBarrierTime);
-                                      return accum;
-                                  });
-            variance.wallClockTime /= (num_times - 1);
-            variance.executionTime /= (num_times - 1);
-            variance.hostBarrierTime /= (num_times - 1);
-        }
-
-        execution_times stdDeviation;
-        stdDeviation.wallClockTime = sqrt(variance.wallClockTime);
-        stdDeviation.executionTime = sqrt(variance.executionTime);
-        stdDeviation.hostBarrierTime = sqrt(variance.hostBarrierTime);
-
-        return std::make_pair(mean, stdDeviation);
-    };
+        for (auto& ir : resultSet) {
+            if (!ir.second.mIsWarmup) {
+                times.push_back(measureInvocationTime(info, ir.second));
+            }
+        }
+
+        TimingSummary result;
+        result.mNumSamples = times.size();
+        if (times.empty()) {
+            return result;
+        }
+
+        test_statistics::options options;
+        options.mRejectOutliers = rejectOutliers;
+
+        for (auto& field : kTimeFields) {
+            std::vector<double> samples;
+            samples.reserve(times.size());
+            std::transform(times.begin(), times.end(), std::back_inserter(samples),
+                           [&field](const execution_times& t) { return (t.*field.mMember).value(); });
+
+            const test_statistics::summary stats = test_statistics::summarize(samples, options);
+            result.mMean.*field.mMember = stats.mMean * boost::units::si::seconds;
+            result.mStdDeviation.*field.mMember = stats.mStdDeviation * boost::units::si::seconds;
+            result.mConfidenceLow.*field.mMember = stats.mConfidenceLow * boost::units::si::seconds;
+            result.mConfidenceHigh.*field.mMember = stats.mConfidenceHigh * boost::units::si::seconds;
+            result.mMedian.*field.mMember = stats.mMedian * boost::units::si::seconds;
+            result.mMad.*field.mMember = stats.mMad * boost::units::si::seconds;
+            result.mP90.*field.mMember = stats.mP90 * boost::units::si::seconds;
+            result.mP99.*field.mMember = stats.mP99 * boost::units::si::seconds;
+            result.mMax.*field.mMember = stats.mMax * boost::units::si::seconds;
+            result.mNumOutliers.push_back(stats.mNumOutliers);
+        }
+
+        // Work counts are not times; they are simply averaged
+        result.mMean.hasStatistics = std::all_of(times.begin(), times.end(),
+                                                 [](const execution_times &t) { return t.hasStatistics; });
+        for (auto& t : times) {
+            result.mMean.shaderInvocations += t.shaderInvocations;
+            result.mMean.expectedInvocations += t.expectedInvocations;
+        }
+        result.mMean.shaderInvocations /= times.size();
+        result.mMean.expectedInvocations /= times.size();
+
+        return result;
+    }
+
+    ExpectationSummary checkExpectation(const sample_info &info,
+                                        const std::vector<const test_utils::InvocationTest::result*> &timed,
+                                        const test_utils::TimingExpectation &expectation) {
+        ExpectationSummary result;
+        result.mExpectation = &expectation;
+        if (!timed.empty()) {
+            if (!timed.front()->first->mVariation.empty()) result.mVariation = &timed.front()->first->mVariation;
+            if (!timed.front()->second.mParameters.empty()) result.mParameters = &timed.front()->second.mParameters;
+        }
+
+        // GPU time where every iteration has it, as for adaptive timing
+        const bool useExecutionTime = !timed.empty()
+                                      && std::all_of(timed.begin(), timed.end(),
+                                                     [](const test_utils::InvocationTest::result* r) {
+                                                         return 0 != r->second.mExecutionTime.timestamps.execution;
+                                                     });
+        result.mMetric = (useExecutionTime ? "executionTime" : "wallClockTime");
+
+        std::vector<double> samples;
+        samples.reserve(timed.size());
+        for (auto r : timed) {
+            const execution_times times = measureInvocationTime(info, r->second);
+            const double seconds = (useExecutionTime ? times.executionTime : times.wallClockTime).value();
+
+            if (test_utils::TimingExpectation::measure::kTime == expectation.mMeasure) {
+                samples.push_back(seconds);
+            }
+            else if (r->second.mBytesTransferred > 0 && seconds > 0.0) {
+                samples.push_back(r->second.mBytesTransferred / seconds);
+            }
+        }
+
+        result.mIsMeasured = (!samples.empty() && samples.size() == timed.size());
+        if (result.mIsMeasured) {
+            if (expectation.mUseMean) {
+                result.mObserved = test_statistics::summarize(samples).mMean;
+            }
+            else {
+                std::sort(samples.begin(), samples.end());
+                result.mObserved = test_statistics::percentile(samples, expectation.mQuantile);
+            }
+        }
+
+        // A budget that cannot be checked fails, so that a gate never passes by accident
+        result.mCounts = (result.mIsMeasured && test_utils::is_met(expectation, result.mObserved)
+                          ? ResultCounts::pass()
+                          : ResultCounts::fail());
+
+        return result;
+    }
+
+    // Each variation and set of parameters runs at its own speed, so every expectation is checked
+    // against each of them separately, in the order they were first run, as the baseline
+    // comparison does. Pooling them would let a fast variation hide a slow one.
+    std::vector<ExpectationSummary> checkExpectations(const sample_info &info,
+                                                      const test_utils::KernelTest::result &kr) {
+        std::vector<std::vector<const test_utils::InvocationTest::result*>> runs;
+        for (auto& ir : kr.second.mInvocationResults) {
+            if (ir.second.mIsWarmup) continue;
+
+            auto run = std::find_if(runs.begin(), runs.end(),
+                                    [&ir](const std::vector<const test_utils::InvocationTest::result*>& r) {
+                                        return r.front()->first->mVariation == ir.first->mVariation
+                                               && r.front()->second.mParameters == ir.second.mParameters;
+                                    });
+            if (run == runs.end()) {
+                runs.push_back(std::vector<const test_utils::InvocationTest::result*>());
+                run = std::prev(runs.end());
+            }
+            run->push_back(&ir);
+        }
+
+        // An expectation with nothing to check still reports, and fails
+        if (runs.empty()) {
+            runs.push_back(std::vector<const test_utils::InvocationTest::result*>());
+        }
+
+        std::vector<ExpectationSummary> result;
+        for (auto& expectation : kr.first->mExpectations) {
+            for (auto& run : runs) {
+                result.push_back(checkExpectation(info, run, expectation));
+            }
+        }
+
+        return result;
+    }
 
     InvocationSummary summarizeInvocation(const sample_info &info, const test_utils::InvocationTest::result& ir) {
         InvocationSummary result;
@@ -207,8 +386,7 @@ namespace {
             result.mCounts = ResultCounts::skip();
         }
         else {
-            // an invocation passes if it generates at least one correct value and no incorrect values
-            result.mCounts = (ir.second.mEvaluation.mNumCorrect > 0 && ir.second.mEvaluation.mNumErrors == 0 ? ResultCounts::pass() : ResultCounts::fail());
+            result.mCounts = (test_utils::is_pass(ir.second.mEvaluation) ? ResultCounts::pass() : ResultCounts::fail());
         }
 
         return result;
@@ -218,20 +396,40 @@ namespace {
         KernelSummary result;
         result.mEntryPoint = kr.first->mEntryName;
         result.mTimingIterations = kr.first->mTimingIterations;
+        result.mWarmupIterations = kr.first->mWarmupIterations;
+        result.mIsAdaptive = kr.first->mAdaptiveTiming.mIsEnabled;
+        result.mRejectOutliers = kr.first->mRejectOutliers;
+        result.mPipelineStats = kr.second.mPipelineStats;
 
         if (!kr.second.mExceptionString.empty()) result.mExceptionMessage = &kr.second.mExceptionString;
 
+        // Warmup iterations count toward neither the results nor the statistics
         result.mInvocationSummaries.reserve(kr.second.mInvocationResults.size());
-        std::transform(kr.second.mInvocationResults.begin(), kr.second.mInvocationResults.end(),
-                       std::back_inserter(result.mInvocationSummaries),
-                       std::bind(summarizeInvocation, std::cref(info), std::placeholders::_1));
+        for (auto& ir : kr.second.mInvocationResults) {
+            if (!ir.second.mIsWarmup) {
+                result.mInvocationSummaries.push_back(summarizeInvocation(info, ir));
+            }
+        }
 
         result.mCounts = std::accumulate(result.mInvocationSummaries.begin(), result.mInvocationSummaries.end(),
                                          ResultCounts::null(),
                                          [](ResultCounts r, const InvocationSummary& is) { return r + is.mCounts; });
 
         if (result.mTimingIterations > 0) {
-            std::tie(result.mMeanTimes, result.mStdDeviationTimes) = computeSummaryStats(info, kr.second.mInvocationResults);
+            result.mTiming = computeSummaryStats(info, kr.second.mInvocationResults, result.mRejectOutliers);
+            if (!kr.second.mInvocationResults.empty()) {
+                result.mTimingStop = kr.second.mInvocationResults.back().second.mTimingStop;
+            }
+
+            result.mSetupTime = 0.0 * boost::units::si::seconds;
+            for (auto& ir : kr.second.mInvocationResults) {
+                result.mSetupTime += ir.second.mSetupTime.count() * boost::units::si::seconds;
+            }
+
+            result.mExpectations = checkExpectations(info, kr);
+            for (auto& e : result.mExpectations) {
+                result.mCounts += e.mCounts;
+            }
         }
 
         return result;
@@ -244,6 +442,12 @@ namespace {
 
         if (!mr.second.mExceptionString.empty()) result.mExceptionMessage = &mr.second.mExceptionString;
 
+        result.mIsLoaded = mr.second.mLoadedCorrectly;
+        result.mPipelineCacheStatus = mr.second.mPipelineCacheStatus;
+        result.mPrebuildTime = (mr.second.mPrebuildSpan.isValid()
+                                ? std::chrono::duration<double>(mr.second.mPrebuildSpan.mEnd - mr.second.mPrebuildSpan.mBegin).count()
+                                : 0.0) * boost::units::si::seconds;
+
         result.mKernelSummaries.reserve(mr.second.mKernelResults.size());
         std::transform(mr.second.mKernelResults.begin(), mr.second.mKernelResults.end(),
                        std::back_inserter(result.mKernelSummaries),
@@ -253,6 +457,18 @@ namespace {
                                          ResultCounts::null(),
                                          [](ResultCounts r, const KernelSummary& ks) { return r + ks.mCounts; });
 
+        for (std::size_t i = 0; i < mr.second.mKernelResults.size(); ++i) {
+            const test_utils::KernelTest& kt = *mr.second.mKernelResults[i].first;
+            const auto found = std::find_if(mr.second.mPipelineBuildResults.begin(), mr.second.mPipelineBuildResults.end(),
+                                            [&kt](const clspv_utils::pipeline_build_result_t& pb) {
+                                                return pb.mVariant.mEntryPoint == kt.mEntryName
+                                                       && pb.mVariant.mWorkgroupSize == kt.mWorkgroupSize;
+                                            });
+            if (found != mr.second.mPipelineBuildResults.end()) {
+                result.mKernelSummaries[i].mPipelineBuild = &(*found);
+            }
+        }
+
         return result;
     }
 
@@ -273,6 +489,25 @@ namespace {
         return result;
     }
 
+    // Work done by the kernel, normalized by its execution time. Empty without statistics.
+    std::string composeStatistics(const execution_times& times) {
+        if (!times.hasStatistics) {
+            return std::string();
+        }
+
+        std::ostringstream os;
+        os << boost::units::engineering_prefix
+           << " shaderInvocations:" << times.shaderInvocations
+           << " expectedInvocations:" << times.expectedInvocations;
+
+        if (times.shaderInvocations > 0.0 && times.executionTime.value() > 0.0) {
+            os << " invocationsPerSecond:" << (times.shaderInvocations / times.executionTime.value())
+               << " timePerInvocation:" << (times.executionTime / times.shaderInvocations);
+        }
+
+        return os.str();
+    }
+
     std::string composeBasicInvocationSummary(const InvocationSummary& summary) {
         std::ostringstream os;
         os << (summary.mCounts.mSkip > 0 ? "SKIP" : (summary.mCounts.mFail > 0 ? "FAIL" : "PASS"));
@@ -288,6 +523,64 @@ namespace {
         return os.str();
     }
 
+    // One statistic of every time field
+    std::string composeTimes(const char* label, const execution_times& times) {
+        std::ostringstream os;
+        os << boost::units::engineering_prefix << label << ' ';
+        for (auto& field : kTimeFields) {
+            os << ' ' << field.mName << ':' << times.*field.mMember;
+        }
+        return os.str();
+    }
+
+    // Bytes per second, scaled to the largest decimal unit that keeps the value at least one
+    std::string composeRate(double bytesPerSecond) {
+        static const std::pair<double, const char*> kUnits[] = {
+                { 1.0e12, "TB/s" }, { 1.0e9, "GB/s" }, { 1.0e6, "MB/s" }, { 1.0e3, "KB/s" }, { 1.0, "B/s" }
+        };
+
+        auto unit = std::find_if(std::begin(kUnits), std::end(kUnits),
+                                 [bytesPerSecond](const std::pair<double, const char*>& u) {
+                                     return bytesPerSecond >= u.first;
+                                 });
+        if (unit == std::end(kUnits)) --unit;
+
+        std::ostringstream os;
+        os << (bytesPerSecond / unit->first) << ' ' << unit->second;
+        return os.str();
+    }
+
+    std::string composeExpectation(const ExpectationSummary& summary) {
+        const test_utils::TimingExpectation& expectation = *summary.mExpectation;
+        const bool isRate = (test_utils::TimingExpectation::measure::kRate == expectation.mMeasure);
+
+        std::ostringstream os;
+        os << (summary.mCounts.mFail > 0 ? "FAIL" : "PASS")
+           << " EXPECT " << (isRate ? "rate " : "time ") << expectation.mText;
+
+        if (summary.mVariation) {
+            os << " variation:" << *summary.mVariation;
+        }
+
+        if (summary.mParameters) {
+            os << " parameters:" << *summary.mParameters;
+        }
+
+        os << " metric:" << summary.mMetric;
+
+        if (!summary.mIsMeasured) {
+            os << (isRate ? " observed:none (no samples, or no byte count)" : " observed:none (no samples)");
+        }
+        else if (isRate) {
+            os << " observed:" << composeRate(summary.mObserved);
+        }
+        else {
+            os << boost::units::engineering_prefix << " observed:" << summary.mObserved * boost::units::si::seconds;
+        }
+
+        return os.str();
+    }
+
     void logInvocationSummary(const InvocationSummary& summary, unsigned int indent = 0) {
         std::ostringstream os;
         os << composeBasicInvocationSummary(summary);
@@ -299,7 +592,11 @@ namespace {
                << " wallClockTime:" << summary.mTimes.wallClockTime
                << " resultEvalTime:" << summary.mTestTime
                << " executionTime:" << summary.mTimes.executionTime
-               << " hostBarrierTime:" << summary.mTimes.hostBarrierTime;
+               << " hostBarrierTime:" << summary.mTimes.hostBarrierTime
+               << " submitLatency:" << summary.mTimes.submitLatency
+               << " queueWait:" << summary.mTimes.queueWait
+               << " completionLatency:" << summary.mTimes.completionLatency
+               << composeStatistics(summary.mTimes);
         }
 
         logInfo(os.str(), indent);
@@ -313,8 +610,25 @@ namespace {
         {
             std::ostringstream os;
             os << "Kernel:" << summary.mEntryPoint << " " << summary.mCounts;
+            if (summary.mPipelineBuild && summary.mPipelineBuild->mExceptionString.empty()) {
+                os << boost::units::engineering_prefix
+                   << " compileTime:" << summary.mPipelineBuild->mCompileTime.count() * boost::units::si::seconds;
+            }
+
+            // Evictions mean the kernel recompiled pipelines it had already built
+            const clspv_utils::kernel::pipeline_stats_t& stats = summary.mPipelineStats;
+            if (stats.mHits + stats.mMisses > 0) {
+                os << " pipelineHits:" << stats.mHits
+                   << " pipelineMisses:" << stats.mMisses
+                   << " pipelineEvictions:" << stats.mEvictions;
+            }
             logInfo(os.str(), indent);
         }
+        if (summary.mPipelineBuild && !summary.mPipelineBuild->mExceptionString.empty()) {
+            std::ostringstream os;
+            os << "prebuild exception: " << summary.mPipelineBuild->mExceptionString;
+            logInfo(os.str(), indent + 1);
+        }
         if (summary.mExceptionMessage) {
             std::ostringstream os;
             os << "exception: " << *summary.mExceptionMessage;
@@ -330,30 +644,60 @@ namespace {
 
             {
                 std::ostringstream os;
-                os << "NUMBER ITERATIONS = " << summary.mTimingIterations;
+                os << "NUMBER ITERATIONS = ";
+                if (summary.mIsAdaptive) {
+                    // how many were taken, of how many allowed
+                    os << summary.mInvocationSummaries.size()
+                       << " (adaptive, max:" << summary.mTimingIterations
+                       << " stopped:" << test_utils::to_string(summary.mTimingStop) << ')';
+                }
+                else {
+                    os << summary.mTimingIterations;
+                }
                 logInfo(os.str(), indent + 1);
             }
 
             {
                 std::ostringstream os;
                 os << boost::units::engineering_prefix
-                   << "AVERAGE "
-                   << " wallClockTime:" << summary.mMeanTimes.wallClockTime
-                   << " executionTime:" << summary.mMeanTimes.executionTime
-                   << " hostBarrierTime:" << summary.mMeanTimes.hostBarrierTime;
+                   << "SETUP "
+                   << " setupTime:" << summary.mSetupTime;
                 logInfo(os.str(), indent + 1);
             }
 
-            if (summary.mInvocationSummaries.size() > 1) {
+            if (summary.mWarmupIterations > 0) {
                 std::ostringstream os;
-                os << boost::units::engineering_prefix
-                   << "STD_DEVIATION "
-                   << " wallClockTime:" << summary.mStdDeviationTimes.wallClockTime
-                   << " executionTime:" << summary.mStdDeviationTimes.executionTime
-                   << " hostBarrierTime:" << summary.mStdDeviationTimes.hostBarrierTime;
+                os << "WARMUP ITERATIONS = " << summary.mWarmupIterations;
+                logInfo(os.str(), indent + 1);
+            }
+
+            const TimingSummary& timing = summary.mTiming;
+            logInfo(composeTimes("AVERAGE", timing.mMean) + composeStatistics(timing.mMean), indent + 1);
+
+            if (timing.mNumSamples > 1) {
+                logInfo(composeTimes("STD_DEVIATION", timing.mStdDeviation), indent + 1);
+                logInfo(composeTimes("CONFIDENCE_95_LOW", timing.mConfidenceLow), indent + 1);
+                logInfo(composeTimes("CONFIDENCE_95_HIGH", timing.mConfidenceHigh), indent + 1);
+            }
 
+            logInfo(composeTimes("MEDIAN", timing.mMedian), indent + 1);
+            logInfo(composeTimes("MAD", timing.mMad), indent + 1);
+            logInfo(composeTimes("P90", timing.mP90), indent + 1);
+            logInfo(composeTimes("P99", timing.mP99), indent + 1);
+            logInfo(composeTimes("MAX", timing.mMax), indent + 1);
+
+            if (summary.mRejectOutliers) {
+                std::ostringstream os;
+                os << "OUTLIERS ";
+                for (std::size_t i = 0; i < timing.mNumOutliers.size() && i < kNumTimeFields; ++i) {
+                    os << ' ' << kTimeFields[i].mName << ':' << timing.mNumOutliers[i];
+                }
                 logInfo(os.str(), indent + 1);
             }
+
+            for (auto& e : summary.mExpectations) {
+                logInfo(composeExpectation(e), indent + 1);
+            }
         }
     }
 
@@ -361,6 +705,12 @@ namespace {
         {
             std::ostringstream os;
             os << "Module:" << summary.mName << " " << summary.mCounts;
+            if (summary.mIsLoaded) {
+                // A cold cache explains a long prebuild
+                os << boost::units::engineering_prefix
+                   << " pipelineCache:" << clspv_utils::to_string(summary.mPipelineCacheStatus)
+                   << " prebuildTime:" << summary.mPrebuildTime;
+            }
             logInfo(os.str(), indent);
         }
 
@@ -454,4 +804,46 @@ namespace test_result_logging {
         logManifestSummary(summary);
     }
 
+    void logBaselineComparison(const test_baseline::comparisons &comparisons) {
+        logInfo("Baseline Comparison", 0);
+
+        std::map<test_baseline::verdict, unsigned int> counts;
+        for (auto& c : comparisons) {
+            ++counts[c.mVerdict];
+
+            std::ostringstream os;
+            os << boost::units::engineering_prefix
+               << test_baseline::to_string(c.mVerdict) << ' ' << c.mLabel
+               << " metric:" << c.mMetric;
+            if (test_baseline::verdict::kNoBaseline == c.mVerdict) {
+                os << " currentMedian:" << (c.mCurrentMedianNs * 1.0e-9 * boost::units::si::seconds)
+                   << " samples:" << c.mCurrentCount;
+            }
+            else {
+                std::ostringstream change;
+                change << std::showpos << std::fixed << std::setprecision(1) << (c.mRelativeChange * 100.0) << '%';
+
+                os << " baselineMedian:" << (c.mBaselineMedianNs * 1.0e-9 * boost::units::si::seconds)
+                   << " currentMedian:" << (c.mCurrentMedianNs * 1.0e-9 * boost::units::si::seconds)
+                   << " change:" << change.str()
+                   << " p:" << std::setprecision(3) << c.mPValue
+                   << " samples:" << c.mBaselineCount << '/' << c.mCurrentCount;
+            }
+
+            if (test_baseline::verdict::kRegression == c.mVerdict || test_baseline::verdict::kImprovement == c.mVerdict) {
+                logInfo(os.str(), 1);
+            }
+            else {
+                logDebug(os.str(), 1);
+            }
+        }
+
+        std::ostringstream os;
+        os << "regressions:" << counts[test_baseline::verdict::kRegression]
+           << " improvements:" << counts[test_baseline::verdict::kImprovement]
+           << " unchanged:" << counts[test_baseline::verdict::kUnchanged]
+           << " no baseline:" << counts[test_baseline::verdict::kNoBaseline];
+        logInfo(os.str(), 0);
+    }
+
 }
\ No newline at end of file
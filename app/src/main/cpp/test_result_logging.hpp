@@ -5,6 +5,7 @@
 #ifndef CLSPVTEST_TEST_RESULT_LOGGING_HPP
 #define CLSPVTEST_TEST_RESULT_LOGGING_HPP
 
+#include "test_baseline.hpp"
 #include "test_manifest.hpp"
 #include "test_utils.hpp"
 
@@ -20,6 +21,9 @@ namespace test_result_logging {
     void logResults(const sample_info &info, const test_utils::ModuleTest::result &mr);
 
     void logResults(const sample_info &info, const test_manifest::results &manifestResults);
+
+    // Regressions and improvements always; unchanged runs at debug level
+    void logBaselineComparison(const test_baseline::comparisons &comparisons);
 }
 
 #endif //CLSPVTEST_TEST_RESULT_LOGGING_HPP
@@ -0,0 +1,301 @@
+#include "test_result_trace.hpp"
+
+#include "test_result_export.hpp"
+#include "test_utils.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    typedef test_utils::TimeSpan::clock clock;
+
+    const int kProcessId        = 1;
+    const int kHostThreadId     = 1;
+    const int kQueueThreadId    = 2;
+    const int kFirstBuilderThreadId = 3;    // pipeline builder threads other than the test thread
+
+    // One complete ("X") event
+    struct trace_event {
+        std::string         mName;
+        const char*         mCategory   = "";
+        int                 mThread     = kHostThreadId;
+        clock::time_point   mBegin;
+        clock::time_point   mEnd;
+        std::string         mArgs;      // members of the args object, without the braces
+    };
+
+    // An arrow from a host event to the GPU event it caused
+    struct trace_flow {
+        unsigned int        mId     = 0;
+        clock::time_point   mFrom;      // on the host thread
+        clock::time_point   mTo;        // on the queue
+    };
+
+    struct trace_collection {
+        std::vector<trace_event>    mEvents;
+        std::vector<trace_flow>     mFlows;
+        unsigned int                mNumBuilderThreads  = 0;    // besides the test thread
+    };
+
+    std::string stringArg(const char* name, const std::string& value) {
+        return std::string("\"") + name + "\":\"" + test_result_export::escapeJson(value) + '"';
+    }
+
+    template <typename T>
+    std::string numberArg(const char* name, T value) {
+        std::ostringstream os;
+        os << '"' << name << "\":" << value;
+        return os.str();
+    }
+
+    std::string joinArgs(const std::vector<std::string>& args) {
+        std::string result;
+        for (auto& a : args) {
+            if (!result.empty()) result += ',';
+            result += a;
+        }
+        return result;
+    }
+
+    void addEvent(trace_collection&         trace,
+                  const std::string&        name,
+                  const char*               category,
+                  int                       thread,
+                  clock::time_point         begin,
+                  clock::time_point         end,
+                  const std::string&        args = std::string()) {
+        if (clock::time_point() == begin || clock::time_point() == end) {
+            return;
+        }
+
+        trace_event event;
+        event.mName = name;
+        event.mCategory = category;
+        event.mThread = thread;
+        event.mBegin = begin;
+        event.mEnd = std::max(begin, end);
+        event.mArgs = args;
+        trace.mEvents.push_back(event);
+    }
+
+    void addSpan(trace_collection&          trace,
+                 const std::string&         name,
+                 const char*                category,
+                 const test_utils::TimeSpan& span,
+                 const std::string&         args = std::string()) {
+        if (span.isValid()) {
+            addEvent(trace, name, category, kHostThreadId, span.mBegin, span.mEnd, args);
+        }
+    }
+
+    // The test thread builds pipelines too, and its builds go on its own track
+    int builderThread(unsigned int worker) {
+        return (0 == worker ? kHostThreadId : kFirstBuilderThreadId + static_cast<int>(worker) - 1);
+    }
+
+    void tracePipelineBuild(trace_collection& trace, const clspv_utils::pipeline_build_result_t& build) {
+        if (clock::time_point() == build.mBuildBegin) {
+            return;
+        }
+
+        const clspv_utils::pipeline_variant_t& variant = build.mVariant;
+
+        std::vector<std::string> args;
+        args.push_back(stringArg("workgroupSize", test_utils::workgroup_size_string(variant.mWorkgroupSize)));
+        if (!variant.mSpecConstants.empty()) {
+            std::ostringstream specConstants;
+            for (auto sc = variant.mSpecConstants.begin(); sc != variant.mSpecConstants.end(); ++sc) {
+                if (sc != variant.mSpecConstants.begin()) specConstants << ',';
+                specConstants << *sc;
+            }
+            args.push_back(stringArg("specConstants", specConstants.str()));
+        }
+        args.push_back(numberArg("worker", build.mWorker));
+        if (!build.mExceptionString.empty()) {
+            args.push_back(stringArg("exception", build.mExceptionString));
+        }
+
+        addEvent(trace, variant.mEntryPoint, "pipeline", builderThread(build.mWorker),
+                 build.mBuildBegin, build.mBuildEnd, joinArgs(args));
+        trace.mNumBuilderThreads = std::max(trace.mNumBuilderThreads, build.mWorker);
+    }
+
+    void traceInvocation(trace_collection&                          trace,
+                         const test_utils::KernelTest&              kernelTest,
+                         const test_utils::InvocationTest::result&  ir) {
+        const test_utils::InvocationResult& result = ir.second;
+        const bool isTiming = (kernelTest.mTimingIterations > 0);
+
+        // The invocation as a whole covers whichever of its phases happened
+        const test_utils::TimeSpan* phases[] = { &result.mPrepareSpan, &result.mRunSpan, &result.mEvaluateSpan };
+        test_utils::TimeSpan whole;
+        for (auto p : phases) {
+            if (!p->isValid()) continue;
+            if (clock::time_point() == whole.mBegin) whole.mBegin = p->mBegin;
+            whole.mEnd = p->mEnd;
+        }
+
+        const std::string& name = (ir.first->mVariation.empty() ? kernelTest.mEntryName : ir.first->mVariation);
+        std::vector<std::string> args;
+        args.push_back(stringArg("result", test_utils::to_string(result.mEvaluation)));
+        if (!result.mParameters.empty()) {
+            args.push_back(stringArg("parameters", result.mParameters));
+        }
+        addSpan(trace, name, "invocation", whole, joinArgs(args));
+
+        addSpan(trace, isTiming ? "record" : "prepare", "phase", result.mPrepareSpan);
+        addSpan(trace, result.mIsWarmup ? "warmup" : (isTiming ? "replay" : "run"), "phase", result.mRunSpan);
+        addSpan(trace, "evaluate", "phase", result.mEvaluateSpan);
+
+        const auto& timeline = result.mExecutionTime.timeline;
+        addEvent(trace, "vkQueueSubmit", "submit", kHostThreadId, timeline.submit_begin, timeline.submit_end);
+
+        std::vector<std::string> gpuArgs;
+        gpuArgs.push_back(stringArg("variation", ir.first->mVariation));
+        if (result.mIsWarmup) {
+            gpuArgs.push_back("\"warmup\":true");
+        }
+        if (result.mExecutionTime.statistics.is_valid) {
+            gpuArgs.push_back(numberArg("shaderInvocations", result.mExecutionTime.statistics.compute_shader_invocations));
+        }
+        addEvent(trace, kernelTest.mEntryName, "dispatch", kQueueThreadId, timeline.gpu_start, timeline.gpu_end, joinArgs(gpuArgs));
+
+        if (clock::time_point() != timeline.submit_end && clock::time_point() != timeline.gpu_start) {
+            trace_flow flow;
+            flow.mId = static_cast<unsigned int>(trace.mFlows.size() + 1);
+            flow.mFrom = timeline.submit_end;
+            flow.mTo = timeline.gpu_start;
+            trace.mFlows.push_back(flow);
+        }
+    }
+
+    void traceKernel(trace_collection& trace, const test_utils::KernelTest::result& kr) {
+        const test_utils::KernelTest& kernelTest = *kr.first;
+        const test_utils::KernelResult& result = kr.second;
+        if (result.mSkipped) {
+            return;
+        }
+
+        std::vector<std::string> args;
+        args.push_back(stringArg("workgroupSize", test_utils::workgroup_size_string(kernelTest.mWorkgroupSize)));
+        if (kernelTest.mTimingIterations > 0) {
+            args.push_back(numberArg(kernelTest.mAdaptiveTiming.mIsEnabled ? "maxIterations" : "iterations",
+                                     kernelTest.mTimingIterations));
+        }
+        if (kernelTest.mAdaptiveTiming.mIsEnabled && !result.mInvocationResults.empty()) {
+            const auto taken = std::count_if(result.mInvocationResults.begin(), result.mInvocationResults.end(),
+                                             [](const test_utils::InvocationTest::result& ir) { return !ir.second.mIsWarmup; });
+            args.push_back(numberArg("iterationsTaken", taken));
+            args.push_back(stringArg("stopped", test_utils::to_string(result.mInvocationResults.back().second.mTimingStop)));
+        }
+        if (!result.mExceptionString.empty()) {
+            args.push_back(stringArg("exception", result.mExceptionString));
+        }
+        addSpan(trace, kernelTest.mEntryName, "kernel", result.mSpan, joinArgs(args));
+        addSpan(trace, "construct kernel", "phase", result.mConstructSpan);
+
+        for (auto& ir : result.mInvocationResults) {
+            traceInvocation(trace, kernelTest, ir);
+        }
+    }
+
+    void traceModule(trace_collection& trace, const test_utils::ModuleTest::result& mr) {
+        const test_utils::ModuleResult& result = mr.second;
+
+        std::string args;
+        if (!result.mExceptionString.empty()) {
+            args = stringArg("exception", result.mExceptionString);
+        }
+        addSpan(trace, mr.first->mName, "module", result.mSpan, args);
+        addSpan(trace, "load module", "phase", result.mLoadSpan);
+        addSpan(trace, "prebuild pipelines", "phase", result.mPrebuildSpan,
+                numberArg("pipelines", result.mPipelineBuildResults.size()));
+        for (auto& build : result.mPipelineBuildResults) {
+            tracePipelineBuild(trace, build);
+        }
+
+        for (auto& kr : result.mKernelResults) {
+            traceKernel(trace, kr);
+        }
+    }
+
+    // Trace timestamps are microseconds from the earliest event in the run
+    double toTraceTime(clock::time_point t, clock::time_point origin) {
+        return std::chrono::duration<double, std::micro>(t - origin).count();
+    }
+
+    void writeMetadata(std::ostream& os, const char* name, int thread, const std::string& value) {
+        os << "{\"ph\":\"M\",\"name\":\"" << name << "\",\"pid\":" << kProcessId;
+        if (thread > 0) {
+            os << ",\"tid\":" << thread;
+        }
+        os << ",\"args\":{\"name\":\"" << test_result_export::escapeJson(value) << "\"}}";
+    }
+}
+
+namespace test_result_trace {
+
+    void writeTrace(const sample_info &info, const test_manifest::results &manifestResults, std::ostream &os) {
+        trace_collection trace;
+        for (auto& mr : manifestResults) {
+            traceModule(trace, mr);
+        }
+
+        clock::time_point origin = clock::time_point::max();
+        for (auto& e : trace.mEvents) {
+            origin = std::min(origin, e.mBegin);
+        }
+
+        std::ostringstream queueName;
+        queueName << "compute queue (family " << info.graphics_queue_family_index << ')';
+
+        os << std::fixed << std::setprecision(3);
+        os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" << std::endl;
+
+        writeMetadata(os, "process_name", 0, std::string("clspv_test ") + info.physical_device_properties.deviceName);
+        os << ',' << std::endl;
+        writeMetadata(os, "thread_name", kHostThreadId, "test thread");
+        os << ',' << std::endl;
+        writeMetadata(os, "thread_name", kQueueThreadId, queueName.str());
+        for (unsigned int worker = 1; worker <= trace.mNumBuilderThreads; ++worker) {
+            std::ostringstream builderName;
+            builderName << "pipeline builder " << worker;
+
+            os << ',' << std::endl;
+            writeMetadata(os, "thread_name", builderThread(worker), builderName.str());
+        }
+
+        for (auto& e : trace.mEvents) {
+            os << ',' << std::endl
+               << "{\"ph\":\"X\",\"pid\":" << kProcessId
+               << ",\"tid\":" << e.mThread
+               << ",\"name\":\"" << test_result_export::escapeJson(e.mName) << '"'
+               << ",\"cat\":\"" << e.mCategory << '"'
+               << ",\"ts\":" << toTraceTime(e.mBegin, origin)
+               << ",\"dur\":" << toTraceTime(e.mEnd, e.mBegin);
+            if (!e.mArgs.empty()) {
+                os << ",\"args\":{" << e.mArgs << '}';
+            }
+            os << '}';
+        }
+
+        for (auto& f : trace.mFlows) {
+            os << ',' << std::endl
+               << "{\"ph\":\"s\",\"pid\":" << kProcessId << ",\"tid\":" << kHostThreadId
+               << ",\"name\":\"submit\",\"cat\":\"submit\",\"id\":" << f.mId
+               << ",\"ts\":" << toTraceTime(f.mFrom, origin) << '}'
+               << ',' << std::endl
+               << "{\"ph\":\"f\",\"bp\":\"e\",\"pid\":" << kProcessId << ",\"tid\":" << kQueueThreadId
+               << ",\"name\":\"submit\",\"cat\":\"submit\",\"id\":" << f.mId
+               << ",\"ts\":" << toTraceTime(f.mTo, origin) << '}';
+        }
+
+        os << std::endl << "]}" << std::endl;
+    }
+
+}
@@ -0,0 +1,18 @@
+#ifndef CLSPVTEST_TEST_RESULT_TRACE_HPP
+#define CLSPVTEST_TEST_RESULT_TRACE_HPP
+
+#include "test_manifest.hpp"
+
+#include <iosfwd>
+
+struct sample_info;
+
+namespace test_result_trace {
+    // Writes the run as a Chrome Trace Event JSON document, which chrome://tracing and Perfetto
+    // both load. Host phases go on the test thread's track; dispatches go on the compute queue's
+    // track, at the host times their GPU timestamps map to. Dispatches whose timestamps could not
+    // be placed on the host clock are left out.
+    void writeTrace(const sample_info &info, const test_manifest::results &manifestResults, std::ostream &os);
+}
+
+#endif //CLSPVTEST_TEST_RESULT_TRACE_HPP
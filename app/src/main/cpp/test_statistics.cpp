@@ -0,0 +1,158 @@
+#include "test_statistics.hpp"
+
+#include <boost/math/distributions/students_t.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+
+    // Outlier fences computed from fewer samples than this are meaningless
+    const std::size_t kMinSamplesForRejection = 4;
+
+}
+
+namespace test_statistics {
+
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+        if (sorted.empty()) {
+            return 0.0;
+        }
+
+        const double rank = std::min(std::max(p, 0.0), 1.0) * (sorted.size() - 1);
+        const std::size_t below = static_cast<std::size_t>(std::floor(rank));
+        const std::size_t above = std::min(below + 1, sorted.size() - 1);
+
+        return sorted[below] + (rank - below) * (sorted[above] - sorted[below]);
+    }
+
+    double confidenceHalfWidth(double stdDeviation, std::size_t count, double confidence)
+    {
+        if (count < 2) {
+            return 0.0;
+        }
+
+        const double n = static_cast<double>(count);
+        const boost::math::students_t distribution(n - 1.0);
+        const double t = boost::math::quantile(boost::math::complement(distribution, (1.0 - confidence) / 2.0));
+
+        return t * stdDeviation / std::sqrt(n);
+    }
+
+    double mannWhitneyPValue(const std::vector<double>& a, const std::vector<double>& b)
+    {
+        if (a.size() < 2 || b.size() < 2) {
+            return 1.0;
+        }
+
+        // Rank the pooled samples, giving tied samples the mean of their ranks
+        std::vector<std::pair<double, bool>> pooled;   // value, is from a
+        pooled.reserve(a.size() + b.size());
+        for (double x : a) pooled.push_back(std::make_pair(x, true));
+        for (double x : b) pooled.push_back(std::make_pair(x, false));
+        std::sort(pooled.begin(), pooled.end());
+
+        double rankSumA = 0.0;
+        double tieCorrection = 0.0;
+        for (std::size_t first = 0; first < pooled.size(); ) {
+            std::size_t last = first + 1;
+            while (last < pooled.size() && pooled[last].first == pooled[first].first) {
+                ++last;
+            }
+
+            const double tied = static_cast<double>(last - first);
+            const double rank = (first + 1 + last) / 2.0;
+            for (std::size_t i = first; i < last; ++i) {
+                if (pooled[i].second) rankSumA += rank;
+            }
+            tieCorrection += tied * tied * tied - tied;
+
+            first = last;
+        }
+
+        const double n1 = static_cast<double>(a.size());
+        const double n2 = static_cast<double>(b.size());
+        const double n = n1 + n2;
+        const double u = rankSumA - n1 * (n1 + 1.0) / 2.0;
+        const double mean = n1 * n2 / 2.0;
+        const double variance = n1 * n2 / 12.0 * ((n + 1.0) - tieCorrection / (n * (n - 1.0)));
+        if (variance <= 0.0) {
+            return 1.0;
+        }
+
+        const double z = std::max(std::abs(u - mean) - 0.5, 0.0) / std::sqrt(variance);
+        return std::erfc(z / std::sqrt(2.0));
+    }
+
+    void running_summary::add(double x)
+    {
+        ++mCount;
+        const double delta = x - mMean;
+        mMean += delta / mCount;
+        mSumSquares += delta * (x - mMean);
+    }
+
+    double running_summary::getStdDeviation() const
+    {
+        return (mCount > 1 ? std::sqrt(mSumSquares / (mCount - 1)) : 0.0);
+    }
+
+    summary summarize(std::vector<double> samples, const options& opts)
+    {
+        summary result;
+
+        std::sort(samples.begin(), samples.end());
+
+        if (opts.mRejectOutliers && samples.size() >= kMinSamplesForRejection) {
+            const double q1 = percentile(samples, 0.25);
+            const double q3 = percentile(samples, 0.75);
+            const double fence = opts.mOutlierFence * (q3 - q1);
+
+            const auto first = std::lower_bound(samples.begin(), samples.end(), q1 - fence);
+            const auto last = std::upper_bound(first, samples.end(), q3 + fence);
+
+            result.mNumOutliers = samples.size() - (last - first);
+            samples = std::vector<double>(first, last);
+        }
+
+        result.mCount = samples.size();
+        if (samples.empty()) {
+            return result;
+        }
+
+        const double n = static_cast<double>(samples.size());
+        result.mMean = std::accumulate(samples.begin(), samples.end(), 0.0) / n;
+
+        if (samples.size() > 1) {
+            const double mean = result.mMean;
+            const double sumSquares = std::accumulate(samples.begin(), samples.end(), 0.0,
+                                                      [mean](double accum, double x) {
+                                                          return accum + (x - mean) * (x - mean);
+                                                      });
+            result.mStdDeviation = std::sqrt(sumSquares / (n - 1.0));
+        }
+
+        result.mMin = samples.front();
+        result.mMax = samples.back();
+        result.mMedian = percentile(samples, 0.50);
+        result.mP90 = percentile(samples, 0.90);
+        result.mP99 = percentile(samples, 0.99);
+
+        std::vector<double> deviations;
+        deviations.reserve(samples.size());
+        const double median = result.mMedian;
+        std::transform(samples.begin(), samples.end(), std::back_inserter(deviations),
+                       [median](double x) { return std::abs(x - median); });
+        std::sort(deviations.begin(), deviations.end());
+        result.mMad = percentile(deviations, 0.50);
+
+        const double halfWidth = confidenceHalfWidth(result.mStdDeviation, result.mCount, opts.mConfidence);
+        result.mConfidenceLow = result.mMean - halfWidth;
+        result.mConfidenceHigh = result.mMean + halfWidth;
+
+        return result;
+    }
+
+}
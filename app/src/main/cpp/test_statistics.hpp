@@ -0,0 +1,70 @@
+#ifndef CLSPVTEST_TEST_STATISTICS_HPP
+#define CLSPVTEST_TEST_STATISTICS_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace test_statistics {
+
+    struct options {
+        // Drop samples outside [Q1 - fence * IQR, Q3 + fence * IQR] before computing anything
+        // else. Rejection needs at least four samples; fewer are kept as they are.
+        bool    mRejectOutliers = false;
+        double  mOutlierFence   = 1.5;
+
+        // Coverage of the confidence interval around the mean
+        double  mConfidence     = 0.95;
+    };
+
+    // Statistics of a set of samples, in the samples' own unit
+    struct summary {
+        std::size_t mCount          = 0;    // samples summarized, after outlier rejection
+        std::size_t mNumOutliers    = 0;    // samples rejected as outliers
+
+        double      mMean           = 0.0;
+        double      mStdDeviation   = 0.0;  // sample standard deviation; zero for fewer than two samples
+        double      mMin            = 0.0;
+        double      mMax            = 0.0;
+        double      mMedian         = 0.0;
+        double      mP90            = 0.0;
+        double      mP99            = 0.0;
+        double      mMad            = 0.0;  // median absolute deviation from the median, unscaled
+
+        // Student's t interval for the mean; collapses to the mean for fewer than two samples
+        double      mConfidenceLow  = 0.0;
+        double      mConfidenceHigh = 0.0;
+    };
+
+    summary summarize(std::vector<double> samples, const options& opts = options());
+
+    // Mean and standard deviation updated one sample at a time (Welford's method), for deciding
+    // when enough samples have been taken
+    class running_summary {
+    public:
+        void        add(double x);
+
+        std::size_t getCount() const { return mCount; }
+        double      getMean() const { return mMean; }
+        double      getStdDeviation() const;
+
+    private:
+        std::size_t mCount          = 0;
+        double      mMean           = 0.0;
+        double      mSumSquares     = 0.0;  // of differences from the mean
+    };
+
+    // Half the width of the Student's t confidence interval for the mean of count samples with
+    // the given standard deviation. Zero for fewer than two samples.
+    double  confidenceHalfWidth(double stdDeviation, std::size_t count, double confidence);
+
+    // Two-sided p-value of the Mann-Whitney U test that samples a and b come from the same
+    // distribution, by the normal approximation with tie and continuity corrections. One (no
+    // evidence of a difference) if either set has fewer than two samples.
+    double  mannWhitneyPValue(const std::vector<double>& a, const std::vector<double>& b);
+
+    // The p-quantile (0 <= p <= 1) of sorted samples, interpolating linearly between closest
+    // ranks. Zero for no samples.
+    double  percentile(const std::vector<double>& sorted, double p);
+}
+
+#endif //CLSPVTEST_TEST_STATISTICS_HPP
@@ -9,7 +9,11 @@
 #include "clspv_utils/module.hpp"
 
 #include "crlf_savvy.hpp"
+#include "test_statistics.hpp"
 #include "util.hpp"
+#include "vulkan_utils/vulkan_utils.hpp"
+
+#include <algorithm>
 
 namespace {
     using namespace test_utils;
@@ -67,9 +71,11 @@ namespace test_utils {
         KernelTest::result result;
         result.first = &kernelTest;
         result.second.mSkipped = false;
+        result.second.mSpan.begin();
 
         clspv_utils::kernel kernel;
 
+        result.second.mConstructSpan.begin();
 		try {
 	        kernel = clspv_utils::kernel(module.createKernelReq(kernelTest.mEntryName), kernelTest.mWorkgroupSize);
             result.second.mCompiledCorrectly = true;
@@ -77,8 +83,17 @@ namespace test_utils {
         catch (...) {
             result.second.mExceptionString = current_exception_to_string();
         }
+        result.second.mConstructSpan.end();
 
         if (!kernelTest.mInvocationTests.empty()) {
+            vulkan_utils::memory_allocator* allocator = nullptr;
+            vulkan_utils::memory_allocator::placement savedPlacement = vulkan_utils::memory_allocator::kPlacement_Dynamic;
+            if (result.second.mCompiledCorrectly) {
+                allocator = &kernel.getDevice().getMemoryAllocator();
+                savedPlacement = allocator->getDefaultPlacement();
+                allocator->setDefaultPlacement(kernelTest.mBufferPlacement);
+            }
+
             try {
                 for (auto &oneTest : kernelTest.mInvocationTests) {
                     std::vector<InvocationResult> invocationResults;
@@ -92,7 +107,12 @@ namespace test_utils {
                     }
                     else
                     {
-                        invocationResults = oneTest.mTimeFn(kernel, kernelTest.mArguments, kernelTest.mTimingIterations, kernelTest.mIsVerbose);
+                        TimingPlan plan;
+                        plan.mWarmupIterations = kernelTest.mWarmupIterations;
+                        plan.mIterations = kernelTest.mTimingIterations;
+                        plan.mAdaptive = kernelTest.mAdaptiveTiming;
+
+                        invocationResults = oneTest.mTimeFn(kernel, kernelTest.mArguments, plan, kernelTest.mIsVerbose);
                     }
 
                     for (auto& oneResult : invocationResults) {
@@ -103,8 +123,14 @@ namespace test_utils {
             catch (...) {
                 result.second.mExceptionString = current_exception_to_string();
             }
+
+            if (allocator) {
+                allocator->setDefaultPlacement(savedPlacement);
+            }
         }
 
+        result.second.mPipelineStats = kernel.getPipelineStats();
+        result.second.mSpan.end();
         return result;
     }
 
@@ -112,8 +138,10 @@ namespace test_utils {
                                    const ModuleTest&    moduleTest) {
         ModuleTest::result result;
         result.first = &moduleTest;
+        result.second.mSpan.begin();
 
         try {
+            result.second.mLoadSpan.begin();
             android_utils::iassetstream spvmapStream(moduleTest.mName + ".spvmap");
             if (!spvmapStream.good())
             {
@@ -137,9 +165,44 @@ namespace test_utils {
 
             clspv_utils::module module(spvStream, inDevice, moduleInterface);
             result.second.mLoadedCorrectly = true;
+            result.second.mPipelineCacheStatus = module.getPipelineCacheStatus();
             spvStream.close();
+            result.second.mLoadSpan.end();
 
             auto entryPoints = module.getEntryPoints();
+
+            // Compile every pipeline the tests will need before any test runs, so that compile
+            // time does not leak into the first measured invocation of each kernel.
+            std::vector<clspv_utils::pipeline_variant_t> variants;
+            for (auto& kt : moduleTest.mKernelTests) {
+                if (vk::Extent3D(0, 0, 0) == kt.mWorkgroupSize
+                    || entryPoints.end() == std::find(entryPoints.begin(), entryPoints.end(), kt.mEntryName)) {
+                    continue;
+                }
+
+                for (auto& it : kt.mInvocationTests) {
+                    clspv_utils::pipeline_variant_t variant;
+                    variant.mEntryPoint = kt.mEntryName;
+                    variant.mWorkgroupSize = kt.mWorkgroupSize;
+                    if (it.mLocalArraySizesFn) {
+                        variant.mSpecConstants = it.mLocalArraySizesFn(kt.mWorkgroupSize, kt.mArguments);
+                    }
+
+                    const bool isDuplicate = std::any_of(variants.begin(), variants.end(),
+                                                         [&variant](const clspv_utils::pipeline_variant_t& v) {
+                                                             return v.mEntryPoint == variant.mEntryPoint
+                                                                    && v.mWorkgroupSize == variant.mWorkgroupSize
+                                                                    && v.mSpecConstants == variant.mSpecConstants;
+                                                         });
+                    if (!isDuplicate) {
+                        variants.push_back(variant);
+                    }
+                }
+            }
+            result.second.mPrebuildSpan.begin();
+            result.second.mPipelineBuildResults = module.prebuildPipelines(variants);
+            result.second.mPrebuildSpan.end();
+
             for (const auto& ep : entryPoints) {
                 std::vector<const KernelTest*> entryTests;
                 for (auto& kt : moduleTest.mKernelTests) {
@@ -172,6 +235,11 @@ namespace test_utils {
             result.second.mExceptionString = current_exception_to_string();
         }
 
+        // Every kernel and invocation from the module is gone by now, so the argument descriptor
+        // sets they used can be recycled in bulk.
+        inDevice.getDescriptorArena().reset();
+
+        result.second.mSpan.end();
         return result;
     }
 
@@ -209,6 +277,24 @@ namespace test_utils {
         return *this;
     }
 
+    bool is_pass(const Evaluation& evaluation)
+    {
+        return !evaluation.mSkipped && evaluation.mNumCorrect > 0 && evaluation.mNumErrors == 0;
+    }
+
+    const char* to_string(const Evaluation& evaluation)
+    {
+        if (evaluation.mSkipped) return "SKIP";
+        return (is_pass(evaluation) ? "PASS" : "FAIL");
+    }
+
+    std::string workgroup_size_string(const vk::Extent3D& workgroupSize)
+    {
+        std::ostringstream os;
+        os << workgroupSize.width << 'x' << workgroupSize.height << 'x' << workgroupSize.depth;
+        return os.str();
+    }
+
     InvocationResult run_test(clspv_utils::kernel&              kernel,
                               const std::vector<std::string>&   args,
                               bool                              verbose,
@@ -217,13 +303,20 @@ namespace test_utils {
         InvocationResult invocationResult;
 
         invocationResult.mParameters = test.getParameterString();
+        invocationResult.mBytesTransferred = test.getBytesTransferred();
 
+        invocationResult.mPrepareSpan.begin();
         test.prepare();
+        invocationResult.mPrepareSpan.end();
 
+        invocationResult.mRunSpan.begin();
         invocationResult.mExecutionTime = test.run(kernel);
+        invocationResult.mRunSpan.end();
 
         StopWatch watch;
+        invocationResult.mEvaluateSpan.begin();
         invocationResult.mEvaluation = test.evaluate(verbose);
+        invocationResult.mEvaluateSpan.end();
         invocationResult.mEvalTime = watch.getSplitTime();
 
         return invocationResult;
@@ -231,27 +324,105 @@ namespace test_utils {
 
     std::vector<InvocationResult> time_test(clspv_utils::kernel&             kernel,
                                             const std::vector<std::string>&  args,
-                                            unsigned int                     iterations,
+                                            const TimingPlan&                plan,
                                             bool                             verbose,
                                             Test&                            test)
     {
         std::vector<InvocationResult> results;
 
+        const AdaptiveTiming& adaptive = plan.mAdaptive;
+        const unsigned int timedIterations = (adaptive.mIsEnabled ? adaptive.mMaxIterations : plan.mIterations);
+        TimingStop stop = (adaptive.mIsEnabled ? TimingStop::kMaxIterations : TimingStop::kIterations);
+
+        // Adaptive runs judge convergence on the GPU's time for the dispatch, where there is one
+        const clspv_utils::device& device = kernel.getDevice();
+        const vk::PhysicalDeviceProperties deviceProperties = device.getPhysicalDevice().getProperties();
+        const vk::QueueFamilyProperties queueFamilyProperties = device.getPhysicalDevice().getQueueFamilyProperties()[device.getComputeQueueFamily()];
+        test_statistics::running_summary samples;
+
         InvocationResult oneResult;
         oneResult.mParameters = test.getParameterString();
+        oneResult.mBytesTransferred = test.getBytesTransferred();
         oneResult.mEvaluation.mNumCorrect = 1;  // timing tests always succeed trivially
 
-        for (unsigned int i = iterations; i > 0; --i)
+        // The budget covers recording and warmup as well as the timed iterations
+        StopWatch watch;
+        oneResult.mPrepareSpan.begin();
+        test.record(kernel);
+        oneResult.mPrepareSpan.end();
+        oneResult.mSetupTime = watch.getSplitTime();
+
+        for (unsigned int i = 0; i < plan.mWarmupIterations + timedIterations; ++i)
         {
-            test.prepare();
-            oneResult.mExecutionTime = test.run(kernel);
+            oneResult.mIsWarmup = (i < plan.mWarmupIterations);
+
+            oneResult.mRunSpan.begin();
+            oneResult.mExecutionTime = test.replay(kernel);
+            oneResult.mRunSpan.end();
 
             results.push_back(oneResult);
+
+            // setup is reported once, with the first iteration
+            oneResult.mSetupTime = StopWatch::duration(0);
+            oneResult.mPrepareSpan = TimeSpan();
+
+            if (!adaptive.mIsEnabled) {
+                continue;
+            }
+
+            if (!oneResult.mIsWarmup) {
+                const auto& timestamps = oneResult.mExecutionTime.timestamps;
+                samples.add(0 != timestamps.execution
+                            ? vulkan_utils::timestamp_delta_ns(timestamps.host_barrier,
+                                                               timestamps.execution,
+                                                               deviceProperties,
+                                                               queueFamilyProperties)
+                            : std::chrono::duration<double, std::nano>(oneResult.mExecutionTime.cpu_duration).count());
+
+                const double halfWidth = test_statistics::confidenceHalfWidth(samples.getStdDeviation(), samples.getCount(), 0.95);
+                if (samples.getCount() >= std::max(adaptive.mMinIterations, 2u)
+                    && halfWidth <= adaptive.mTargetRelativeConfidence * samples.getMean()) {
+                    stop = TimingStop::kConverged;
+                    break;
+                }
+            }
+
+            // Checked on every iteration, so that the budget can cut a long warmup short too
+            if (watch.getSplitTime() >= adaptive.mBudget) {
+                stop = TimingStop::kBudget;
+                break;
+            }
+        }
+
+        for (auto& r : results) {
+            r.mTimingStop = stop;
         }
 
         return results;
     }
 
+    const char* to_string(TimingStop stop)
+    {
+        switch (stop) {
+            case TimingStop::kIterations:       return "iterations";
+            case TimingStop::kConverged:        return "converged";
+            case TimingStop::kMaxIterations:    return "max-iterations";
+            case TimingStop::kBudget:           return "budget";
+        }
+        return "unknown";
+    }
+
+    bool is_met(const TimingExpectation& expectation, double value)
+    {
+        switch (expectation.mRelation) {
+            case TimingExpectation::relation::kLess:            return value < expectation.mLimit;
+            case TimingExpectation::relation::kLessEqual:       return value <= expectation.mLimit;
+            case TimingExpectation::relation::kGreater:         return value > expectation.mLimit;
+            case TimingExpectation::relation::kGreaterEqual:    return value >= expectation.mLimit;
+        }
+        return false;
+    }
+
     Test::Test()
     {
 
@@ -267,6 +438,11 @@ namespace test_utils {
         return std::string();
     }
 
+    std::size_t Test::getBytesTransferred() const
+    {
+        return 0;
+    }
+
     void Test::prepare()
     {
 
@@ -277,4 +453,38 @@ namespace test_utils {
         return Evaluation();
     }
 
+    void Test::record(clspv_utils::kernel& kernel)
+    {
+
+    }
+
+    clspv_utils::execution_time_t Test::replay(clspv_utils::kernel& kernel)
+    {
+        prepare();
+        return run(kernel);
+    }
+
+    clspv_utils::execution_time_t run_dispatch(Dispatch&& dispatch)
+    {
+        return dispatch.mInvocation.run(dispatch.mNumWorkgroups);
+    }
+
+    clspv_utils::execution_time_t DispatchTest::run(clspv_utils::kernel& kernel)
+    {
+        return run_dispatch(createDispatch(kernel));
+    }
+
+    void DispatchTest::record(clspv_utils::kernel& kernel)
+    {
+        prepare();
+
+        mRecorded = createDispatch(kernel);
+        mRecorded.mInvocation.record(mRecorded.mNumWorkgroups);
+    }
+
+    clspv_utils::execution_time_t DispatchTest::replay(clspv_utils::kernel& kernel)
+    {
+        return mRecorded.mInvocation.replay();
+    }
+
 } // namespace test_utils
@@ -7,12 +7,15 @@
 
 #include "clspv_utils/invocation.hpp"
 #include "clspv_utils/kernel.hpp"
+#include "clspv_utils/module.hpp"
 #include "fp_utils.hpp"
 #include "gpu_types.hpp"
 #include "pixels.hpp"
+#include "vulkan_utils/memory_allocator.hpp"
 
 #include <vulkan/vulkan.hpp>
 
+#include <chrono>
 #include <cmath>
 #include <functional>
 #include <random>
@@ -115,6 +118,20 @@ namespace test_utils {
         clock::time_point   mStartTime;
     };
 
+    // Host interval on the steady clock, which is also the clock that invocations place their
+    // GPU events on. A span that was never closed is not valid.
+    struct TimeSpan
+    {
+        typedef std::chrono::steady_clock   clock;
+
+        clock::time_point   mBegin;
+        clock::time_point   mEnd;
+
+        void    begin() { mBegin = clock::now(); }
+        void    end() { mEnd = clock::now(); }
+        bool    isValid() const { return clock::time_point() != mBegin && clock::time_point() != mEnd; }
+    };
+
     struct Evaluation {
         bool                            mSkipped    = false;
         unsigned int                    mNumCorrect = 0;
@@ -124,13 +141,88 @@ namespace test_utils {
         Evaluation& operator+=(const Evaluation& other);
     };
 
+    // An invocation passes if it generates at least one correct value and no incorrect values
+    bool is_pass(const Evaluation& evaluation);
+
+    // "PASS", "FAIL", or "SKIP"
+    const char* to_string(const Evaluation& evaluation);
+
+    // e.g. "32x1x1", as logs and results files show workgroup sizes
+    std::string workgroup_size_string(const vk::Extent3D& workgroupSize);
+
+    // Why a timing run stopped taking iterations
+    enum class TimingStop {
+        kIterations,        // ran its fixed number of iterations
+        kConverged,         // adaptive: the confidence interval of the mean became narrow enough
+        kMaxIterations,     // adaptive: reached the most iterations allowed
+        kBudget             // adaptive: ran out of time
+    };
+
+    const char* to_string(TimingStop stop);
+
+    // A timing run with an adaptive iteration count stops once it has taken at least
+    // mMinIterations and the 95% confidence interval of its mean time is within
+    // mTargetRelativeConfidence of the mean (either way). It also stops after mMaxIterations, or
+    // once mBudget has elapsed, whichever comes first. The time is the GPU execution time where
+    // the queue has timestamps, and the wall clock time otherwise.
+    struct AdaptiveTiming {
+        bool                            mIsEnabled                  = false;
+        unsigned int                    mMinIterations              = 10;
+        unsigned int                    mMaxIterations              = 1000;
+        double                          mTargetRelativeConfidence   = 0.02;
+        std::chrono::duration<double>   mBudget                     = std::chrono::seconds(10);
+    };
+
+    // A performance budget on the timed iterations of a timing run, such as "p99 < 1.5ms". A
+    // statistic of the per-iteration times (or rates) is compared with mLimit. Times are the
+    // GPU execution time where the queue has timestamps, and the wall clock time otherwise; rates
+    // are the bytes the test reports transferring, divided by that time.
+    struct TimingExpectation {
+        enum class measure {
+            kTime,          // seconds
+            kRate           // bytes per second
+        };
+
+        enum class relation {
+            kLess,
+            kLessEqual,
+            kGreater,
+            kGreaterEqual
+        };
+
+        measure         mMeasure    = measure::kTime;
+        bool            mUseMean    = false;    // otherwise the mQuantile quantile
+        double          mQuantile   = 0.5;
+        relation        mRelation   = relation::kLess;
+        double          mLimit      = 0.0;
+        std::string     mText;                  // as written in the manifest, for logs
+    };
+
+    bool is_met(const TimingExpectation& expectation, double value);
+
+    struct TimingPlan {
+        unsigned int    mWarmupIterations   = 0;    // run first, and left out of statistics
+        unsigned int    mIterations         = 0;    // timed iterations, unless adaptive
+        AdaptiveTiming  mAdaptive;
+    };
+
     struct InvocationResult {
-        InvocationResult() : mEvalTime(0.0) {}
+        InvocationResult() : mEvalTime(0.0), mSetupTime(0.0) {}
 
         std::string                     mParameters;
+        std::size_t                     mBytesTransferred = 0;  // per run; zero if the test doesn't say
         clspv_utils::execution_time_t   mExecutionTime;
         Evaluation                      mEvaluation;
         std::chrono::duration<double>   mEvalTime;
+        std::chrono::duration<double>   mSetupTime;     // one-time cost of recording a timing run
+        bool                            mIsWarmup = false;  // timing iteration excluded from statistics
+        TimingStop                      mTimingStop = TimingStop::kIterations;
+
+        // Host phases of the invocation. For timing runs, prepare covers recording, and only the
+        // first iteration has it; evaluate is never valid.
+        TimeSpan                        mPrepareSpan;
+        TimeSpan                        mRunSpan;
+        TimeSpan                        mEvaluateSpan;
     };
 
     struct InvocationTest {
@@ -145,14 +237,24 @@ namespace test_utils {
         typedef std::vector<InvocationResult> (time_fn_signature)(
                                                      clspv_utils::kernel&             kernel,
                                                      const std::vector<std::string>&  args,
-                                                     unsigned int                     iterations,
+                                                     const TimingPlan&                plan,
                                                      bool                             verbose);
 
         typedef std::function<time_fn_signature> time_fn;
 
-        std::string mVariation;
-        test_fn     mTestFn;
-        time_fn     mTimeFn;
+        // The local array sizes the test passes to the kernel, in argument order, for the given
+        // workgroup size and test arguments. They are spec constants of the kernel's pipeline, so
+        // the module prebuilds a pipeline for them. Tests that pass none leave this empty.
+        typedef std::vector<std::uint32_t> (local_array_sizes_fn_signature)(
+                                                     const vk::Extent3D&              workgroupSize,
+                                                     const std::vector<std::string>&  args);
+
+        typedef std::function<local_array_sizes_fn_signature> local_array_sizes_fn;
+
+        std::string             mVariation;
+        test_fn                 mTestFn;
+        time_fn                 mTimeFn;
+        local_array_sizes_fn    mLocalArraySizesFn;
     };
 
     struct KernelResult {
@@ -162,6 +264,11 @@ namespace test_utils {
         bool			mCompiledCorrectly	= false;
         std::string     mExceptionString;
         results         mInvocationResults;
+
+        clspv_utils::kernel::pipeline_stats_t   mPipelineStats;     // pipeline lookups across the kernel test
+
+        TimeSpan        mSpan;              // the whole kernel test
+        TimeSpan        mConstructSpan;     // creating the kernel
     };
 
     struct KernelTest {
@@ -172,9 +279,16 @@ namespace test_utils {
         std::string         mEntryName;
         vk::Extent3D        mWorkgroupSize;
         test_arguments      mArguments;
-        unsigned int        mTimingIterations   = 0;
+        unsigned int        mTimingIterations   = 0;        // the most taken, if adaptive
+        unsigned int        mWarmupIterations   = 0;        // run before the timed iterations
+        AdaptiveTiming      mAdaptiveTiming;
+        bool                mRejectOutliers     = false;    // drop IQR outliers from the timing statistics
+        std::vector<TimingExpectation>  mExpectations;          // checked against the timed iterations
         bool                mIsVerbose          = false;
         invocation_tests    mInvocationTests;
+
+        // Default placement of the buffers the test creates
+        vulkan_utils::memory_allocator::placement   mBufferPlacement    = vulkan_utils::memory_allocator::kPlacement_Dynamic;
     };
 
     struct ModuleResult {
@@ -184,6 +298,13 @@ namespace test_utils {
         bool                        mLoadedCorrectly    = false;
         std::vector<std::string>    mUntestedEntryPoints;
         results                     mKernelResults;
+
+        std::vector<clspv_utils::pipeline_build_result_t>   mPipelineBuildResults;
+        clspv_utils::pipeline_cache_status                  mPipelineCacheStatus = clspv_utils::pipeline_cache_status::kNotPersisted;
+
+        TimeSpan                    mSpan;          // the whole module test
+        TimeSpan                    mLoadSpan;      // reading the spvmap and spv, creating the module
+        TimeSpan                    mPrebuildSpan;  // compiling the pipelines the tests need
     };
 
     struct ModuleTest {
@@ -200,9 +321,41 @@ namespace test_utils {
         virtual ~Test();
 
         virtual std::string getParameterString() const;
+        // Bytes each run reads and writes, for reporting rates; zero if not known
+        virtual std::size_t getBytesTransferred() const;
         virtual void        prepare();
         virtual clspv_utils::execution_time_t   run(clspv_utils::kernel& kernel) = 0;
         virtual Evaluation  evaluate(bool verbose);
+
+        // Timing runs call record once and then replay for each iteration. By default, record
+        // does nothing and replay prepares and runs the test. Tests whose invocation does not
+        // change between iterations override both, recording the invocation once and
+        // resubmitting it, so that the measurement is not dominated by per-run CPU setup.
+        virtual void        record(clspv_utils::kernel& kernel);
+        virtual clspv_utils::execution_time_t   replay(clspv_utils::kernel& kernel);
+    };
+
+    // A kernel invocation, with its arguments added, and the workgroups to dispatch it over
+    struct Dispatch {
+        clspv_utils::invocation mInvocation;
+        vk::Extent3D            mNumWorkgroups;
+    };
+
+    clspv_utils::execution_time_t run_dispatch(Dispatch&& dispatch);
+
+    // A test whose run is a single dispatch of its kernel. Timing runs record the dispatch once
+    // and replay it for each iteration, so that the arguments stay bound across iterations.
+    class DispatchTest : public Test {
+    public:
+        virtual clspv_utils::execution_time_t   run(clspv_utils::kernel& kernel) override;
+        virtual void        record(clspv_utils::kernel& kernel) override;
+        virtual clspv_utils::execution_time_t   replay(clspv_utils::kernel& kernel) override;
+
+    protected:
+        virtual Dispatch    createDispatch(clspv_utils::kernel& kernel) = 0;
+
+    private:
+        Dispatch            mRecorded;
     };
 
     template<typename T>
@@ -333,9 +486,11 @@ namespace test_utils {
                               bool                              verbose,
                               Test&                             test);
 
+    // Warmup iterations come first in the results, marked as such. Every result records why the
+    // run stopped.
     std::vector<InvocationResult> time_test(clspv_utils::kernel&             kernel,
                                             const std::vector<std::string>&  args,
-                                            unsigned int                     iterations,
+                                            const TimingPlan&                plan,
                                             bool                             verbose,
                                             Test&                            test);
 
@@ -368,17 +523,18 @@ namespace test_utils {
     template <typename Test>
     std::vector<InvocationResult> time_test(clspv_utils::kernel&             kernel,
                                             const std::vector<std::string>&  args,
-                                            unsigned int                     iterations,
+                                            const TimingPlan&                plan,
                                             bool                             verbose)
     {
         Test test(kernel, args);
-        return time_test(kernel, args, iterations, verbose, test);
+        return time_test(kernel, args, plan, verbose, test);
     }
 
     template <typename Test>
-    InvocationTest make_invocation_test(std::string variation)
+    InvocationTest make_invocation_test(std::string                         variation,
+                                        InvocationTest::local_array_sizes_fn localArraySizes = InvocationTest::local_array_sizes_fn())
     {
-        return InvocationTest{ variation, run_test<Test>, time_test<Test> };
+        return InvocationTest{ variation, run_test<Test>, time_test<Test>, localArraySizes };
     }
 
     KernelTest::result test_kernel(clspv_utils::module& module,
@@ -127,6 +127,17 @@ namespace android_utils {
         return funopen(asset, android_read, android_write, android_seek, android_close);
     }
 
+    std::string get_pipeline_cache_directory() {
+        assert(Android_application != nullptr);
+        const char* dataPath = Android_application->activity->internalDataPath;
+        return (dataPath ? dataPath : "");
+    }
+
+    std::string get_output_directory() {
+        // The same private directory; pull files with "adb shell run-as <package> cat <file>"
+        return get_pipeline_cache_directory();
+    }
+
     LogBuffer::LogBuffer(android_LogPriority priority) {
         priority_ = priority;
         this->setp(buffer_, buffer_ + kBufferSize - 1);
@@ -29,8 +29,12 @@
 
 #include <vulkan/vulkan.hpp>
 
+#if defined(__ANDROID__)
 #include <android/asset_manager.h>
 #include <android/log.h>
+#else
+#include <cstdio>
+#endif
 
 #include <boost/iostreams/categories.hpp>
 #include <boost/iostreams/positioning.hpp>
@@ -63,6 +67,7 @@ struct sample_info {
     PFN_vkGetPhysicalDeviceFeatures2KHR getPhysicalDeviceFeatures2KHR   = nullptr;
 
     std::vector<const char *>           device_extension_names;
+    vk::PhysicalDeviceFeatures          enabled_device_features;
     vk::PhysicalDevice                  gpu;
     vk::UniqueDevice                    device;
     vk::Queue                           graphics_queue;
@@ -72,7 +77,6 @@ struct sample_info {
 
     vk::PhysicalDeviceProperties        physical_device_properties;
     vk::UniqueCommandPool               cmd_pool;
-    vk::UniqueDescriptorPool            desc_pool;
 
     std::vector<vk::UniqueDebugReportCallbackEXT> debug_report_callbacks;
 };
@@ -80,6 +84,8 @@ struct sample_info {
 // Main entry point of samples
 int sample_main(int argc, char *argv[]);
 
+#if defined(__ANDROID__)
+
 // Android specific definitions & helpers.
 #define LOG(LEVEL, ...) ((void)__android_log_print(ANDROID_LOG_##LEVEL, "VK-SAMPLE", __VA_ARGS__))
 #define LOGD(...) LOG(DEBUG, __VA_ARGS__)
@@ -92,9 +98,30 @@ int sample_main(int argc, char *argv[]);
 bool Android_process_command();
 ANativeWindow* AndroidGetApplicationWindow();
 
+#else
+
+// Host definitions & helpers. Informational output goes to stdout so that it can be captured
+// by whatever harness launched the runner; warnings and errors go to stderr.
+#define LOG(STREAM, LEVEL, ...) ((void)std::fprintf(STREAM, LEVEL __VA_ARGS__), (void)std::fputc('\n', STREAM))
+#define LOGD(...) LOG(stdout, "D ", __VA_ARGS__)
+#define LOGI(...) LOG(stdout, "I ", __VA_ARGS__)
+#define LOGW(...) LOG(stderr, "W ", __VA_ARGS__)
+#define LOGE(...) LOG(stderr, "E ", __VA_ARGS__)
+
+#endif
+
 namespace android_utils {
     FILE* asset_fopen(const char* fname, const char* mode);
 
+    // Writable directory in which pipeline caches persist between runs. Empty if caches should
+    // not persist.
+    std::string get_pipeline_cache_directory();
+
+    // Writable directory in which result files, such as traces, are written. Empty for the
+    // current directory.
+    std::string get_output_directory();
+
+#if defined(__ANDROID__)
     // Helpder class to forward the cout/cerr output to logcat derived from:
     // http://stackoverflow.com/questions/8870174/is-stdcout-usable-in-android-ndk
     class LogBuffer : public std::streambuf {
@@ -112,6 +139,15 @@ namespace android_utils {
         android_LogPriority priority_ = ANDROID_LOG_INFO;
         char                buffer_[kBufferSize];
     };
+#else
+    // On the host, "assets" are plain files found relative to an asset root directory (by
+    // default, the current working directory).
+    void                set_asset_root(const std::string& root);
+    const std::string&  get_asset_root();
+
+    void                set_pipeline_cache_directory(const std::string& directory);
+    void                set_output_directory(const std::string& directory);
+#endif
 
     class AssetSource {
     public:
@@ -156,7 +192,11 @@ namespace android_utils {
         void close();
 
     private:
+#if defined(__ANDROID__)
         std::shared_ptr<AAsset> mAsset;
+#else
+        std::shared_ptr<FILE>   mAsset;
+#endif
     };
 
     typedef boost::iostreams::stream<AssetSource> iassetstream;
@@ -0,0 +1,158 @@
+/*
+ * Host (non-Android) counterparts of the helpers in util.cpp. The host runner reads its manifest,
+ * .spv, and .spvmap files from a directory on the filesystem rather than from the APK's assets,
+ * and sends log output to stdout/stderr rather than to logcat.
+ */
+
+#include "util.hpp"
+
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    std::string gAssetRoot;
+    std::string gPipelineCacheDirectory;
+    std::string gOutputDirectory;
+
+    std::string asset_path(const char* path) {
+        if (gAssetRoot.empty() || path[0] == '/') {
+            return path;
+        }
+
+        return gAssetRoot + '/' + path;
+    }
+
+    void print_usage(const char* program) {
+        std::fprintf(stderr,
+                     "usage: %s [--assets <dir>] [--pipeline-cache <dir>] [--output <dir>] [manifest]\n"
+                     "  --assets <dir>   directory containing the manifest and the shaders_cl/shaders\n"
+                     "                   module directories (default: current directory)\n"
+                     "  --pipeline-cache <dir>\n"
+                     "                   directory in which compiled pipelines persist between runs\n"
+                     "                   (default: pipelines are not persisted)\n"
+                     "  --output <dir>   directory in which result files, such as traces, are written\n"
+                     "                   (default: current directory)\n"
+                     "  manifest         manifest file, relative to the asset directory\n"
+                     "                   (default: test_manifest.txt)\n",
+                     program);
+    }
+}
+
+namespace android_utils {
+
+    void set_asset_root(const std::string& root) {
+        gAssetRoot = root;
+        while (gAssetRoot.size() > 1 && gAssetRoot.back() == '/') {
+            gAssetRoot.pop_back();
+        }
+    }
+
+    const std::string& get_asset_root() {
+        return gAssetRoot;
+    }
+
+    void set_pipeline_cache_directory(const std::string& directory) {
+        gPipelineCacheDirectory = directory;
+    }
+
+    std::string get_pipeline_cache_directory() {
+        return gPipelineCacheDirectory;
+    }
+
+    void set_output_directory(const std::string& directory) {
+        gOutputDirectory = directory;
+    }
+
+    std::string get_output_directory() {
+        return gOutputDirectory;
+    }
+
+    FILE* asset_fopen(const char *fname, const char *mode) {
+        if (mode[0] == 'w') {
+            return NULL;
+        }
+
+        return std::fopen(asset_path(fname).c_str(), mode);
+    }
+
+    AssetSource::AssetSource(const AssetSource &other) :
+            mAsset(other.mAsset) {
+
+    }
+
+    void AssetSource::open(const char *path, std::ios::openmode mode) {
+        if (mode & (std::ios::out | std::ios::trunc))
+            throw std::runtime_error("invalid mode");
+
+        FILE* asset = std::fopen(asset_path(path).c_str(), "rb");
+        if (!asset) {
+            throw std::runtime_error("asset not found");
+        }
+
+        mAsset.reset(asset, &std::fclose);
+    }
+
+    std::streamsize AssetSource::read(char_type *s, std::streamsize n) {
+        const std::size_t numRead = std::fread(s, 1, n, mAsset.get());
+        return (0 == numRead && std::feof(mAsset.get()) ? -1 : numRead);
+    }
+
+    std::streampos AssetSource::seek(boost::iostreams::stream_offset off,
+                                     std::ios_base::seekdir way) {
+        const int whence = (way == std::ios_base::beg ? SEEK_SET
+                                                      : (way == std::ios_base::cur ? SEEK_CUR : SEEK_END));
+        if (0 != std::fseek(mAsset.get(), off, whence)) {
+            throw std::ios_base::failure("bad seek");
+        }
+        return std::ftell(mAsset.get());
+    }
+
+    void AssetSource::close() {
+        mAsset.reset();
+    }
+
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<char*> sampleArgs = { argv[0] };
+
+    for (int i = 1; i < argc; ++i) {
+        if (0 == std::strcmp(argv[i], "--assets") && i + 1 < argc) {
+            android_utils::set_asset_root(argv[++i]);
+        }
+        else if (0 == std::strcmp(argv[i], "--pipeline-cache") && i + 1 < argc) {
+            android_utils::set_pipeline_cache_directory(argv[++i]);
+        }
+        else if (0 == std::strcmp(argv[i], "--output") && i + 1 < argc) {
+            android_utils::set_output_directory(argv[++i]);
+        }
+        else if (0 == std::strcmp(argv[i], "--help") || 0 == std::strcmp(argv[i], "-h")) {
+            print_usage(argv[0]);
+            return EXIT_SUCCESS;
+        }
+        else if (argv[i][0] == '-' || sampleArgs.size() > 1) {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        else {
+            sampleArgs.push_back(argv[i]);
+        }
+    }
+
+    int result = EXIT_FAILURE;
+    try {
+        result = sample_main(static_cast<int>(sampleArgs.size()), sampleArgs.data());
+    }
+    catch (const std::exception& e) {
+        LOGE("%s: %s", argv[0], e.what());
+    }
+
+    std::fflush(stdout);
+    return result;
+}
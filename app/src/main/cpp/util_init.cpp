@@ -70,6 +70,8 @@ bool demo_check_layers(const std::vector<layer_properties> &layer_props, const s
 }
 
 void init_instance(struct sample_info &info, char const *const app_short_name) {
+    // Always needed, to look for a device with the variablePointers feature; heap budgets,
+    // calibrated timestamps, and external memory depend on it too
     info.instance_extension_names.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
 
     vk::ApplicationInfo app_info;
@@ -99,8 +101,32 @@ void init_device(struct sample_info &info) {
             .setPQueuePriorities(queue_priorities)
             .setQueueFamilyIndex(info.graphics_queue_family_index);
 
+    // Pipeline statistics are optional; invocations go without them where unsupported
     vk::PhysicalDeviceFeatures device_features;
-    device_features.setShaderStorageImageWriteWithoutFormat(true);
+    device_features.setShaderStorageImageWriteWithoutFormat(true)
+            .setPipelineStatisticsQuery(info.gpu.getFeatures().pipelineStatisticsQuery);
+
+#ifdef VK_EXT_host_query_reset
+    // Query rings reset recycled queries from the host, if the device has the feature. The
+    // extension is no use without it.
+    vk::PhysicalDeviceHostQueryResetFeaturesEXT host_query_reset_features;
+    auto host_query_reset = std::find_if(info.device_extension_names.begin(), info.device_extension_names.end(),
+                                         [](const char* name) {
+                                             return 0 == strcmp(name, VK_EXT_HOST_QUERY_RESET_EXTENSION_NAME);
+                                         });
+    if (host_query_reset != info.device_extension_names.end()) {
+        vk::StructureChain<vk::PhysicalDeviceFeatures2KHR, vk::PhysicalDeviceHostQueryResetFeaturesEXT> structureChain;
+        vk::PhysicalDeviceFeatures2KHR& features = structureChain.get<vk::PhysicalDeviceFeatures2KHR>();
+        info.getPhysicalDeviceFeatures2KHR((VkPhysicalDevice)info.gpu, reinterpret_cast<VkPhysicalDeviceFeatures2KHR*>(&features));
+
+        if (structureChain.get<vk::PhysicalDeviceHostQueryResetFeaturesEXT>().hostQueryReset) {
+            host_query_reset_features.setHostQueryReset(true);
+        }
+        else {
+            info.device_extension_names.erase(host_query_reset);
+        }
+    }
+#endif
 
     vk::DeviceCreateInfo device_info;
     device_info.setQueueCreateInfoCount(1)
@@ -108,8 +134,14 @@ void init_device(struct sample_info &info) {
             .setEnabledExtensionCount(info.device_extension_names.size())
             .setPpEnabledExtensionNames(info.device_extension_names.size() ? info.device_extension_names.data() : NULL)
             .setPEnabledFeatures(&device_features);
+#ifdef VK_EXT_host_query_reset
+    if (host_query_reset_features.hostQueryReset) {
+        device_info.setPNext(&host_query_reset_features);
+    }
+#endif
 
     info.device = info.gpu.createDeviceUnique(device_info);
+    info.enabled_device_features = device_features;
 }
 
 void init_enumerate_device(struct sample_info &info) {
@@ -0,0 +1,561 @@
+#include "memory_allocator.hpp"
+
+#include "vulkan_utils.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+    const vk::DeviceSize kDefaultBlockSize  = 32 * 1024 * 1024;
+    const vk::DeviceSize kMinBlockSize      = 1024 * 1024;
+
+    vk::DeviceSize align_up(vk::DeviceSize value, vk::DeviceSize alignment)
+    {
+        return (alignment > 1 ? ((value + alignment - 1) / alignment) * alignment : value);
+    }
+
+    vk::DeviceSize align_down(vk::DeviceSize value, vk::DeviceSize alignment)
+    {
+        return (alignment > 1 ? (value / alignment) * alignment : value);
+    }
+
+    void fail_runtime_error(const char* what)
+    {
+        throw std::runtime_error(what);
+    }
+
+} // anonymous namespace
+
+namespace vulkan_utils {
+
+    memory_allocator::memory_allocator(vk::Device                                   device,
+                                       const vk::PhysicalDeviceMemoryProperties&    memoryProperties,
+                                       const vk::PhysicalDeviceLimits&              limits)
+            : mDevice(device),
+              mMemoryProperties(memoryProperties),
+              mBufferImageGranularity(std::max<vk::DeviceSize>(1, limits.bufferImageGranularity)),
+              mNonCoherentAtomSize(std::max<vk::DeviceSize>(1, limits.nonCoherentAtomSize))
+    {
+        mHeapBytes.fill(0);
+    }
+
+    memory_allocator::allocation memory_allocator::allocate(const vk::MemoryRequirements& requirements,
+                                                            vk::MemoryPropertyFlags       properties,
+                                                            resource_kind                 kind)
+    {
+        return allocate(requirements, type_preference(properties), kind);
+    }
+
+    memory_allocator::allocation memory_allocator::allocate(const vk::MemoryRequirements& requirements,
+                                                            placement                     where,
+                                                            resource_kind                 kind)
+    {
+        typedef vk::MemoryPropertyFlagBits bits;
+
+        if (kPlacement_Default == where) {
+            where = mDefaultPlacement;
+        }
+
+        type_preference preference;
+        switch (where) {
+            case kPlacement_Upload:
+                // Device-local host-visible memory (e.g. a resizable BAR) saves the device a trip
+                // across the bus. Uncached memory is write-combined on most hosts, which suits
+                // data the host only writes.
+                preference.mRequired = bits::eHostVisible;
+                preference.mPreferred = bits::eDeviceLocal | bits::eHostCoherent;
+                preference.mUndesired = bits::eHostCached;
+                break;
+
+            case kPlacement_GpuOnly:
+                // Leave host-visible device memory, often a scarce heap, to the placements that map it
+                preference.mPreferred = bits::eDeviceLocal;
+                preference.mUndesired = bits::eHostVisible;
+                break;
+
+            case kPlacement_Dynamic:
+            case kPlacement_Readback:
+            default:
+                preference.mRequired = bits::eHostVisible;
+                preference.mPreferred = bits::eHostCached;
+                break;
+        }
+
+        return allocate(requirements, preference, kind);
+    }
+
+    memory_allocator::allocation memory_allocator::allocate(const vk::MemoryRequirements& requirements,
+                                                            const type_preference&        preference,
+                                                            resource_kind                 kind)
+    {
+        const auto candidates = rank_memory_types(mMemoryProperties,
+                                                  requirements.memoryTypeBits,
+                                                  preference.mRequired,
+                                                  preference.mPreferred,
+                                                  preference.mUndesired);
+
+        // Types whose heap has room under its budget come first, in rank order. Over-budget heaps
+        // are a last resort: the driver may still oblige, at the risk of paging.
+        for (int pass = 0; pass < 2; ++pass) {
+            const bool wantWithinBudget = (0 == pass);
+
+            for (auto typeIndex : candidates) {
+                const std::uint32_t heapIndex = mMemoryProperties.memoryTypes[typeIndex].heapIndex;
+                if (isWithinBudget(heapIndex, requirements.size) != wantWithinBudget) {
+                    continue;
+                }
+
+                allocation result = allocateFromType(requirements, typeIndex, kind);
+                if (result) {
+                    if (typeIndex != candidates.front()) {
+                        ++mStats.mNumFallbacks;
+                    }
+                    return result;
+                }
+            }
+        }
+
+        return allocation();
+    }
+
+    memory_allocator::allocation memory_allocator::allocateFromType(const vk::MemoryRequirements& resourceRequirements,
+                                                                    std::uint32_t                 typeIndex,
+                                                                    resource_kind                 kind)
+    {
+        // Ranges of non-coherent host memory occupy whole atoms, so that flushing or invalidating
+        // one range can never clobber host writes to its neighbour.
+        vk::MemoryRequirements requirements = resourceRequirements;
+        const auto typeFlags = mMemoryProperties.memoryTypes[typeIndex].propertyFlags;
+        if ((typeFlags & vk::MemoryPropertyFlagBits::eHostVisible) && !(typeFlags & vk::MemoryPropertyFlagBits::eHostCoherent)) {
+            requirements.alignment = std::max(requirements.alignment, mNonCoherentAtomSize);
+            requirements.size = align_up(requirements.size, mNonCoherentAtomSize);
+        }
+
+        // With a granularity of 1, linear and optimal resources may sit side by side
+        const pool_key pool(typeIndex, (mBufferImageGranularity > 1 ? kind : kResource_Linear));
+        const std::uint32_t heapIndex = mMemoryProperties.memoryTypes[typeIndex].heapIndex;
+        const vk::DeviceSize blockSize = getBlockSize(typeIndex);
+
+        bool isDedicated = (requirements.size > blockSize / 2);
+
+        vk::DeviceSize offset = 0;
+        auto found = mBlocks.end();
+
+        if (!isDedicated) {
+            for (auto b = mBlocks.begin(); b != mBlocks.end(); ++b) {
+                if (b->second->mPool == pool
+                    && !b->second->mIsDedicated
+                    && tryAllocate(*b->second, requirements, offset)) {
+                    found = b;
+                    break;
+                }
+            }
+        }
+
+        if (found == mBlocks.end()) {
+            // A whole block would overrun the heap's budget; take just what this resource needs
+            if (!isDedicated && !isWithinBudget(heapIndex, blockSize)) {
+                isDedicated = true;
+            }
+
+            found = createBlock(pool, (isDedicated ? requirements.size : blockSize), isDedicated);
+            if (found == mBlocks.end() && !isDedicated) {
+                isDedicated = true;
+                found = createBlock(pool, requirements.size, isDedicated);
+            }
+            if (found == mBlocks.end()) {
+                return allocation();
+            }
+
+            if (!tryAllocate(*found->second, requirements, offset)) {
+                fail_runtime_error("new memory block cannot satisfy allocation");
+            }
+        }
+
+        return commitAllocation(found, offset, requirements.size);
+    }
+
+    memory_allocator::allocation memory_allocator::importHostPointer(const vk::MemoryRequirements& requirements,
+                                                                     void*                         hostPointer,
+                                                                     vk::DeviceSize                size)
+    {
+        // The import covers exactly the caller's memory; padding it out could reach past the end
+        if (!canImportHostPointer(hostPointer) || 0 == size || 0 != size % mHostImportAlignment) {
+            return allocation();
+        }
+
+        if (requirements.size > size) {
+            return allocation();
+        }
+
+        VkMemoryHostPointerPropertiesEXT hostPointerProperties = {};
+        hostPointerProperties.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+        if (VK_SUCCESS != mGetMemoryHostPointerProperties(static_cast<VkDevice>(mDevice),
+                                                          VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT,
+                                                          hostPointer,
+                                                          &hostPointerProperties)) {
+            return allocation();
+        }
+
+        const auto candidates = rank_memory_types(mMemoryProperties,
+                                                  requirements.memoryTypeBits & hostPointerProperties.memoryTypeBits,
+                                                  vk::MemoryPropertyFlags(),
+                                                  vk::MemoryPropertyFlagBits::eHostCoherent,
+                                                  vk::MemoryPropertyFlags());
+        if (candidates.empty()) {
+            return allocation();
+        }
+
+        const std::uint32_t typeIndex = candidates.front();
+        vk::ImportMemoryHostPointerInfoEXT importInfo(vk::ExternalMemoryHandleTypeFlagBits::eHostAllocationEXT, hostPointer);
+
+        auto found = createBlock(pool_key(typeIndex, kResource_Linear), size, true, &importInfo);
+        if (found == mBlocks.end()) {
+            return allocation();
+        }
+
+        block& b = *found->second;
+        b.mIsImported = true;
+
+        vk::DeviceSize offset = 0;
+        if (!tryAllocate(b, requirements, offset)) {
+            fail_runtime_error("imported memory cannot satisfy allocation");
+        }
+
+        // The host reaches the memory through its own pointer. Only non-coherent memory needs a
+        // mapping of ours, because ranges can only be flushed through one.
+        const auto typeFlags = mMemoryProperties.memoryTypes[typeIndex].propertyFlags;
+        if ((typeFlags & vk::MemoryPropertyFlagBits::eHostVisible) && !(typeFlags & vk::MemoryPropertyFlagBits::eHostCoherent)) {
+            b.mMapped = mDevice.mapMemory(*b.mMemory, 0, VK_WHOLE_SIZE, vk::MemoryMapFlags());
+        }
+        else {
+            b.mMapped = hostPointer;
+        }
+
+        ++mStats.mNumImports;
+
+        return commitAllocation(found, offset, requirements.size);
+    }
+
+    void memory_allocator::setHostImport(PFN_vkGetMemoryHostPointerPropertiesEXT getMemoryHostPointerProperties,
+                                         vk::DeviceSize                          minImportedHostPointerAlignment)
+    {
+        mGetMemoryHostPointerProperties = getMemoryHostPointerProperties;
+        mHostImportAlignment = (getMemoryHostPointerProperties ? std::max<vk::DeviceSize>(1, minImportedHostPointerAlignment) : 0);
+    }
+
+    bool memory_allocator::canImportHostPointer(const void* hostPointer) const
+    {
+        return supportsHostImport()
+               && hostPointer
+               && 0 == (reinterpret_cast<std::uintptr_t>(hostPointer) % mHostImportAlignment);
+    }
+
+    memory_allocator::allocation memory_allocator::commitAllocation(block_map::iterator found,
+                                                                    vk::DeviceSize      offset,
+                                                                    vk::DeviceSize      size)
+    {
+        block& b = *found->second;
+        ++b.mNumAllocations;
+
+        allocation result;
+        result.mMemory = *b.mMemory;
+        result.mOffset = offset;
+        result.mSize = size;
+        result.mMemoryTypeIndex = b.mPool.first;
+        result.mBlockId = found->first;
+
+        ++mStats.mNumAllocations;
+        ++mStats.mNumOutstanding;
+        mStats.mBytesInUse += size;
+        mStats.mPeakBytesInUse = std::max(mStats.mPeakBytesInUse, mStats.mBytesInUse);
+
+        return result;
+    }
+
+    void memory_allocator::setBudgetQuery(budget_query query)
+    {
+        mBudgetQuery = query;
+        updateBudgets();
+    }
+
+    memory_allocator::heap_budget memory_allocator::getHeapBudget(std::uint32_t heapIndex) const
+    {
+        heap_budget result;
+
+        if (mBudgetQuery) {
+            // The driver's usage covers every allocation in the process, but may lag behind ours
+            result = mHeapBudgets[heapIndex];
+            result.mUsage = std::max(result.mUsage, mHeapBytes[heapIndex]);
+        }
+        else {
+            // Without VK_EXT_memory_budget, assume we may use most, but not all, of each heap
+            result.mBudget = mMemoryProperties.memoryHeaps[heapIndex].size / 10 * 8;
+            result.mUsage = mHeapBytes[heapIndex];
+        }
+
+        return result;
+    }
+
+    void memory_allocator::setDefaultPlacement(placement where)
+    {
+        mDefaultPlacement = (kPlacement_Default == where ? kPlacement_Dynamic : where);
+    }
+
+    void memory_allocator::free(const allocation& range)
+    {
+        if (!range) {
+            return;
+        }
+
+        auto found = mBlocks.find(range.mBlockId);
+        if (found == mBlocks.end()) {
+            fail_runtime_error("memory range does not belong to this allocator");
+        }
+
+        block& b = *found->second;
+
+        --b.mNumAllocations;
+        --mStats.mNumOutstanding;
+        mStats.mBytesInUse -= range.mSize;
+
+        if (0 == b.mNumAllocations) {
+            // Keep one empty shared block per pool around, to avoid churning the driver when a
+            // test repeatedly creates and destroys a single resource.
+            const bool isLastInPool = !b.mIsDedicated
+                                      && 1 == std::count_if(mBlocks.begin(), mBlocks.end(), [&b](block_map::const_reference other) {
+                                             return other.second->mPool == b.mPool && !other.second->mIsDedicated;
+                                         });
+            if (!isLastInPool) {
+                destroyBlock(found);
+                return;
+            }
+        }
+
+        // Return the range to the free list, merging it with the ranges on either side
+        vk::DeviceSize begin = range.mOffset;
+        vk::DeviceSize end = range.mOffset + range.mSize;
+
+        auto next = b.mFree.lower_bound(begin);
+        if (next != b.mFree.end() && next->first == end) {
+            end += next->second;
+            next = b.mFree.erase(next);
+        }
+
+        if (next != b.mFree.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == begin) {
+                begin = prev->first;
+                b.mFree.erase(prev);
+            }
+        }
+
+        b.mFree[begin] = end - begin;
+    }
+
+    void* memory_allocator::map(const allocation& range)
+    {
+        auto found = mBlocks.find(range.mBlockId);
+        if (found == mBlocks.end()) {
+            fail_runtime_error("memory range does not belong to this allocator");
+        }
+
+        block& b = *found->second;
+        if (!b.mMapped) {
+            b.mMapped = mDevice.mapMemory(*b.mMemory, 0, VK_WHOLE_SIZE, vk::MemoryMapFlags());
+        }
+
+        return static_cast<std::uint8_t*>(b.mMapped) + range.mOffset;
+    }
+
+    void memory_allocator::flush(const allocation& range, vk::DeviceSize offset, vk::DeviceSize size)
+    {
+        vk::MappedMemoryRange mappedRange;
+        if (getNonCoherentRange(range, offset, size, mappedRange)) {
+            mDevice.flushMappedMemoryRanges(mappedRange);
+            ++mStats.mNumFlushes;
+        }
+    }
+
+    void memory_allocator::invalidate(const allocation& range, vk::DeviceSize offset, vk::DeviceSize size)
+    {
+        vk::MappedMemoryRange mappedRange;
+        if (getNonCoherentRange(range, offset, size, mappedRange)) {
+            mDevice.invalidateMappedMemoryRanges(mappedRange);
+            ++mStats.mNumInvalidates;
+        }
+    }
+
+    bool memory_allocator::isHostCoherent(const allocation& range) const
+    {
+        const auto flags = mMemoryProperties.memoryTypes[range.mMemoryTypeIndex].propertyFlags;
+        return (bool) (flags & vk::MemoryPropertyFlagBits::eHostCoherent);
+    }
+
+    bool memory_allocator::isHostVisible(const allocation& range) const
+    {
+        const auto flags = mMemoryProperties.memoryTypes[range.mMemoryTypeIndex].propertyFlags;
+        return (bool) (flags & vk::MemoryPropertyFlagBits::eHostVisible);
+    }
+
+    double memory_allocator::getFragmentation() const
+    {
+        vk::DeviceSize totalFree = 0;
+        vk::DeviceSize largestFree = 0;
+
+        for (auto& b : mBlocks) {
+            for (auto& f : b.second->mFree) {
+                totalFree += f.second;
+                largestFree = std::max(largestFree, f.second);
+            }
+        }
+
+        return (totalFree > 0 ? 1.0 - (double) largestFree / (double) totalFree : 0.0);
+    }
+
+    vk::DeviceSize memory_allocator::getBlockSize(std::uint32_t memoryTypeIndex) const
+    {
+        // Small heaps get proportionally smaller blocks, so that one block cannot hog them
+        const auto& heap = mMemoryProperties.memoryHeaps[mMemoryProperties.memoryTypes[memoryTypeIndex].heapIndex];
+        return std::max(kMinBlockSize, std::min(kDefaultBlockSize, heap.size / 8));
+    }
+
+    memory_allocator::block_map::iterator memory_allocator::createBlock(const pool_key&   pool,
+                                                                        vk::DeviceSize    size,
+                                                                        bool              isDedicated,
+                                                                        const void*       allocateNext)
+    {
+        vk::MemoryAllocateInfo allocInfo;
+        allocInfo.setPNext(allocateNext)
+                .setAllocationSize(size)
+                .setMemoryTypeIndex(pool.first);
+
+        std::unique_ptr<block> newBlock(new block);
+        newBlock->mPool = pool;
+        newBlock->mSize = size;
+        newBlock->mIsDedicated = isDedicated;
+        newBlock->mFree[0] = size;
+
+        // Running out is not fatal: the caller may try a smaller block, or another memory type
+        try {
+            newBlock->mMemory = mDevice.allocateMemoryUnique(allocInfo);
+        }
+        catch (const vk::OutOfDeviceMemoryError&) {
+            ++mStats.mNumFailedBlocks;
+            return mBlocks.end();
+        }
+        catch (const vk::OutOfHostMemoryError&) {
+            ++mStats.mNumFailedBlocks;
+            return mBlocks.end();
+        }
+        catch (const vk::InvalidExternalHandleError&) {
+            // the host pointer could not be imported
+            ++mStats.mNumFailedBlocks;
+            return mBlocks.end();
+        }
+
+        ++mStats.mNumBlocks;
+        ++mStats.mNumBlocksCreated;
+        mStats.mBytesInBlocks += size;
+        mHeapBytes[mMemoryProperties.memoryTypes[pool.first].heapIndex] += size;
+        updateBudgets();
+
+        return mBlocks.insert(std::make_pair(mNextBlockId++, std::move(newBlock))).first;
+    }
+
+    void memory_allocator::destroyBlock(block_map::iterator found)
+    {
+        --mStats.mNumBlocks;
+        mStats.mBytesInBlocks -= found->second->mSize;
+        mHeapBytes[mMemoryProperties.memoryTypes[found->second->mPool.first].heapIndex] -= found->second->mSize;
+
+        // Freeing the memory implicitly unmaps it
+        mBlocks.erase(found);
+        updateBudgets();
+    }
+
+    void memory_allocator::updateBudgets()
+    {
+        if (mBudgetQuery) {
+            mBudgetQuery(mHeapBudgets);
+        }
+    }
+
+    bool memory_allocator::isWithinBudget(std::uint32_t heapIndex, vk::DeviceSize size) const
+    {
+        const heap_budget budget = getHeapBudget(heapIndex);
+        return budget.mUsage + size <= budget.mBudget;
+    }
+
+    bool memory_allocator::tryAllocate(block& b, const vk::MemoryRequirements& requirements, vk::DeviceSize& offset)
+    {
+        for (auto f = b.mFree.begin(); f != b.mFree.end(); ++f) {
+            const vk::DeviceSize rangeBegin = f->first;
+            const vk::DeviceSize rangeEnd = f->first + f->second;
+            const vk::DeviceSize alignedBegin = align_up(rangeBegin, std::max<vk::DeviceSize>(1, requirements.alignment));
+
+            if (alignedBegin + requirements.size > rangeEnd) {
+                continue;
+            }
+
+            // Split the free range around the allocation; alignment padding stays free
+            b.mFree.erase(f);
+            if (alignedBegin > rangeBegin) {
+                b.mFree[rangeBegin] = alignedBegin - rangeBegin;
+            }
+            if (alignedBegin + requirements.size < rangeEnd) {
+                b.mFree[alignedBegin + requirements.size] = rangeEnd - (alignedBegin + requirements.size);
+            }
+
+            offset = alignedBegin;
+            return true;
+        }
+
+        return false;
+    }
+
+    bool memory_allocator::getNonCoherentRange(const allocation&        range,
+                                               vk::DeviceSize           offset,
+                                               vk::DeviceSize           size,
+                                               vk::MappedMemoryRange&   result) const
+    {
+        if (!range || isHostCoherent(range)) {
+            return false;
+        }
+
+        auto found = mBlocks.find(range.mBlockId);
+        if (found == mBlocks.end()) {
+            fail_runtime_error("memory range does not belong to this allocator");
+        }
+
+        // Unmapped memory has never been touched by the host, so there is nothing to maintain
+        const block& b = *found->second;
+        if (!b.mMapped) {
+            return false;
+        }
+
+        if (offset > range.mSize) {
+            fail_runtime_error("flush or invalidate offset lies beyond the memory range");
+        }
+
+        const vk::DeviceSize rangeEnd = range.mOffset + (size == VK_WHOLE_SIZE ? range.mSize : std::min(range.mSize, offset + size));
+
+        // Ranges of non-coherent memory are whole atoms (see allocate), so the widened range
+        // stays inside this one.
+        const vk::DeviceSize begin = align_down(range.mOffset + offset, mNonCoherentAtomSize);
+        const vk::DeviceSize end = std::min(align_up(rangeEnd, mNonCoherentAtomSize), b.mSize);
+        if (end <= begin) {
+            return false;
+        }
+
+        result.setMemory(*b.mMemory)
+              .setOffset(begin)
+              .setSize(end - begin);
+        return true;
+    }
+
+} // namespace vulkan_utils
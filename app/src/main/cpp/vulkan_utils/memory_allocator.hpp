@@ -0,0 +1,227 @@
+#ifndef VULKAN_UTILS_MEMORY_ALLOCATOR_HPP
+#define VULKAN_UTILS_MEMORY_ALLOCATOR_HPP
+
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <utility>
+
+namespace vulkan_utils {
+
+    // Sub-allocates device memory out of large blocks, so that creating a buffer or image does not
+    // cost a driver allocation (nor count against maxMemoryAllocationCount).
+    //
+    // Each memory type has its own chain of blocks, and each block keeps a first-fit free list
+    // that coalesces neighbouring ranges as they are freed. If the device's bufferImageGranularity
+    // is larger than 1, linear resources (buffers) and optimally tiled images get blocks of their
+    // own, so that they can never share a granularity page. Requests larger than half a block get
+    // a dedicated block, as do requests that would push a heap over its budget.
+    //
+    // Host-visible blocks are mapped the first time any of their ranges is mapped, and stay mapped
+    // until the block is destroyed. Cache maintenance on non-coherent memory is explicit, through
+    // flush() and invalidate().
+    class memory_allocator {
+    public:
+        enum resource_kind {
+            kResource_Linear,       // buffers
+            kResource_Optimal       // optimally tiled images
+        };
+
+        // Where a resource's memory should live, by how the host and device use it
+        enum placement {
+            kPlacement_Default,     // the allocator's default placement (see setDefaultPlacement)
+            kPlacement_Dynamic,     // touched often by both; host visible, preferably host cached
+            kPlacement_Upload,      // written by the host, read by the device; host visible, preferably device local
+            kPlacement_Readback,    // written by the device, read by the host; host visible and cached
+            kPlacement_GpuOnly      // device local; the host does not map it
+        };
+
+        // Memory types must have all of mRequired. Among those, types with more of mPreferred and
+        // fewer of mUndesired are tried first.
+        struct type_preference {
+            type_preference() {}
+            explicit type_preference(vk::MemoryPropertyFlags required) : mRequired(required) {}
+
+            vk::MemoryPropertyFlags mRequired;
+            vk::MemoryPropertyFlags mPreferred;
+            vk::MemoryPropertyFlags mUndesired;
+        };
+
+        struct heap_budget {
+            vk::DeviceSize  mBudget = 0;    // bytes the process may allocate from the heap
+            vk::DeviceSize  mUsage  = 0;    // bytes the process has allocated from the heap
+        };
+
+        typedef std::array<heap_budget, VK_MAX_MEMORY_HEAPS>    heap_budgets;
+
+        // Fills in the current budget of each heap, e.g. from VK_EXT_memory_budget
+        typedef std::function<void (heap_budgets&)>             budget_query;
+
+        struct allocation {
+            vk::DeviceMemory    mMemory;
+            vk::DeviceSize      mOffset             = 0;
+            vk::DeviceSize      mSize               = 0;
+            std::uint32_t       mMemoryTypeIndex    = 0;
+            std::uint64_t       mBlockId            = 0;
+
+            explicit operator bool() const { return (bool) mMemory; }
+        };
+
+        struct stats_t {
+            std::uint64_t   mNumAllocations     = 0;    // ranges handed out
+            std::uint64_t   mNumOutstanding     = 0;    // ranges handed out and not yet freed
+            std::uint64_t   mNumBlocks          = 0;    // blocks currently alive
+            std::uint64_t   mNumBlocksCreated   = 0;
+            std::uint64_t   mBytesInBlocks      = 0;    // device memory currently allocated from the driver
+            std::uint64_t   mBytesInUse         = 0;    // bytes of that memory handed out
+            std::uint64_t   mPeakBytesInUse     = 0;
+            std::uint64_t   mNumFallbacks       = 0;    // allocations that missed the best-ranked memory type
+            std::uint64_t   mNumFailedBlocks    = 0;    // block allocations refused by the driver
+            std::uint64_t   mNumImports         = 0;    // host allocations imported in place
+            std::uint64_t   mNumFlushes         = 0;    // vkFlushMappedMemoryRanges calls actually made
+            std::uint64_t   mNumInvalidates     = 0;    // vkInvalidateMappedMemoryRanges calls actually made
+        };
+
+                            memory_allocator(vk::Device                                 device,
+                                             const vk::PhysicalDeviceMemoryProperties&  memoryProperties,
+                                             const vk::PhysicalDeviceLimits&            limits);
+
+                            memory_allocator(const memory_allocator& other) = delete;
+
+        memory_allocator&   operator=(const memory_allocator& other) = delete;
+
+        vk::Device                                  getDevice() const { return mDevice; }
+        const vk::PhysicalDeviceMemoryProperties&   getMemoryProperties() const { return mMemoryProperties; }
+
+        // Try the memory types that suit the preference, best first, skipping heaps that are
+        // over budget until every other type has failed. Returns an empty allocation if no type
+        // can satisfy the requirements.
+        allocation          allocate(const vk::MemoryRequirements&  requirements,
+                                     const type_preference&         preference,
+                                     resource_kind                  kind);
+
+        // Equivalent to a preference that requires properties
+        allocation          allocate(const vk::MemoryRequirements&  requirements,
+                                     vk::MemoryPropertyFlags        properties,
+                                     resource_kind                  kind);
+
+        // Equivalent to the preference that suits the placement
+        allocation          allocate(const vk::MemoryRequirements&  requirements,
+                                     placement                      where,
+                                     resource_kind                  kind);
+
+        // Wrap existing host memory (VK_EXT_external_memory_host) in a dedicated range, without
+        // copying it. hostPointer must stay valid, and must span size bytes, until the range is
+        // freed. size must be a multiple of getHostImportAlignment(). Returns an empty allocation
+        // if the memory cannot be imported; the caller should then allocate and copy.
+        allocation          importHostPointer(const vk::MemoryRequirements&  requirements,
+                                              void*                          hostPointer,
+                                              vk::DeviceSize                 size);
+
+        // Enables importHostPointer. The device does this when VK_EXT_external_memory_host is on.
+        void                setHostImport(PFN_vkGetMemoryHostPointerPropertiesEXT getMemoryHostPointerProperties,
+                                          vk::DeviceSize                          minImportedHostPointerAlignment);
+
+        bool                supportsHostImport() const { return nullptr != mGetMemoryHostPointerProperties; }
+
+        // Alignment of host pointers (and granularity of sizes) that can be imported; 0 if
+        // importing is not supported.
+        vk::DeviceSize      getHostImportAlignment() const { return mHostImportAlignment; }
+
+        bool                canImportHostPointer(const void* hostPointer) const;
+
+        // Resolves kPlacement_Default. The initial default, kPlacement_Dynamic, matches what
+        // buffers always used.
+        void                setDefaultPlacement(placement where);
+        placement           getDefaultPlacement() const { return mDefaultPlacement; }
+
+        // The caller must guarantee that no resource is still bound to the range.
+        void                free(const allocation& range);
+
+        // Host address of the start of the range. The memory must be host visible.
+        void*               map(const allocation& range);
+
+        // Make host writes to [offset, offset+size) of the range visible to the device, or device
+        // writes visible to the host. The range is widened to whole nonCoherentAtomSize atoms, and
+        // nothing is done for host-coherent memory or for memory the host has never mapped.
+        void                flush(const allocation& range, vk::DeviceSize offset = 0, vk::DeviceSize size = VK_WHOLE_SIZE);
+        void                invalidate(const allocation& range, vk::DeviceSize offset = 0, vk::DeviceSize size = VK_WHOLE_SIZE);
+
+        bool                isHostCoherent(const allocation& range) const;
+        bool                isHostVisible(const allocation& range) const;
+
+        // Without a budget query, each heap's budget is 80% of its size, and only this
+        // allocator's blocks count against it.
+        void                setBudgetQuery(budget_query query);
+        heap_budget         getHeapBudget(std::uint32_t heapIndex) const;
+
+        const stats_t&      getStats() const { return mStats; }
+
+        // 1 - (largest free range / total free bytes) across all shared blocks. 0 means the free
+        // space is in one piece; values near 1 mean it is scattered in small holes.
+        double              getFragmentation() const;
+
+    private:
+        typedef std::pair<std::uint32_t, resource_kind>     pool_key;
+        typedef std::map<vk::DeviceSize, vk::DeviceSize>    free_list;  // offset -> size
+
+        struct block {
+            pool_key                mPool;
+            vk::UniqueDeviceMemory  mMemory;
+            vk::DeviceSize          mSize           = 0;
+            void*                   mMapped         = nullptr;
+            bool                    mIsDedicated    = false;
+            bool                    mIsImported     = false;
+            std::size_t             mNumAllocations = 0;
+            free_list               mFree;
+        };
+
+        typedef std::map<std::uint64_t, std::unique_ptr<block>> block_map;
+
+    private:
+        allocation          allocateFromType(const vk::MemoryRequirements&  requirements,
+                                             std::uint32_t                  typeIndex,
+                                             resource_kind                  kind);
+        void                updateBudgets();
+        bool                isWithinBudget(std::uint32_t heapIndex, vk::DeviceSize size) const;
+
+        vk::DeviceSize      getBlockSize(std::uint32_t memoryTypeIndex) const;
+        allocation          commitAllocation(block_map::iterator found, vk::DeviceSize offset, vk::DeviceSize size);
+        block_map::iterator createBlock(const pool_key&     pool,
+                                        vk::DeviceSize      size,
+                                        bool                isDedicated,
+                                        const void*         allocateNext = nullptr);
+        void                destroyBlock(block_map::iterator found);
+        bool                tryAllocate(block& b, const vk::MemoryRequirements& requirements, vk::DeviceSize& offset);
+        bool                getNonCoherentRange(const allocation&     range,
+                                                vk::DeviceSize        offset,
+                                                vk::DeviceSize        size,
+                                                vk::MappedMemoryRange& result) const;
+
+    private:
+        vk::Device                          mDevice;
+        vk::PhysicalDeviceMemoryProperties  mMemoryProperties;
+        vk::DeviceSize                      mBufferImageGranularity = 1;
+        vk::DeviceSize                      mNonCoherentAtomSize    = 1;
+        placement                           mDefaultPlacement       = kPlacement_Dynamic;
+
+        PFN_vkGetMemoryHostPointerPropertiesEXT mGetMemoryHostPointerProperties = nullptr;
+        vk::DeviceSize                      mHostImportAlignment    = 0;
+
+        budget_query                        mBudgetQuery;
+        heap_budgets                        mHeapBudgets;
+        std::array<vk::DeviceSize, VK_MAX_MEMORY_HEAPS> mHeapBytes;   // bytes in this allocator's blocks
+
+        block_map                           mBlocks;
+        std::uint64_t                       mNextBlockId            = 1;
+
+        stats_t                             mStats;
+    };
+
+}
+
+#endif //VULKAN_UTILS_MEMORY_ALLOCATOR_HPP
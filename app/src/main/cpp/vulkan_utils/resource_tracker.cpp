@@ -0,0 +1,163 @@
+#include "resource_tracker.hpp"
+
+#include "vulkan_utils.hpp"
+
+namespace {
+
+    const vk::AccessFlags kWriteAccess = vk::AccessFlagBits::eShaderWrite
+                                       | vk::AccessFlagBits::eTransferWrite
+                                       | vk::AccessFlagBits::eHostWrite
+                                       | vk::AccessFlagBits::eMemoryWrite;
+
+} // anonymous namespace
+
+namespace vulkan_utils {
+
+    resource_tracker::access_state resource_tracker::unknownState()
+    {
+        access_state result;
+        result.mWriteStages = vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer;
+        result.mWriteAccess = vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite;
+        return result;
+    }
+
+    bool resource_tracker::updateState(access_state&           state,
+                                       vk::PipelineStageFlags  stages,
+                                       vk::AccessFlags         access,
+                                       bool                    changesLayout,
+                                       vk::PipelineStageFlags& srcStages,
+                                       vk::AccessFlags&        srcAccess)
+    {
+        const vk::AccessFlags writeAccess = access & kWriteAccess;
+        bool needsBarrier = false;
+
+        if (writeAccess || changesLayout) {
+            // Wait for the last write, and for every read since, to finish
+            srcStages = state.mWriteStages | state.mReadStages;
+            srcAccess = state.mWriteAccess;
+            needsBarrier = (srcStages || changesLayout);
+
+            state.mWriteStages = stages;
+            state.mWriteAccess = writeAccess;
+            if (writeAccess) {
+                state.mReadStages = vk::PipelineStageFlags();
+                state.mVisibleStages = vk::PipelineStageFlags();
+                state.mVisibleAccess = vk::AccessFlags();
+            }
+            else {
+                // A transition for reading is visible to the readers that waited for it
+                state.mReadStages = stages;
+                state.mVisibleStages = stages;
+                state.mVisibleAccess = access;
+            }
+        }
+        else {
+            const bool isVisible = (state.mVisibleStages & stages) == stages
+                                   && (state.mVisibleAccess & access) == access;
+            if (state.mWriteStages && !isVisible) {
+                srcStages = state.mWriteStages;
+                srcAccess = state.mWriteAccess;
+                needsBarrier = true;
+
+                state.mVisibleStages |= stages;
+                state.mVisibleAccess |= access;
+            }
+
+            state.mReadStages |= stages;
+        }
+
+        return needsBarrier;
+    }
+
+    void resource_tracker::useBuffer(vk::Buffer buffer, vk::PipelineStageFlags stages, vk::AccessFlags access)
+    {
+        ++mStats.mNumUses;
+
+        auto found = mBufferStates.find(buffer);
+        if (found == mBufferStates.end()) {
+            found = mBufferStates.insert(std::make_pair(buffer, unknownState())).first;
+        }
+
+        vk::PipelineStageFlags srcStages;
+        vk::AccessFlags srcAccess;
+        if (!updateState(found->second, stages, access, false, srcStages, srcAccess)) {
+            return;
+        }
+
+        vk::BufferMemoryBarrier barrier;
+        barrier.setSrcAccessMask(srcAccess)
+               .setDstAccessMask(access)
+               .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+               .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+               .setBuffer(buffer)
+               .setSize(VK_WHOLE_SIZE);
+        mBufferBarriers.push_back(barrier);
+
+        mSrcStages |= srcStages;
+        mDstStages |= stages;
+    }
+
+    void resource_tracker::useImage(image& img, vk::PipelineStageFlags stages, vk::AccessFlags access, vk::ImageLayout layout)
+    {
+        ++mStats.mNumUses;
+
+        auto found = mImageStates.find(img.getImage());
+        if (found == mImageStates.end()) {
+            found = mImageStates.insert(std::make_pair(img.getImage(), unknownState())).first;
+        }
+
+        const bool changesLayout = (img.getLayout() != layout);
+
+        vk::PipelineStageFlags srcStages;
+        vk::AccessFlags srcAccess;
+        if (!updateState(found->second, stages, access, changesLayout, srcStages, srcAccess)) {
+            return;
+        }
+
+        // prepare performs the layout bookkeeping; the tracker knows the access masks better
+        vk::ImageMemoryBarrier barrier = img.prepare(layout);
+        barrier.setSrcAccessMask(srcAccess)
+               .setDstAccessMask(access)
+               .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+               .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
+        mImageBarriers.push_back(barrier);
+
+        mSrcStages |= (srcStages ? srcStages : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eTopOfPipe));
+        mDstStages |= stages;
+    }
+
+    void resource_tracker::recordBarriers(vk::CommandBuffer commandBuffer)
+    {
+        if (mBufferBarriers.empty() && mImageBarriers.empty()) {
+            return;
+        }
+
+        commandBuffer.pipelineBarrier(mSrcStages,
+                                      mDstStages,
+                                      vk::DependencyFlags(),
+                                      nullptr,          // memory barriers
+                                      mBufferBarriers,  // buffer memory barriers
+                                      mImageBarriers);  // image memory barriers
+
+        ++mStats.mNumBarrierCalls;
+        mStats.mNumBufferBarriers += mBufferBarriers.size();
+        mStats.mNumImageBarriers += mImageBarriers.size();
+
+        mSrcStages = vk::PipelineStageFlags();
+        mDstStages = vk::PipelineStageFlags();
+        mBufferBarriers.clear();
+        mImageBarriers.clear();
+    }
+
+    void resource_tracker::reset()
+    {
+        mBufferStates.clear();
+        mImageStates.clear();
+
+        mSrcStages = vk::PipelineStageFlags();
+        mDstStages = vk::PipelineStageFlags();
+        mBufferBarriers.clear();
+        mImageBarriers.clear();
+    }
+
+} // namespace vulkan_utils
@@ -0,0 +1,77 @@
+#ifndef VULKAN_UTILS_RESOURCE_TRACKER_HPP
+#define VULKAN_UTILS_RESOURCE_TRACKER_HPP
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace vulkan_utils {
+
+    class image;
+
+    // Remembers the last access to each buffer and image used while recording a command buffer,
+    // so that the barriers between consecutive dispatches and transfers cover only real hazards:
+    // a read of data written by an earlier command that the reader has not yet been shown, a
+    // write after any earlier access, or a change of image layout. The barriers for all the uses
+    // declared between two calls to recordBarriers go out in a single vkCmdPipelineBarrier.
+    //
+    // A resource the tracker has not seen is assumed to have been written by earlier compute or
+    // transfer work, since an earlier submission may still be using it. Host writes made before
+    // the command buffer is submitted need no barrier.
+    class resource_tracker {
+    public:
+        struct stats_t {
+            std::uint64_t   mNumUses            = 0;    // uses declared
+            std::uint64_t   mNumBarrierCalls    = 0;    // vkCmdPipelineBarrier calls recorded
+            std::uint64_t   mNumBufferBarriers  = 0;
+            std::uint64_t   mNumImageBarriers   = 0;
+        };
+
+        // Declare how the next command will use the resource
+        void    useBuffer(vk::Buffer buffer, vk::PipelineStageFlags stages, vk::AccessFlags access);
+        void    useImage(image& img, vk::PipelineStageFlags stages, vk::AccessFlags access, vk::ImageLayout layout);
+
+        // Record the barriers needed by the uses declared since the last call, if there are any
+        void    recordBarriers(vk::CommandBuffer commandBuffer);
+
+        // Forget everything, e.g. before recording into another command buffer
+        void    reset();
+
+        const stats_t&  getStats() const { return mStats; }
+
+    private:
+        struct access_state {
+            vk::PipelineStageFlags  mWriteStages;       // stages of the last write or layout transition
+            vk::AccessFlags         mWriteAccess;
+            vk::PipelineStageFlags  mReadStages;        // stages that have read since then
+            vk::PipelineStageFlags  mVisibleStages;     // stages, and accesses, the last write has been made visible to
+            vk::AccessFlags         mVisibleAccess;
+        };
+
+        static access_state unknownState();
+
+        // Update the state for a new use. Returns true, and the source scope, if it needs a barrier.
+        bool    updateState(access_state&           state,
+                            vk::PipelineStageFlags  stages,
+                            vk::AccessFlags         access,
+                            bool                    changesLayout,
+                            vk::PipelineStageFlags& srcStages,
+                            vk::AccessFlags&        srcAccess);
+
+    private:
+        std::map<vk::Buffer, access_state>  mBufferStates;
+        std::map<vk::Image, access_state>   mImageStates;
+
+        vk::PipelineStageFlags              mSrcStages;
+        vk::PipelineStageFlags              mDstStages;
+        std::vector<vk::BufferMemoryBarrier>    mBufferBarriers;
+        std::vector<vk::ImageMemoryBarrier>     mImageBarriers;
+
+        stats_t                             mStats;
+    };
+
+}
+
+#endif //VULKAN_UTILS_RESOURCE_TRACKER_HPP
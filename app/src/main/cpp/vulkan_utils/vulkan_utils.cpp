@@ -7,12 +7,15 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <ios>
 #include <iostream>
 #include <iterator>
 #include <limits>
 #include <map>
 #include <memory>
+#include <new>
 #include <stdexcept>
 #include <utility>
 #include <vector>
@@ -256,6 +259,15 @@ namespace {
         return last;
     }
 
+    int count_flags(vk::MemoryPropertyFlags flags)
+    {
+        int result = 0;
+        for (auto bits = static_cast<VkMemoryPropertyFlags>(flags); bits; bits &= bits - 1) {
+            ++result;
+        }
+        return result;
+    }
+
     void fail_runtime_error(const char* what)
     {
         throw std::runtime_error(what);
@@ -264,6 +276,45 @@ namespace {
 
 namespace vulkan_utils {
 
+    std::uint32_t find_memory_type_index(const vk::PhysicalDeviceMemoryProperties& mem_props,
+                                         std::uint32_t                             typeBits,
+                                         vk::MemoryPropertyFlags                   property_flags)
+    {
+        const auto last = mem_props.memoryTypes + mem_props.memoryTypeCount;
+        return std::distance(mem_props.memoryTypes,
+                             find_compatible_memory(mem_props.memoryTypes, last, typeBits, property_flags));
+    }
+
+    std::vector<std::uint32_t> rank_memory_types(const vk::PhysicalDeviceMemoryProperties& mem_props,
+                                                 std::uint32_t                             typeBits,
+                                                 vk::MemoryPropertyFlags                   required,
+                                                 vk::MemoryPropertyFlags                   preferred,
+                                                 vk::MemoryPropertyFlags                   undesired)
+    {
+        std::vector<std::pair<int, std::uint32_t>> scored;
+        for (std::uint32_t i = 0; i < mem_props.memoryTypeCount; ++i) {
+            const auto flags = mem_props.memoryTypes[i].propertyFlags;
+            if (0 == (typeBits & (1u << i)) || (flags & required) != required) {
+                continue;
+            }
+
+            scored.push_back(std::make_pair(count_flags(flags & preferred) - count_flags(flags & undesired), i));
+        }
+
+        std::stable_sort(scored.begin(), scored.end(),
+                         [](const std::pair<int, std::uint32_t>& l, const std::pair<int, std::uint32_t>& r) {
+                             return l.first > r.first;
+                         });
+
+        std::vector<std::uint32_t> result;
+        result.reserve(scored.size());
+        for (auto& s : scored) {
+            result.push_back(s.second);
+        }
+
+        return result;
+    }
+
     vk::UniqueDeviceMemory allocate_device_memory(vk::Device                                device,
                                                   const vk::MemoryRequirements&             mem_reqs,
                                                   const vk::PhysicalDeviceMemoryProperties& mem_props,
@@ -296,28 +347,44 @@ namespace vulkan_utils {
         return std::move(buffers[0]);
     }
 
-    buffer createUniformBuffer(vk::Device device,
-                               const vk::PhysicalDeviceMemoryProperties memoryProperties,
+    std::shared_ptr<void> allocate_importable_host_memory(const memory_allocator&  allocator,
+                                                          std::size_t              num_bytes)
+    {
+        const std::size_t alignment = std::max<std::size_t>(allocator.getHostImportAlignment(), sizeof(void*));
+        const std::size_t size = std::max<std::size_t>(importable_host_size(allocator, num_bytes), alignment);
+
+        void* result = nullptr;
+        if (0 != posix_memalign(&result, alignment, size)) {
+            throw std::bad_alloc();
+        }
+
+        return std::shared_ptr<void>(result, std::free);
+    }
+
+    std::size_t importable_host_size(const memory_allocator&  allocator,
+                                     std::size_t              num_bytes)
+    {
+        const std::size_t granularity = std::max<std::size_t>(allocator.getHostImportAlignment(), 1);
+        return ((num_bytes + granularity - 1) / granularity) * granularity;
+    }
+
+    buffer createUniformBuffer(memory_allocator&                        allocator,
                                vk::DeviceSize                           num_bytes)
     {
-        return buffer(device,
-                      memoryProperties,
+        return buffer(allocator,
                       num_bytes,
                       vk::BufferUsageFlagBits::eUniformBuffer);
     }
 
-    buffer createStorageBuffer(vk::Device device,
-                               const vk::PhysicalDeviceMemoryProperties memoryProperties,
+    buffer createStorageBuffer(memory_allocator&                        allocator,
                                vk::DeviceSize                           num_bytes)
     {
-        return buffer(device,
-                      memoryProperties,
+        return buffer(allocator,
                       num_bytes,
                       vk::BufferUsageFlagBits::eStorageBuffer);
     }
 
-    buffer createStagingBuffer(vk::Device                               device,
-                               const vk::PhysicalDeviceMemoryProperties memoryProperties,
+    buffer createStagingBuffer(memory_allocator&                        allocator,
                                const image&                             image,
                                bool                                     isForInitialzation,
                                bool                                     isForReadback)
@@ -337,20 +404,31 @@ namespace vulkan_utils {
                                               | (isForInitialzation ? vk::BufferUsageFlagBits::eTransferSrc : vk::BufferUsageFlagBits())
                                               | (isForReadback ? vk::BufferUsageFlagBits::eTransferDst : vk::BufferUsageFlagBits());
 
-        return buffer(device,
-                      memoryProperties,
+        return buffer(allocator,
                       num_bytes,
-                      usageFlags);
+                      usageFlags,
+                      buffer::kMapping_Scoped,
+                      memory_allocator::kPlacement_Dynamic);
     }
 
-    buffer::buffer(vk::Device                               device,
-                   const vk::PhysicalDeviceMemoryProperties memoryProperties,
+    buffer::buffer(memory_allocator&                        allocator,
                    vk::DeviceSize                           num_bytes,
-                   vk::BufferUsageFlags                     usage) :
+                   vk::BufferUsageFlags                     usage,
+                   Mapping                                  mapping,
+                   memory_allocator::placement              placement) :
             buffer()
     {
+        if (memory_allocator::kPlacement_Default == placement) {
+            placement = allocator.getDefaultPlacement();
+        }
+
         mUsage = usage;
-        mDevice = device;
+        if (memory_allocator::kPlacement_GpuOnly == placement) {
+            mUsage |= vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst;
+        }
+
+        mDevice = allocator.getDevice();
+        mAllocator = &allocator;
         mSize = num_bytes;
 
         // Allocate the buffer
@@ -362,26 +440,75 @@ namespace vulkan_utils {
         mBuffer = mDevice.createBufferUnique(buf_info);
 
         const auto memReqs = mDevice.getBufferMemoryRequirements(*mBuffer);
-        mDeviceMemory = allocate_device_memory(mDevice,
-                                               memReqs,
-                                               memoryProperties,
-                                               vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCached);
-
-        if (!mDeviceMemory)
-        {
-            mDeviceMemory = allocate_device_memory(mDevice,
-                                                   memReqs,
-                                                   memoryProperties,
-                                                   vk::MemoryPropertyFlagBits::eHostVisible);
-        }
+        mMemory = mAllocator->allocate(memReqs, placement, memory_allocator::kResource_Linear);
 
-        if (!mDeviceMemory)
+        if (!mMemory)
         {
             fail_runtime_error("Cannot allocate device memory");
         }
 
         // Bind the memory to the buffer object
-        mDevice.bindBufferMemory(*mBuffer, *mDeviceMemory, 0);
+        mDevice.bindBufferMemory(*mBuffer, mMemory.mMemory, mMemory.mOffset);
+
+        // Unified memory architectures often give us device-local memory the host can map directly
+        if (!mAllocator->isHostVisible(mMemory)) {
+            mStaging.reset(new buffer(allocator,
+                                      num_bytes,
+                                      vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
+                                      mapping,
+                                      memory_allocator::kPlacement_Dynamic));
+        }
+
+        if (kMapping_Persistent == mapping) {
+            mMappedData = (mStaging ? mStaging->getMappedData() : mAllocator->map(mMemory));
+        }
+    }
+
+    buffer::buffer(memory_allocator&                        allocator,
+                   std::shared_ptr<void>                    host_data,
+                   vk::DeviceSize                           num_bytes,
+                   vk::DeviceSize                           host_capacity,
+                   vk::BufferUsageFlags                     usage) :
+            buffer()
+    {
+        // The device may touch the whole padded import, so all of it must belong to host_data
+        const vk::DeviceSize importSize = importable_host_size(allocator, num_bytes);
+        if (allocator.canImportHostPointer(host_data.get()) && importSize <= host_capacity) {
+            const vk::ExternalMemoryBufferCreateInfo externalInfo(vk::ExternalMemoryHandleTypeFlagBits::eHostAllocationEXT);
+
+            vk::BufferCreateInfo buf_info;
+            buf_info.setPNext(&externalInfo)
+                    .setUsage(usage)
+                    .setSize(num_bytes)
+                    .setSharingMode(vk::SharingMode::eExclusive);
+
+            vk::Device device = allocator.getDevice();
+            vk::UniqueBuffer importBuffer = device.createBufferUnique(buf_info);
+
+            const auto memReqs = device.getBufferMemoryRequirements(*importBuffer);
+            auto importMemory = allocator.importHostPointer(memReqs, host_data.get(), importSize);
+            if (importMemory) {
+                device.bindBufferMemory(*importBuffer, importMemory.mMemory, importMemory.mOffset);
+
+                mUsage = usage;
+                mSize = num_bytes;
+                mDevice = device;
+                mAllocator = &allocator;
+                mMemory = importMemory;
+                mBuffer = std::move(importBuffer);
+                mHostData = std::move(host_data);
+                mIsHostImport = true;
+                return;
+            }
+        }
+
+        // Fall back to copying
+        buffer copied(allocator, num_bytes, usage);
+        {
+            auto copiedMap = copied.map<void>();
+            std::memcpy(copiedMap.get(), host_data.get(), num_bytes);
+        }
+        swap(copied);
     }
 
     buffer::buffer(buffer&& other) :
@@ -391,6 +518,11 @@ namespace vulkan_utils {
     }
 
     buffer::~buffer() {
+        // The buffer must be gone before its memory can be reused
+        mBuffer.reset();
+        if (mAllocator) {
+            mAllocator->free(mMemory);
+        }
     }
 
     buffer& buffer::operator=(buffer&& other)
@@ -405,10 +537,16 @@ namespace vulkan_utils {
 
         swap(mUsage, other.mUsage);
         swap(mIsMapped, other.mIsMapped);
+        swap(mIsHostImport, other.mIsHostImport);
+        swap(mSize, other.mSize);
+        swap(mMappedData, other.mMappedData);
 
         swap(mDevice, other.mDevice);
-        swap(mDeviceMemory, other.mDeviceMemory);
+        swap(mAllocator, other.mAllocator);
+        swap(mMemory, other.mMemory);
         swap(mBuffer, other.mBuffer);
+        swap(mStaging, other.mStaging);
+        swap(mHostData, other.mHostData);
     }
 
     vk::BufferMemoryBarrier buffer::prepareForShaderRead()
@@ -507,20 +645,24 @@ namespace vulkan_utils {
 
     mapped_ptr<void> buffer::map()
     {
-        // TODO check that the memory is host visible
+        if (mStaging) {
+            return mStaging->map();
+        }
+
+        if (!mAllocator->isHostVisible(mMemory)) {
+            fail_runtime_error("buffer memory is not host visible");
+        }
 
         if (mIsMapped) {
             fail_runtime_error("buffer is already mapped");
         }
 
-        void* memMap = mDevice.mapMemory(*mDeviceMemory, 0, VK_WHOLE_SIZE, vk::MemoryMapFlags());
+        // The allocator keeps the whole block mapped; this just marks the buffer as in use by the host
+        void* memMap = mAllocator->map(mMemory);
         mapped_ptr<void> result(memMap, std::bind(&buffer::unmap, this));
         mIsMapped = true;
 
-        // TODO only do cache management on incoherent memory
-
-        const vk::MappedMemoryRange mappedRange(*mDeviceMemory, 0, VK_WHOLE_SIZE);
-        mDevice.invalidateMappedMemoryRanges(mappedRange);
+        invalidate();
 
         return result;
     }
@@ -531,20 +673,36 @@ namespace vulkan_utils {
             fail_runtime_error("buffer is not mapped");
         }
 
-        // TODO only do cache management on incoherent memory
+        flush();
 
-        const vk::MappedMemoryRange mappedRange(*mDeviceMemory, 0, VK_WHOLE_SIZE);
-        mDevice.flushMappedMemoryRanges(mappedRange);
-
-        mDevice.unmapMemory(*mDeviceMemory);
         mIsMapped = false;
     }
 
+    void buffer::flush(vk::DeviceSize offset, vk::DeviceSize size)
+    {
+        if (mStaging) {
+            mStaging->flush(offset, size);
+        }
+        else {
+            mAllocator->flush(mMemory, offset, size);
+        }
+    }
+
+    void buffer::invalidate(vk::DeviceSize offset, vk::DeviceSize size)
+    {
+        if (mStaging) {
+            mStaging->invalidate(offset, size);
+        }
+        else {
+            mAllocator->invalidate(mMemory, offset, size);
+        }
+    }
+
     image::image()
             : mDevice(),
-              mMemoryProperties(),
+              mAllocator(nullptr),
+              mMemory(),
               mImageLayout(vk::ImageLayout::eUndefined),
-              mDeviceMemory(),
               mExtent(),
               mImage(),
               mImageView(),
@@ -558,9 +716,9 @@ namespace vulkan_utils {
         using std::swap;
 
         swap(mDevice, other.mDevice);
-        swap(mMemoryProperties, other.mMemoryProperties);
+        swap(mAllocator, other.mAllocator);
+        swap(mMemory, other.mMemory);
         swap(mImageLayout, other.mImageLayout);
-        swap(mDeviceMemory, other.mDeviceMemory);
         swap(mExtent, other.mExtent);
         swap(mImage, other.mImage);
         swap(mImageView, other.mImageView);
@@ -580,8 +738,7 @@ namespace vulkan_utils {
         return (requiredFeatures == (properties.optimalTilingFeatures & requiredFeatures));
     }
 
-    image::image(vk::Device                                 dev,
-                 const vk::PhysicalDeviceMemoryProperties   memoryProperties,
+    image::image(memory_allocator&                          allocator,
                  vk::Extent3D                               extent,
                  vk::Format                                 format,
                  Usage                                      usage)
@@ -594,8 +751,8 @@ namespace vulkan_utils {
 
         const bool is3D = (extent.depth > 1);
 
-        mDevice = dev;
-        mMemoryProperties = memoryProperties;
+        mDevice = allocator.getDevice();
+        mAllocator = &allocator;
         mExtent = extent;
         mFormat = format;
 
@@ -621,17 +778,17 @@ namespace vulkan_utils {
 
         mImage = mDevice.createImageUnique(imageInfo);
 
-        // allocate device memory for the image
-        mDeviceMemory = allocate_device_memory(mDevice,
-                                               mDevice.getImageMemoryRequirements(*mImage),
-                                               mMemoryProperties);
-        if (!mDeviceMemory)
+        // allocate device memory for the image; the host only reaches it through copies
+        mMemory = mAllocator->allocate(mDevice.getImageMemoryRequirements(*mImage),
+                                       memory_allocator::kPlacement_GpuOnly,
+                                       memory_allocator::kResource_Optimal);
+        if (!mMemory)
         {
             fail_runtime_error("Cannot allocate device memory for image");
         }
 
         // Bind the memory to the image object
-        mDevice.bindImageMemory(*mImage, *mDeviceMemory, 0);
+        mDevice.bindImageMemory(*mImage, mMemory.mMemory, mMemory.mOffset);
 
         // Allocate the image view
         vk::ImageViewCreateInfo viewInfo;
@@ -653,6 +810,12 @@ namespace vulkan_utils {
 
     image::~image()
     {
+        // The image must be gone before its memory can be reused
+        mImageView.reset();
+        mImage.reset();
+        if (mAllocator) {
+            mAllocator->free(mMemory);
+        }
     }
 
     image& image::operator=(image&& other)
@@ -676,8 +839,6 @@ namespace vulkan_utils {
             fail_runtime_error("images cannot be transitioned to undefined layout");
         }
 
-        // TODO: if the layout isn't changing, no barrier is needed
-
         const auto accessMap = {
                 std::make_pair(vk::ImageLayout::eShaderReadOnlyOptimal, vk::AccessFlagBits::eShaderRead),
                 std::make_pair(vk::ImageLayout::eTransferDstOptimal, vk::AccessFlagBits::eTransferWrite),
@@ -714,18 +875,21 @@ namespace vulkan_utils {
         return result;
     }
 
+    std::uint64_t timestamp_valid_bits_mask(std::uint32_t timestampValidBits)
+    {
+        if (timestampValidBits >= 64) {
+            return std::numeric_limits<std::uint64_t>::max();
+        }
+
+        return (std::uint64_t(1) << timestampValidBits) - 1;
+    }
+
     double timestamp_delta_ns(std::uint64_t                         startTimestamp,
                               std::uint64_t                         endTimestamp,
                               const vk::PhysicalDeviceProperties&   deviceProperties,
                               const vk::QueueFamilyProperties&      queueFamilyProperties) {
-        std::uint64_t timestampDelta;
-        if (endTimestamp >= startTimestamp) {
-            timestampDelta = endTimestamp - startTimestamp;
-        }
-        else {
-            const std::uint64_t maxTimestamp = std::numeric_limits<std::uint64_t>::max() >> (64 - queueFamilyProperties.timestampValidBits);
-            timestampDelta = maxTimestamp - startTimestamp + endTimestamp + 1;
-        }
+        // Unsigned subtraction wraps modulo 2^64; masking reduces that modulo 2^timestampValidBits
+        const std::uint64_t timestampDelta = (endTimestamp - startTimestamp) & timestamp_valid_bits_mask(queueFamilyProperties.timestampValidBits);
 
         return timestampDelta * deviceProperties.limits.timestampPeriod;
     }
@@ -755,8 +919,26 @@ namespace vulkan_utils {
                            buffer&              buffer,
                            image&               image)
     {
-        vk::BufferMemoryBarrier bufferBarrier = buffer.prepareForTransferSrc();
-        vk::ImageMemoryBarrier imageBarrier = image.prepare(vk::ImageLayout::eTransferDstOptimal);
+        resource_tracker tracker;
+        copyBufferToImage(commandBuffer, tracker, buffer, image);
+    }
+
+    void copyBufferToImage(vk::CommandBuffer    commandBuffer,
+                           resource_tracker&    tracker,
+                           buffer&              buffer,
+                           image&               image)
+    {
+        if (!(buffer.getUsage() & vk::BufferUsageFlagBits::eTransferSrc))
+        {
+            fail_runtime_error("buffer was not constructed as a potential transfer source");
+        }
+
+        recordUploads(commandBuffer, tracker, &buffer);
+
+        const vk::Buffer srcBuffer = buffer.use().buffer;
+        tracker.useBuffer(srcBuffer, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead);
+        tracker.useImage(image, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eTransferDstOptimal);
+        tracker.recordBarriers(commandBuffer);
 
         const auto imageExtent = image.getExtent();
 
@@ -767,22 +949,31 @@ namespace vulkan_utils {
         copyRegion.imageSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor)
                                    .setLayerCount(1);
 
-        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eHost | vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
-                                      vk::PipelineStageFlagBits::eTransfer,
-                                      vk::DependencyFlags(),
-                                      nullptr,         // memory barriers
-                                      bufferBarrier,   // buffer memory barriers
-                                      imageBarrier);   // image memory barriers
+        commandBuffer.copyBufferToImage(srcBuffer, image.getImage(), image.getLayout(), copyRegion);
+    }
 
-        commandBuffer.copyBufferToImage(bufferBarrier.buffer, imageBarrier.image, imageBarrier.newLayout, copyRegion);
+    void copyImageToBuffer(vk::CommandBuffer    commandBuffer,
+                           image&               image,
+                           buffer&              buffer)
+    {
+        resource_tracker tracker;
+        copyImageToBuffer(commandBuffer, tracker, image, buffer);
     }
 
     void copyImageToBuffer(vk::CommandBuffer    commandBuffer,
+                           resource_tracker&    tracker,
                            image&               image,
                            buffer&              buffer)
     {
-        vk::BufferMemoryBarrier bufferBarrier = buffer.prepareForTransferDst();
-        vk::ImageMemoryBarrier imageBarrier = image.prepare(vk::ImageLayout::eTransferSrcOptimal);
+        if (!(buffer.getUsage() & vk::BufferUsageFlagBits::eTransferDst))
+        {
+            fail_runtime_error("buffer was not constructed as a potential transfer destination");
+        }
+
+        const vk::Buffer dstBuffer = buffer.use().buffer;
+        tracker.useImage(image, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead, vk::ImageLayout::eTransferSrcOptimal);
+        tracker.useBuffer(dstBuffer, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite);
+        tracker.recordBarriers(commandBuffer);
 
         const auto imageExtent = image.getExtent();
 
@@ -793,14 +984,74 @@ namespace vulkan_utils {
         copyRegion.imageSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor)
                                    .setLayerCount(1);
 
-        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eHost | vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
-                                      vk::PipelineStageFlagBits::eTransfer,
-                                      vk::DependencyFlags(),
-                                      nullptr,         // memory barriers
-                                      bufferBarrier,   // buffer memory barriers
-                                      imageBarrier);   // image memory barriers
+        commandBuffer.copyImageToBuffer(image.getImage(), image.getLayout(), dstBuffer, copyRegion);
+
+        recordReadbacks(commandBuffer, tracker, &buffer);
+    }
+
+    void recordUploads(vk::CommandBuffer                commandBuffer,
+                       resource_tracker&                tracker,
+                       vk::ArrayProxy<buffer* const>    buffers)
+    {
+        bool anyStaged = false;
+        for (auto b : buffers) {
+            if (b->mStaging) {
+                tracker.useBuffer(*b->mStaging->mBuffer, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead);
+                tracker.useBuffer(*b->mBuffer, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite);
+                anyStaged = true;
+            }
+        }
+
+        if (!anyStaged) {
+            return;
+        }
+
+        tracker.recordBarriers(commandBuffer);
+
+        for (auto b : buffers) {
+            if (b->mStaging) {
+                commandBuffer.copyBuffer(*b->mStaging->mBuffer, *b->mBuffer, vk::BufferCopy(0, 0, b->mSize));
+            }
+        }
+    }
+
+    void recordReadbacks(vk::CommandBuffer              commandBuffer,
+                         resource_tracker&              tracker,
+                         vk::ArrayProxy<buffer* const>  buffers)
+    {
+        bool anyStaged = false;
+        for (auto b : buffers) {
+            if (b->mStaging) {
+                tracker.useBuffer(*b->mBuffer, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead);
+                tracker.useBuffer(*b->mStaging->mBuffer, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite);
+                anyStaged = true;
+            }
+        }
+
+        if (!anyStaged) {
+            return;
+        }
+
+        tracker.recordBarriers(commandBuffer);
+
+        for (auto b : buffers) {
+            if (b->mStaging) {
+                commandBuffer.copyBuffer(*b->mBuffer, *b->mStaging->mBuffer, vk::BufferCopy(0, 0, b->mSize));
+                tracker.useBuffer(*b->mStaging->mBuffer, vk::PipelineStageFlagBits::eHost, vk::AccessFlagBits::eHostRead);
+            }
+        }
+
+        tracker.recordBarriers(commandBuffer);
+    }
+
+    vk::UniquePipelineLayout create_pipeline_layout(vk::Device                                      device,
+                                                    vk::ArrayProxy<const vk::DescriptorSetLayout>   layouts)
+    {
+        vk::PipelineLayoutCreateInfo createInfo;
+        createInfo.setSetLayoutCount(layouts.size())
+                .setPSetLayouts(layouts.data());
 
-        commandBuffer.copyImageToBuffer(imageBarrier.image, imageBarrier.newLayout, bufferBarrier.buffer, copyRegion);
+        return device.createPipelineLayoutUnique(createInfo);
     }
 
     vk::UniquePipeline create_compute_pipeline(vk::Device                       device,
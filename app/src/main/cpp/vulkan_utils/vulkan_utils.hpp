@@ -5,12 +5,16 @@
 #ifndef VULKAN_UTILS_HPP
 #define VULKAN_UTILS_HPP
 
+#include "memory_allocator.hpp"
+#include "resource_tracker.hpp"
+
 #include <vulkan/vulkan.hpp>
 
 #include <boost/units/quantity.hpp>
 #include <boost/units/systems/si/time.hpp>
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <ostream>
 #include <vector>
@@ -39,6 +43,21 @@ namespace vulkan_utils {
         return result;
     };
 
+    // Index of the first memory type allowed by typeBits that has all of property_flags, or
+    // mem_props.memoryTypeCount if there is none.
+    std::uint32_t find_memory_type_index(const vk::PhysicalDeviceMemoryProperties& mem_props,
+                                         std::uint32_t                             typeBits,
+                                         vk::MemoryPropertyFlags                   property_flags);
+
+    // Indices of the memory types allowed by typeBits that have all of required, best first. A
+    // type scores a point for each preferred flag it has and loses one for each undesired flag;
+    // among equals, the earlier type (which Vulkan orders as the better one) comes first.
+    std::vector<std::uint32_t> rank_memory_types(const vk::PhysicalDeviceMemoryProperties& mem_props,
+                                                 std::uint32_t                             typeBits,
+                                                 vk::MemoryPropertyFlags                   required,
+                                                 vk::MemoryPropertyFlags                   preferred,
+                                                 vk::MemoryPropertyFlags                   undesired);
+
     vk::UniqueDeviceMemory allocate_device_memory(vk::Device device,
                                                   const vk::MemoryRequirements&             mem_reqs,
                                                   const vk::PhysicalDeviceMemoryProperties& mem_props,
@@ -46,6 +65,9 @@ namespace vulkan_utils {
 
     vk::UniqueCommandBuffer allocate_command_buffer(vk::Device device, vk::CommandPool cmd_pool);
 
+    vk::UniquePipelineLayout create_pipeline_layout(vk::Device                                      device,
+                                                    vk::ArrayProxy<const vk::DescriptorSetLayout>   layouts);
+
     vk::UniquePipeline create_compute_pipeline(vk::Device                       device,
                                                vk::ShaderModule                 shaderModule,
                                                const char*                      entryPoint,
@@ -53,20 +75,33 @@ namespace vulkan_utils {
                                                vk::PipelineCache                pipelineCache,
                                                vk::ArrayProxy<std::uint32_t>    specConstants);
 
-    buffer createUniformBuffer(vk::Device device,
-                               const vk::PhysicalDeviceMemoryProperties memoryProperties,
+    buffer createUniformBuffer(memory_allocator&                        allocator,
                                vk::DeviceSize                           num_bytes);
 
-    buffer createStorageBuffer(vk::Device device,
-                               const vk::PhysicalDeviceMemoryProperties memoryProperties,
+    buffer createStorageBuffer(memory_allocator&                        allocator,
                                vk::DeviceSize                           num_bytes);
 
-    buffer createStagingBuffer(vk::Device                               device,
-                               const vk::PhysicalDeviceMemoryProperties memoryProperties,
+    buffer createStagingBuffer(memory_allocator&                        allocator,
                                const image&                             image,
                                bool                                     isForInitialzation,
                                bool                                     isForReadback);
 
+    // Host memory that buffers can wrap in place when the allocator supports importing host
+    // pointers: aligned to the allocator's import alignment, and importable_host_size(num_bytes)
+    // bytes long. When importing is not supported, this is ordinary host memory.
+    std::shared_ptr<void> allocate_importable_host_memory(const memory_allocator&  allocator,
+                                                          std::size_t              num_bytes);
+
+    // num_bytes rounded up to the allocator's import granularity: how much host memory an
+    // import of num_bytes hands to the device
+    std::size_t importable_host_size(const memory_allocator&  allocator,
+                                     std::size_t              num_bytes);
+
+    // Mask of the meaningful bits of a timestamp written on a queue with timestampValidBits
+    std::uint64_t timestamp_valid_bits_mask(std::uint32_t timestampValidBits);
+
+    // Timestamps wrap at timestampValidBits; an end timestamp earlier than the start is taken to
+    // have wrapped once.
     double timestamp_delta_ns(std::uint64_t                         startTimestamp,
                               std::uint64_t                         endTimestamp,
                               const vk::PhysicalDeviceProperties&   deviceProperties,
@@ -80,7 +115,14 @@ namespace vulkan_utils {
 
     vk::Extent3D computeNumberWorkgroups(const vk::Extent3D& workgroupSize, const vk::Extent3D& dataSize);
 
+    // The tracker variants skip barriers the tracker knows are not needed, e.g. when the copy
+    // follows other work on the same command buffer; the others assume nothing.
+    void copyBufferToImage(vk::CommandBuffer    commandBuffer,
+                           buffer&              buffer,
+                           image&               image);
+
     void copyBufferToImage(vk::CommandBuffer    commandBuffer,
+                           resource_tracker&    tracker,
                            buffer&              buffer,
                            image&               image);
 
@@ -88,16 +130,57 @@ namespace vulkan_utils {
                            image&               image,
                            buffer&              buffer);
 
+    void copyImageToBuffer(vk::CommandBuffer    commandBuffer,
+                           resource_tracker&    tracker,
+                           image&               image,
+                           buffer&              buffer);
+
+    // Copy the staging shadow of each staged buffer to its device buffer, or the device buffer
+    // back to the shadow, behind a single batch of barriers. Buffers that are not staged are
+    // skipped.
+    void recordUploads(vk::CommandBuffer                commandBuffer,
+                       resource_tracker&                tracker,
+                       vk::ArrayProxy<buffer* const>    buffers);
+
+    void recordReadbacks(vk::CommandBuffer              commandBuffer,
+                         resource_tracker&              tracker,
+                         vk::ArrayProxy<buffer* const>  buffers);
+
     template <typename T>
     using mapped_ptr = std::unique_ptr<T, std::function<void (void*)> >;
 
     class buffer {
+    public:
+        enum Mapping {
+            kMapping_Scoped,        // map() hands out the memory, with cache maintenance on each map and unmap
+            kMapping_Persistent     // mapped at creation; the owner calls flush() and invalidate() itself
+        };
+
     public:
         buffer () {}
 
-        buffer (vk::Device device,
-                const vk::PhysicalDeviceMemoryProperties memoryProperties,
+        // The allocator must outlive the buffer.
+        //
+        // A kPlacement_GpuOnly buffer that lands in memory the host cannot see gets a host-visible
+        // staging shadow. map(), getMappedData(), flush() and invalidate() then operate on the
+        // shadow, and recordUploads()/recordReadbacks() move its contents to and from the device.
+        buffer (memory_allocator&                        allocator,
+                vk::DeviceSize                           num_bytes,
+                vk::BufferUsageFlags                     usage,
+                Mapping                                  mapping = kMapping_Scoped,
+                memory_allocator::placement              placement = memory_allocator::kPlacement_Default);
+
+        // Wrap host_data without copying it, if the allocator can import it (see
+        // allocate_importable_host_memory). host_capacity is the length of the host allocation;
+        // an import spans importable_host_size(num_bytes) bytes, so host data that is shorter
+        // than that is copied instead. The buffer shares ownership of imported host_data, which
+        // is released only after the imported memory is. Otherwise allocate a buffer as above and
+        // copy host_data into it; later changes to host_data are then not seen by the buffer.
+        // isHostImport() tells which happened.
+        buffer (memory_allocator&                        allocator,
+                std::shared_ptr<void>                    host_data,
                 vk::DeviceSize                           num_bytes,
+                vk::DeviceSize                           host_capacity,
                 vk::BufferUsageFlags                     usage);
 
         buffer (const buffer & other) = delete;
@@ -123,6 +206,9 @@ namespace vulkan_utils {
         vk::BufferUsageFlags     getUsage() const { return mUsage; }
         vk::DeviceSize           getSize() const { return mSize; }
 
+        bool                     isStaged() const { return (bool) mStaging; }
+        bool                     isHostImport() const { return mIsHostImport; }
+
     public:
         template <typename T>
         inline mapped_ptr<T> map()
@@ -133,17 +219,36 @@ namespace vulkan_utils {
 
         mapped_ptr<void> map();
 
+        // Host address of a persistently mapped buffer; nullptr for a scoped buffer.
+        template <typename T>
+        inline T*   getMappedData() const { return static_cast<T*>(mMappedData); }
+
+        void*       getMappedData() const { return mMappedData; }
+
+        // Offsets and sizes are in bytes, relative to the start of the buffer. Both are no-ops on
+        // host-coherent memory.
+        void        flush(vk::DeviceSize offset = 0, vk::DeviceSize size = VK_WHOLE_SIZE);
+        void        invalidate(vk::DeviceSize offset = 0, vk::DeviceSize size = VK_WHOLE_SIZE);
+
     private:
         void    unmap();
 
+        friend void recordUploads(vk::CommandBuffer, resource_tracker&, vk::ArrayProxy<buffer* const>);
+        friend void recordReadbacks(vk::CommandBuffer, resource_tracker&, vk::ArrayProxy<buffer* const>);
+
     private:
         vk::BufferUsageFlags    mUsage;
-        bool                    mIsMapped   = false;
-        vk::DeviceSize          mSize       = 0;
-
-        vk::Device              mDevice;
-        vk::UniqueDeviceMemory  mDeviceMemory;
-        vk::UniqueBuffer        mBuffer;
+        bool                    mIsMapped       = false;
+        bool                    mIsHostImport   = false;
+        vk::DeviceSize          mSize           = 0;
+        void*                   mMappedData = nullptr;
+
+        vk::Device                      mDevice;
+        memory_allocator*               mAllocator  = nullptr;
+        memory_allocator::allocation    mMemory;
+        vk::UniqueBuffer                mBuffer;
+        std::unique_ptr<buffer>         mStaging;
+        std::shared_ptr<void>           mHostData;      // imported host memory; outlives mMemory
     };
 
     inline void swap(buffer & lhs, buffer & rhs)
@@ -163,8 +268,8 @@ namespace vulkan_utils {
 
         image();
 
-        image(vk::Device                                dev,
-              const vk::PhysicalDeviceMemoryProperties  memoryProperties,
+        // The allocator must outlive the image.
+        image(memory_allocator&                         allocator,
               vk::Extent3D                              extent,
               vk::Format                                format,
               Usage                                     usage);
@@ -186,12 +291,14 @@ namespace vulkan_utils {
 
         vk::Extent3D getExtent() const { return mExtent; }
         vk::Format getFormat() const { return mFormat; }
+        vk::ImageLayout getLayout() const { return mImageLayout; }
+        vk::Image getImage() const { return *mImage; }
 
     private:
         vk::Device                          mDevice;
-        vk::PhysicalDeviceMemoryProperties  mMemoryProperties;
+        memory_allocator*                   mAllocator;
+        memory_allocator::allocation        mMemory;
         vk::ImageLayout                     mImageLayout;
-        vk::UniqueDeviceMemory              mDeviceMemory;
         vk::Extent3D                        mExtent;
         vk::UniqueImage                     mImage;
         vk::UniqueImageView                 mImageView;